@@ -1,8 +1,19 @@
 #include <sys/stat.h>
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 extern "C" {
@@ -15,6 +26,7 @@ extern "C" {
 }
 
 #include <emscripten/bind.h>
+#include <emscripten/emscripten.h>
 #include <emscripten/val.h>
 
 #include "SoundTouch.h"
@@ -26,6 +38,32 @@ struct Status {
     std::string error;
 };
 
+struct AudioStreamInfo {
+    int index;
+    std::string codec;
+    int channels;
+    int sample_rate;
+    std::string language;
+    std::string title;
+    bool is_default;
+};
+
+// 容器自带的章节（M4B、MKA、Ogg CHAPTERxx 等），时间为秒
+struct ChapterInfo {
+    double start;
+    double end;
+    std::string title;
+};
+
+// CUE 表中的一条音轨，时间为整轨镜像内的秒数
+struct CueTrack {
+    int number;
+    double start;
+    double end;
+    std::string title;
+    std::string performer;
+};
+
 struct AudioProperties {
     Status status;
     std::string encoding;
@@ -35,9 +73,36 @@ struct AudioProperties {
     std::map<std::string, std::string> metadata;
     std::vector<uint8_t> cover_art;
     int bits_per_sample;
+    std::vector<AudioStreamInfo> streams;
+    int stream_index;
+    std::vector<ChapterInfo> chapters;
 };
 
-enum class SampleFormat { PlanarF32 = 0, InterleavedS16 = 1 };
+/**
+ * 输出样本格式。InterleavedS24 为小端 packed 3 字节；InterleavedF32 不限幅，
+ * 与 PlanarF32 只有排列不同
+ */
+enum class SampleFormat {
+    PlanarF32 = 0,
+    InterleavedS16 = 1,
+    InterleavedS32 = 2,
+    InterleavedS24 = 3,
+    InterleavedF32 = 4,
+};
+
+// 每个样本的字节数
+inline int bytesPerSample(SampleFormat format) {
+    switch (format) {
+        case SampleFormat::InterleavedS16:
+            return 2;
+        case SampleFormat::InterleavedS24:
+            return 3;
+        default:
+            return 4;
+    }
+}
+
+enum class NormalizationMode { Off = 0, Track = 1, Album = 2 };
 
 struct ChunkResult {
     Status status;
@@ -46,20 +111,1062 @@ struct ChunkResult {
     double startTime;
 };
 
+// readChunk 的 C++ 内部形式，不经过 Embind
+struct DecodedChunk {
+    Status status;
+    const void* data;
+    int frames;
+    int channels;
+    bool isEOF;
+    double startTime;
+};
+
+/**
+ * C ABI 热路径（decoder_read_chunk）的结果头，布局固定，JS 按字节偏移直接读取：
+ * 0 status, 4 frames, 8 channels, 12 isEOF, 16 startTime, 24 queuedDuration, 32 error, 36 data
+ */
+struct ChunkHeader {
+    int32_t status;
+    int32_t frames;
+    int32_t channels;
+    int32_t isEOF;
+    double startTime;
+    // 解码器预读队列中尚未解码的压缩数据时长（秒）
+    double queuedDuration;
+    // status < 0 时的错误信息，以 0 结尾，下次调用前有效
+    const char* error;
+    // 样本地址，与 decoder_read_chunk 的返回值相同，没有样本时为空
+    const void* data;
+};
+
+// RawChunkReader.ts 按这些偏移读取，改动布局时两边同步；指针按 wasm32 的 4 字节计
+#ifdef __EMSCRIPTEN__
+static_assert(offsetof(ChunkHeader, status) == 0, "ChunkHeader layout");
+static_assert(offsetof(ChunkHeader, frames) == 4, "ChunkHeader layout");
+static_assert(offsetof(ChunkHeader, channels) == 8, "ChunkHeader layout");
+static_assert(offsetof(ChunkHeader, isEOF) == 12, "ChunkHeader layout");
+static_assert(offsetof(ChunkHeader, startTime) == 16, "ChunkHeader layout");
+static_assert(offsetof(ChunkHeader, queuedDuration) == 24, "ChunkHeader layout");
+static_assert(offsetof(ChunkHeader, error) == 32, "ChunkHeader layout");
+static_assert(offsetof(ChunkHeader, data) == 36, "ChunkHeader layout");
+static_assert(sizeof(ChunkHeader) == 40, "ChunkHeader layout");
+#endif
+
+// 直播流中随播放变化的元数据（ICY StreamTitle 等），time 为开始生效的源时间
+struct StreamMetadataEvent {
+    double time;
+    std::string title;
+    std::string raw;
+};
+
+struct PacketQueueStatus {
+    int packets;
+    int bytes;
+    double duration;
+    bool isFull;
+    bool demuxEOF;
+};
+
+enum class EqFilterType { Peaking = 0, LowShelf = 1, HighShelf = 2, LowPass = 3, HighPass = 4 };
+
+struct DspStats {
+    double lastChunkMs;
+    double averageChunkMs;
+    int chunks;
+    int latencyFrames;
+};
+
+// 4 路 float 向量，开启 -msimd128 时编译为 WASM SIMD，否则退化为标量代码
+typedef float f32x4 __attribute__((vector_size(16)));
+
+/**
+ * 输出端的实时 DSP：若干级双二阶滤波器（参数均衡）+ 前瞻峰值限制器。
+ * 滤波器状态按声道打包进向量，一次处理 4 个声道；参数更新在下一个 chunk 内线性过渡。
+ */
+class DspChain {
+   public:
+    static constexpr int kMaxBands = 16;
+
+   private:
+    struct Coeffs {
+        float b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    };
+
+    struct Band {
+        bool enabled = false;
+        // 过渡到直通后停用
+        bool disabling = false;
+        EqFilterType type = EqFilterType::Peaking;
+        double freq = 1000.0, gain_db = 0.0, q = 0.707;
+        Coeffs current;
+        Coeffs target;
+    };
+
+    int m_sample_rate = 0;
+    int m_channels = 0;
+    int m_groups = 0;
+
+    Band m_bands[kMaxBands];
+    // [band][group] 的 TDF-II 状态
+    std::vector<f32x4> m_z1;
+    std::vector<f32x4> m_z2;
+
+    bool m_limiter_enabled = false;
+    double m_threshold_db = -1.0, m_lookahead_ms = 5.0, m_release_ms = 50.0;
+    float m_threshold = 1.0f;
+    int m_lookahead = 0;
+    float m_attack_coef = 1.0f;
+    float m_release_coef = 1.0f;
+    float m_envelope = 1.0f;
+    // 交错的延迟线，长度为 m_lookahead 帧
+    std::vector<float> m_delay;
+    int m_delay_pos = 0;
+    // 滑动窗口最小增益：长度 m_lookahead + 1 的环形单调队列，存放 (帧序号, 所需增益)，
+    // 从队首到队尾增益递增
+    std::vector<int64_t> m_window_frames;
+    std::vector<float> m_window_gains;
+    int m_window_head = 0;
+    int m_window_size = 0;
+    int64_t m_frame_index = 0;
+    int m_tail_frames = 0;
+
+    static Coeffs design(EqFilterType type, double sample_rate, double freq, double gain_db,
+                         double q) {
+        double A = std::pow(10.0, gain_db / 40.0);
+        double w0 = 2.0 * M_PI * std::min(freq, sample_rate * 0.49) / sample_rate;
+        double cw = std::cos(w0);
+        double alpha = std::sin(w0) / (2.0 * std::max(q, 0.01));
+        double sa = 2.0 * std::sqrt(A) * alpha;
+
+        double b0, b1, b2, a0, a1, a2;
+        switch (type) {
+            case EqFilterType::LowShelf:
+                b0 = A * ((A + 1) - (A - 1) * cw + sa);
+                b1 = 2 * A * ((A - 1) - (A + 1) * cw);
+                b2 = A * ((A + 1) - (A - 1) * cw - sa);
+                a0 = (A + 1) + (A - 1) * cw + sa;
+                a1 = -2 * ((A - 1) + (A + 1) * cw);
+                a2 = (A + 1) + (A - 1) * cw - sa;
+                break;
+            case EqFilterType::HighShelf:
+                b0 = A * ((A + 1) + (A - 1) * cw + sa);
+                b1 = -2 * A * ((A - 1) + (A + 1) * cw);
+                b2 = A * ((A + 1) + (A - 1) * cw - sa);
+                a0 = (A + 1) - (A - 1) * cw + sa;
+                a1 = 2 * ((A - 1) - (A + 1) * cw);
+                a2 = (A + 1) - (A - 1) * cw - sa;
+                break;
+            case EqFilterType::LowPass:
+                b0 = (1 - cw) / 2;
+                b1 = 1 - cw;
+                b2 = (1 - cw) / 2;
+                a0 = 1 + alpha;
+                a1 = -2 * cw;
+                a2 = 1 - alpha;
+                break;
+            case EqFilterType::HighPass:
+                b0 = (1 + cw) / 2;
+                b1 = -(1 + cw);
+                b2 = (1 + cw) / 2;
+                a0 = 1 + alpha;
+                a1 = -2 * cw;
+                a2 = 1 - alpha;
+                break;
+            case EqFilterType::Peaking:
+            default:
+                b0 = 1 + alpha * A;
+                b1 = -2 * cw;
+                b2 = 1 - alpha * A;
+                a0 = 1 + alpha / A;
+                a1 = -2 * cw;
+                a2 = 1 - alpha / A;
+                break;
+        }
+
+        Coeffs c;
+        c.b0 = (float)(b0 / a0);
+        c.b1 = (float)(b1 / a0);
+        c.b2 = (float)(b2 / a0);
+        c.a1 = (float)(a1 / a0);
+        c.a2 = (float)(a2 / a0);
+        return c;
+    }
+
+    // 逐帧线性过渡的系数，顺序为 b0 b1 b2 a1 a2；每个通道可以属于不同频段
+    struct Ramp {
+        f32x4 c[5];
+        f32x4 d[5];
+
+        // TDF-II 双二阶，处理一帧后系数前进一步
+        f32x4 step(f32x4 x, f32x4& z1, f32x4& z2) {
+            f32x4 y = c[0] * x + z1;
+            z1 = c[1] * x - c[3] * y + z2;
+            z2 = c[2] * x - c[4] * y;
+            for (int k = 0; k < 5; k++) c[k] += d[k];
+            return y;
+        }
+    };
+
+    // 通道 0/1 用频段 lo，通道 2/3 用频段 hi，hi 的起点比 lo 晚 lag 帧
+    static Ramp makeRamp(const Band& lo, const Band& hi, float inv, float lag) {
+        const float Coeffs::*fields[5] = {&Coeffs::b0, &Coeffs::b1, &Coeffs::b2, &Coeffs::a1,
+                                          &Coeffs::a2};
+        Ramp r;
+        for (int k = 0; k < 5; k++) {
+            float lo_cur = lo.current.*fields[k];
+            float hi_cur = hi.current.*fields[k];
+            float lo_d = (lo.target.*fields[k] - lo_cur) * inv;
+            float hi_d = (hi.target.*fields[k] - hi_cur) * inv;
+            hi_cur -= lag * hi_d;
+            r.c[k] = f32x4{lo_cur, lo_cur, hi_cur, hi_cur};
+            r.d[k] = f32x4{lo_d, lo_d, hi_d, hi_d};
+        }
+        return r;
+    }
+
+    static f32x4 load4(const float* ptr) {
+        f32x4 v;
+        std::memcpy(&v, ptr, sizeof(v));
+        return v;
+    }
+
+    static void store4(float* ptr, f32x4 v) { std::memcpy(ptr, &v, sizeof(v)); }
+
+    // 交错立体声：两个频段拼进一个向量，通道 0/1 是频段 a，通道 2/3 是晚一帧的频段 b，
+    // a 这一步的输出就是 b 下一步的输入。每次迭代整块读入两帧、整块写出两帧
+    static void processStereoPair(float* data, int frames, const Band& a, const Band& b,
+                                  f32x4* za, f32x4* zb) {
+        const f32x4 zero = {0, 0, 0, 0};
+        Ramp r = makeRamp(a, b, 1.0f / frames, 1.0f);
+        f32x4 z1 = __builtin_shufflevector(za[0], zb[0], 0, 1, 4, 5);
+        f32x4 z2 = __builtin_shufflevector(za[1], zb[1], 0, 1, 4, 5);
+
+        // 第 0 帧只经过 a，b 的状态不变
+        f32x4 keep1 = z1, keep2 = z2;
+        f32x4 prev = r.step(f32x4{data[0], data[1], 0, 0}, z1, z2);
+        z1 = __builtin_shufflevector(z1, keep1, 0, 1, 6, 7);
+        z2 = __builtin_shufflevector(z2, keep2, 0, 1, 6, 7);
+
+        // 读入第 i、i+1 帧，写出第 i-1、i 帧
+        int i = 1;
+        for (; i + 1 < frames; i += 2) {
+            f32x4 v = load4(data + i * 2);
+            f32x4 y1 = r.step(__builtin_shufflevector(v, prev, 0, 1, 4, 5), z1, z2);
+            f32x4 y2 = r.step(__builtin_shufflevector(v, y1, 2, 3, 4, 5), z1, z2);
+            store4(data + (i - 1) * 2, __builtin_shufflevector(y1, y2, 2, 3, 6, 7));
+            prev = y2;
+        }
+        if (i < frames) {
+            f32x4 y = r.step(f32x4{data[i * 2], data[i * 2 + 1], prev[0], prev[1]}, z1, z2);
+            data[(i - 1) * 2] = y[2];
+            data[(i - 1) * 2 + 1] = y[3];
+            prev = y;
+        }
+
+        // 最后一帧只经过 b，a 的状态不变
+        keep1 = z1;
+        keep2 = z2;
+        f32x4 y = r.step(f32x4{0, 0, prev[0], prev[1]}, z1, z2);
+        data[(frames - 1) * 2] = y[2];
+        data[(frames - 1) * 2 + 1] = y[3];
+        z1 = __builtin_shufflevector(keep1, z1, 0, 1, 6, 7);
+        z2 = __builtin_shufflevector(keep2, z2, 0, 1, 6, 7);
+
+        za[0] = __builtin_shufflevector(z1, zero, 0, 1, 4, 5);
+        za[1] = __builtin_shufflevector(z2, zero, 0, 1, 4, 5);
+        zb[0] = __builtin_shufflevector(z1, zero, 2, 3, 4, 5);
+        zb[1] = __builtin_shufflevector(z2, zero, 2, 3, 4, 5);
+    }
+
+    void processBands(float* data, int frames) {
+        int band_ids[kMaxBands];
+        int band_count = 0;
+        for (int b = 0; b < kMaxBands; b++) {
+            if (m_bands[b].enabled) band_ids[band_count++] = b;
+        }
+        if (band_count == 0) return;
+
+        const float inv = 1.0f / frames;
+
+        if (m_channels == 2) {
+            // 频段两两配对占满 4 个通道，落单的和直通配对
+            const Band passthrough;
+            f32x4 spare[2] = {};
+            for (int k = 0; k < band_count; k += 2) {
+                int a = band_ids[k];
+                bool paired = k + 1 < band_count;
+                f32x4 za[2] = {m_z1[a], m_z2[a]};
+                f32x4 zb[2] = {spare[0], spare[1]};
+                if (paired) {
+                    zb[0] = m_z1[band_ids[k + 1]];
+                    zb[1] = m_z2[band_ids[k + 1]];
+                }
+                processStereoPair(data, frames, m_bands[a],
+                                  paired ? m_bands[band_ids[k + 1]] : passthrough, za, zb);
+                m_z1[a] = za[0];
+                m_z2[a] = za[1];
+                if (paired) {
+                    m_z1[band_ids[k + 1]] = zb[0];
+                    m_z2[band_ids[k + 1]] = zb[1];
+                }
+            }
+        } else {
+            for (int g = 0; g < m_groups; g++) {
+                int lane_count = std::min(4, m_channels - g * 4);
+                float* base = data + g * 4;
+
+                for (int k = 0; k < band_count; k++) {
+                    Band& band = m_bands[band_ids[k]];
+                    f32x4 z1 = m_z1[band_ids[k] * m_groups + g];
+                    f32x4 z2 = m_z2[band_ids[k] * m_groups + g];
+                    Ramp r = makeRamp(band, band, inv, 0.0f);
+
+                    float* ptr = base;
+                    if (lane_count == 4) {
+                        for (int i = 0; i < frames; i++, ptr += m_channels) {
+                            store4(ptr, r.step(load4(ptr), z1, z2));
+                        }
+                    } else {
+                        for (int i = 0; i < frames; i++, ptr += m_channels) {
+                            f32x4 x = {0, 0, 0, 0};
+                            for (int l = 0; l < lane_count; l++) x[l] = ptr[l];
+                            f32x4 y = r.step(x, z1, z2);
+                            for (int l = 0; l < lane_count; l++) ptr[l] = y[l];
+                        }
+                    }
+
+                    m_z1[band_ids[k] * m_groups + g] = z1;
+                    m_z2[band_ids[k] * m_groups + g] = z2;
+                }
+            }
+        }
+
+        for (int k = 0; k < band_count; k++) {
+            Band& band = m_bands[band_ids[k]];
+            band.current = band.target;
+            if (band.disabling) {
+                band.enabled = false;
+                band.disabling = false;
+            }
+        }
+    }
+
+    void processLimiter(float* data, int frames) {
+        const int window = m_lookahead + 1;
+
+        for (int i = 0; i < frames; i++) {
+            float* frame_ptr = data + i * m_channels;
+
+            float peak = 0.0f;
+            for (int ch = 0; ch < m_channels; ch++) {
+                peak = std::max(peak, std::fabs(frame_ptr[ch]));
+            }
+            float required = peak > m_threshold ? m_threshold / peak : 1.0f;
+
+            // 先移出窗口外的队首，再弹出队尾不小于当前增益的项，队列最多 window 项
+            if (m_window_size > 0 && m_window_frames[m_window_head] <= m_frame_index - window) {
+                m_window_head = (m_window_head + 1) % window;
+                m_window_size--;
+            }
+            while (m_window_size > 0 &&
+                   m_window_gains[(m_window_head + m_window_size - 1) % window] >= required) {
+                m_window_size--;
+            }
+            int tail = (m_window_head + m_window_size) % window;
+            m_window_frames[tail] = m_frame_index;
+            m_window_gains[tail] = required;
+            m_window_size++;
+            m_frame_index++;
+
+            float held = m_window_gains[m_window_head];
+            float coef = held < m_envelope ? m_attack_coef : m_release_coef;
+            m_envelope += (held - m_envelope) * coef;
+
+            // 延迟线输出 lookahead 帧之前的样本，当前帧写入同一位置
+            float* delayed = m_delay.data() + m_delay_pos * m_channels;
+            for (int ch = 0; ch < m_channels; ch++) {
+                float out = delayed[ch] * m_envelope;
+                delayed[ch] = frame_ptr[ch];
+                frame_ptr[ch] = std::max(-m_threshold, std::min(m_threshold, out));
+            }
+            m_delay_pos = (m_delay_pos + 1) % m_lookahead;
+        }
+    }
+
+   public:
+    // 采样率或声道数变化时重新计算所有系数，已有的参数保持不变
+    void configure(int sample_rate, int channels) {
+        m_sample_rate = sample_rate;
+        m_channels = channels;
+        m_groups = (channels + 3) / 4;
+        m_z1.assign(kMaxBands * m_groups, f32x4{0, 0, 0, 0});
+        m_z2.assign(kMaxBands * m_groups, f32x4{0, 0, 0, 0});
+
+        for (auto& band : m_bands) {
+            if (band.enabled && !band.disabling) {
+                band.target = design(band.type, m_sample_rate, band.freq, band.gain_db, band.q);
+            }
+        }
+
+        m_lookahead = 0;
+        setLimiter(m_limiter_enabled, m_threshold_db, m_lookahead_ms, m_release_ms);
+        reset();
+    }
+
+    bool setBand(int index, EqFilterType type, double freq, double gain_db, double q) {
+        if (index < 0 || index >= kMaxBands) return false;
+
+        Band& band = m_bands[index];
+        band.type = type;
+        band.freq = freq;
+        band.gain_db = gain_db;
+        band.q = q;
+        band.disabling = false;
+        if (m_sample_rate > 0) band.target = design(type, m_sample_rate, freq, gain_db, q);
+        if (!band.enabled) {
+            // 新启用的频段从直通开始过渡
+            band.current = Coeffs();
+            band.enabled = true;
+        }
+        return true;
+    }
+
+    void disableBand(int index) {
+        if (index < 0 || index >= kMaxBands || !m_bands[index].enabled) return;
+        m_bands[index].target = Coeffs();
+        m_bands[index].disabling = true;
+    }
+
+    void clearBands() {
+        for (auto& band : m_bands) band = Band();
+        std::fill(m_z1.begin(), m_z1.end(), f32x4{0, 0, 0, 0});
+        std::fill(m_z2.begin(), m_z2.end(), f32x4{0, 0, 0, 0});
+    }
+
+    void setLimiter(bool enabled, double threshold_db, double lookahead_ms, double release_ms) {
+        m_limiter_enabled = enabled;
+        m_threshold_db = threshold_db;
+        m_lookahead_ms = lookahead_ms;
+        m_release_ms = release_ms;
+        m_threshold = (float)std::pow(10.0, std::min(0.0, threshold_db) / 20.0);
+
+        int lookahead = std::max(1, (int)(lookahead_ms * m_sample_rate / 1000.0));
+        if (lookahead != m_lookahead) {
+            m_lookahead = lookahead;
+            m_delay.assign(lookahead * std::max(1, m_channels), 0.0f);
+            m_window_frames.assign(lookahead + 1, 0);
+            m_window_gains.assign(lookahead + 1, 1.0f);
+            reset();
+        }
+
+        // 攻击在前瞻窗口内收敛到 0.1%，释放按给定时间常数
+        m_attack_coef = 1.0f - (float)std::exp(std::log(0.001) / lookahead);
+        double release = std::max(1.0, release_ms * m_sample_rate / 1000.0);
+        m_release_coef = 1.0f - (float)std::exp(-1.0 / release);
+        m_tail_frames = latency();
+    }
+
+    bool active() const {
+        if (m_limiter_enabled) return true;
+        for (const auto& band : m_bands) {
+            if (band.enabled) return true;
+        }
+        return false;
+    }
+
+    int latency() const { return m_limiter_enabled ? m_lookahead : 0; }
+
+    void reset() {
+        std::fill(m_z1.begin(), m_z1.end(), f32x4{0, 0, 0, 0});
+        std::fill(m_z2.begin(), m_z2.end(), f32x4{0, 0, 0, 0});
+        for (auto& band : m_bands) band.current = band.target;
+        std::fill(m_delay.begin(), m_delay.end(), 0.0f);
+        m_delay_pos = 0;
+        m_window_head = 0;
+        m_window_size = 0;
+        m_frame_index = 0;
+        m_envelope = 1.0f;
+        m_tail_frames = latency();
+    }
+
+    // 就地处理交错的 float 数据
+    void process(float* data, int frames) {
+        if (frames <= 0 || m_channels <= 0) return;
+        processBands(data, frames);
+        if (m_limiter_enabled) processLimiter(data, frames);
+    }
+
+    // 流结束时送入静音，把延迟线中剩余的样本推出来，返回写入 out 的帧数
+    int drain(float* out, int max_frames) {
+        if (!m_limiter_enabled) return 0;
+        int frames = std::min(m_tail_frames, max_frames);
+        if (frames <= 0) return 0;
+        std::fill(out, out + frames * m_channels, 0.0f);
+        processLimiter(out, frames);
+        m_tail_frames -= frames;
+        return frames;
+    }
+};
+
+struct SpectrumFrames {
+    // frames × bands 个 dB 值，按帧排列；下次 readChunk 前有效
+    emscripten::val data;
+    // 每帧分析窗末尾相对本 chunk 起点的输出时长（秒）
+    emscripten::val offsets;
+    int frames;
+    int bands;
+};
+
+/**
+ * 解码端的频谱分析：对输出 PCM 的单声道混合加 Hann 窗做实数 FFT，每 hop 个样本一帧，
+ * 按 20 Hz 到奈奎斯特（最高 20 kHz）之间的对数频带聚合为 dB（满幅正弦为 0 dB）。
+ * 实数 FFT 由 N/2 点复数 FFT 加拆分后处理得到，复数蝶形按 f32x4 一次处理 4 组。
+ */
+class SpectrumAnalyzer {
+   public:
+    bool enabled() const { return m_size > 0; }
+    int bands() const { return m_bands; }
+    const std::vector<float>& output() const { return m_out; }
+    const std::vector<float>& offsets() const { return m_offsets; }
+
+    // fftSize 为 0 时关闭；否则须为 64-16384 的 2 的幂
+    bool configure(int fftSize, int hop, int bands, int sampleRate) {
+        if (fftSize == 0) {
+            m_size = 0;
+            m_bands = 0;
+            beginChunk();
+            return true;
+        }
+        if (fftSize < 64 || fftSize > 16384 || (fftSize & (fftSize - 1)) != 0) return false;
+        if (hop <= 0 || bands <= 0 || bands > 256 || sampleRate <= 0) return false;
+
+        m_size = fftSize;
+        m_hop = hop;
+        m_bands = bands;
+        m_sample_rate = sampleRate;
+        int half = fftSize / 2;
+
+        m_window.resize(fftSize);
+        double window_sum = 0.0;
+        for (int i = 0; i < fftSize; i++) {
+            m_window[i] = (float)(0.5 - 0.5 * std::cos(2.0 * M_PI * i / fftSize));
+            window_sum += m_window[i];
+        }
+        m_scale = (float)(2.0 / window_sum);
+        double window_sq = 0.0;
+        for (float w : m_window) window_sq += (double)w * w;
+        m_enbw = (float)(fftSize * window_sq / (window_sum * window_sum));
+
+        int bits = 0;
+        while ((1 << bits) < half) bits++;
+        m_bitrev.resize(half);
+        for (int i = 0; i < half; i++) {
+            int r = 0;
+            for (int b = 0; b < bits; b++) r |= ((i >> b) & 1) << (bits - 1 - b);
+            m_bitrev[i] = r;
+        }
+
+        // 第 h 级（半长 h）的旋转因子存放在 [h, 2h)，同一级连续存放便于向量加载
+        m_tw_re.assign(half, 0.0f);
+        m_tw_im.assign(half, 0.0f);
+        for (int h = 1; h < half; h <<= 1) {
+            for (int j = 0; j < h; j++) {
+                m_tw_re[h + j] = (float)std::cos(M_PI * j / h);
+                m_tw_im[h + j] = (float)-std::sin(M_PI * j / h);
+            }
+        }
+        m_post_re.resize(half);
+        m_post_im.resize(half);
+        for (int k = 0; k < half; k++) {
+            m_post_re[k] = (float)std::cos(2.0 * M_PI * k / fftSize);
+            m_post_im[k] = (float)-std::sin(2.0 * M_PI * k / fftSize);
+        }
+
+        // 频带 [lo, hi) 覆盖的 bin；过窄的低频带退化为最近的单个 bin
+        double fmin = 20.0;
+        double fmax = std::min(20000.0, sampleRate / 2.0);
+        double bin_hz = (double)sampleRate / fftSize;
+        m_band_lo.resize(bands);
+        m_band_hi.resize(bands);
+        for (int b = 0; b < bands; b++) {
+            double f0 = fmin * std::pow(fmax / fmin, (double)b / bands);
+            double f1 = fmin * std::pow(fmax / fmin, (double)(b + 1) / bands);
+            int lo = std::clamp((int)std::ceil(f0 / bin_hz), 1, half);
+            int hi = std::clamp((int)std::ceil(f1 / bin_hz), 1, half);
+            if (hi <= lo) {
+                lo = std::clamp((int)std::lround(std::sqrt(f0 * f1) / bin_hz), 1, half - 1);
+                hi = lo + 1;
+            }
+            m_band_lo[b] = lo;
+            m_band_hi[b] = hi;
+        }
+
+        m_re.resize(half);
+        m_im.resize(half);
+        m_power.resize(half + 1);
+        m_history.assign(fftSize, 0.0f);
+        reset();
+        return true;
+    }
+
+    void reset() {
+        std::fill(m_history.begin(), m_history.end(), 0.0f);
+        m_history_pos = 0;
+        m_since_frame = 0;
+        beginChunk();
+    }
+
+    void beginChunk() {
+        m_out.clear();
+        m_offsets.clear();
+    }
+
+    // 分析一段交错样本，offset 为它在本 chunk 输出中的起始帧
+    void process(const float* samples, int frames, int channels, int offset) {
+        if (!enabled()) return;
+        const float inv = 1.0f / channels;
+        const int mask = m_size - 1;
+        for (int i = 0; i < frames; i++, samples += channels) {
+            float mono = 0.0f;
+            for (int ch = 0; ch < channels; ch++) mono += samples[ch];
+            m_history[m_history_pos] = mono * inv;
+            m_history_pos = (m_history_pos + 1) & mask;
+
+            if (++m_since_frame >= m_hop) {
+                m_since_frame = 0;
+                analyze();
+                m_offsets.push_back((float)(offset + i + 1) / m_sample_rate);
+            }
+        }
+    }
+
+   private:
+    int m_size = 0;
+    int m_hop = 0;
+    int m_bands = 0;
+    int m_sample_rate = 0;
+    float m_scale = 1.0f;
+    // 窗的等效噪声带宽（bin），频带内功率之和除以它后正弦的读数与带宽无关
+    float m_enbw = 1.0f;
+
+    std::vector<float> m_window;
+    std::vector<int> m_bitrev;
+    std::vector<float> m_tw_re, m_tw_im;
+    std::vector<float> m_post_re, m_post_im;
+    std::vector<int> m_band_lo, m_band_hi;
+    std::vector<float> m_re, m_im, m_power;
+
+    // 最近 m_size 个单声道样本的环形缓冲，m_history_pos 指向最旧的样本
+    std::vector<float> m_history;
+    int m_history_pos = 0;
+    int m_since_frame = 0;
+
+    std::vector<float> m_out;
+    std::vector<float> m_offsets;
+
+    void analyze() {
+        const int half = m_size / 2;
+        const int mask = m_size - 1;
+
+        // 按时间顺序展开并加窗：偶数样本作实部、奇数样本作虚部，直接写到位反转位置
+        for (int n = 0; n < half; n++) {
+            int r = m_bitrev[n];
+            m_re[r] = m_history[(m_history_pos + 2 * n) & mask] * m_window[2 * n];
+            m_im[r] = m_history[(m_history_pos + 2 * n + 1) & mask] * m_window[2 * n + 1];
+        }
+
+        fft(half);
+
+        // Z = FFT(偶 + i·奇)，X[k] = E[k] + W^k·O[k]，E/O 由 Z[k] 与 conj(Z[half-k]) 拆出
+        m_power[0] = (m_re[0] + m_im[0]) * (m_re[0] + m_im[0]);
+        m_power[half] = (m_re[0] - m_im[0]) * (m_re[0] - m_im[0]);
+        for (int k = 1; k < half; k++) {
+            float zr = m_re[k], zi = m_im[k];
+            float cr = m_re[half - k], ci = -m_im[half - k];
+            float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+            float or_ = 0.5f * (zi - ci), oi = -0.5f * (zr - cr);
+            float xr = er + m_post_re[k] * or_ - m_post_im[k] * oi;
+            float xi = ei + m_post_re[k] * oi + m_post_im[k] * or_;
+            m_power[k] = xr * xr + xi * xi;
+        }
+
+        for (int b = 0; b < m_bands; b++) {
+            float sum = 0.0f;
+            for (int k = m_band_lo[b]; k < m_band_hi[b]; k++) sum += m_power[k];
+            float amp = std::sqrt(sum / m_enbw) * m_scale;
+            m_out.push_back(amp > 1e-6f ? 20.0f * std::log10(amp) : -120.0f);
+        }
+    }
+
+    // 原位基 2 复数 FFT，输入已按位反转排列
+    void fft(int n) {
+        float* re = m_re.data();
+        float* im = m_im.data();
+        for (int h = 1; h < n; h <<= 1) {
+            const float* wr = m_tw_re.data() + h;
+            const float* wi = m_tw_im.data() + h;
+            for (int s = 0; s < n; s += 2 * h) {
+                float* ar = re + s;
+                float* ai = im + s;
+                float* br = ar + h;
+                float* bi = ai + h;
+                int j = 0;
+                for (; j + 4 <= h; j += 4) {
+                    f32x4 vwr, vwi, var, vai, vbr, vbi;
+                    memcpy(&vwr, wr + j, sizeof(vwr));
+                    memcpy(&vwi, wi + j, sizeof(vwi));
+                    memcpy(&var, ar + j, sizeof(var));
+                    memcpy(&vai, ai + j, sizeof(vai));
+                    memcpy(&vbr, br + j, sizeof(vbr));
+                    memcpy(&vbi, bi + j, sizeof(vbi));
+                    f32x4 tr = vbr * vwr - vbi * vwi;
+                    f32x4 ti = vbr * vwi + vbi * vwr;
+                    f32x4 sum_r = var + tr, sum_i = vai + ti;
+                    f32x4 diff_r = var - tr, diff_i = vai - ti;
+                    memcpy(ar + j, &sum_r, sizeof(sum_r));
+                    memcpy(ai + j, &sum_i, sizeof(sum_i));
+                    memcpy(br + j, &diff_r, sizeof(diff_r));
+                    memcpy(bi + j, &diff_i, sizeof(diff_i));
+                }
+                for (; j < h; j++) {
+                    float tr = br[j] * wr[j] - bi[j] * wi[j];
+                    float ti = br[j] * wi[j] + bi[j] * wr[j];
+                    br[j] = ar[j] - tr;
+                    bi[j] = ai[j] - ti;
+                    ar[j] += tr;
+                    ai[j] += ti;
+                }
+            }
+        }
+    }
+};
+
+struct IOCacheStats {
+    double hits;
+    double misses;
+    double hitBytes;
+    double missBytes;
+    int netSeeks;
+    double cachedBytes;
+};
+
+struct PcmCacheStats {
+    int seekHits;
+    int seekMisses;
+    // 缓存读完后需要重新定位解码器的次数
+    int resyncs;
+    double cachedBytes;
+};
+
+/**
+ * 按固定帧数分块、LRU 淘汰的缓存，每帧 frame_size 个 T。每块只记录一段连续的有效区间
+ * [begin, end)：不连续的写入替换原有内容，与已有区间重叠或相接时只补上缺少的部分。
+ */
+template <typename T>
+class BlockCache {
+   private:
+    struct Block {
+        std::vector<T> data;
+        int begin = 0;
+        int end = 0;
+        std::list<int64_t>::iterator lru;
+    };
+
+    std::unordered_map<int64_t, Block> m_blocks;
+    // 头部为最近使用
+    std::list<int64_t> m_lru;
+
+    int m_block_frames = 0;
+    int m_frame_size = 0;
+    int64_t m_max_bytes = 0;
+    int64_t m_bytes = 0;
+
+    void touch(Block& block) { m_lru.splice(m_lru.begin(), m_lru, block.lru); }
+
+    void evict() {
+        while (m_bytes > m_max_bytes && !m_lru.empty()) {
+            int64_t index = m_lru.back();
+            m_lru.pop_back();
+            m_blocks.erase(index);
+            m_bytes -= blockBytes();
+        }
+    }
+
+    void copyIn(Block& block, int offset, const T* src, int frames) {
+        memcpy(block.data.data() + (size_t)offset * m_frame_size, src,
+               (size_t)frames * m_frame_size * sizeof(T));
+    }
+
+   public:
+    void configure(int block_frames, int frame_size, int64_t max_bytes) {
+        clear();
+        m_block_frames = block_frames;
+        m_frame_size = frame_size;
+        m_max_bytes = std::max<int64_t>(0, max_bytes);
+    }
+
+    void clear() {
+        m_blocks.clear();
+        m_lru.clear();
+        m_bytes = 0;
+    }
+
+    int64_t blockBytes() const { return (int64_t)m_block_frames * m_frame_size * sizeof(T); }
+    bool enabled() const { return m_frame_size > 0 && m_max_bytes >= blockBytes(); }
+    int64_t bytes() const { return m_bytes; }
+
+    // 返回从 pos 开始、在同一块内连续缓存的数据指针，frames 为可用帧数（0 表示未命中）
+    const T* peek(int64_t pos, int& frames) {
+        frames = 0;
+        if (pos < 0 || m_block_frames <= 0) return nullptr;
+
+        int64_t index = pos / m_block_frames;
+        int offset = static_cast<int>(pos % m_block_frames);
+
+        auto it = m_blocks.find(index);
+        if (it == m_blocks.end()) return nullptr;
+
+        Block& block = it->second;
+        if (offset < block.begin || offset >= block.end) return nullptr;
+
+        touch(block);
+        frames = block.end - offset;
+        return block.data.data() + (size_t)offset * m_frame_size;
+    }
+
+    // 写入从 pos 开始的 frames 帧，已缓存的部分保持不变
+    void write(int64_t pos, const T* src, int frames) {
+        if (!enabled() || pos < 0) return;
+
+        while (frames > 0) {
+            int64_t index = pos / m_block_frames;
+            int offset = static_cast<int>(pos % m_block_frames);
+            int n = std::min(m_block_frames - offset, frames);
+
+            auto it = m_blocks.find(index);
+            if (it == m_blocks.end()) {
+                m_lru.push_front(index);
+                Block& block = m_blocks[index];
+                block.data.resize((size_t)m_block_frames * m_frame_size);
+                block.lru = m_lru.begin();
+                m_bytes += blockBytes();
+                it = m_blocks.find(index);
+            }
+
+            Block& block = it->second;
+            if (block.begin == block.end || offset > block.end || offset + n < block.begin) {
+                copyIn(block, offset, src, n);
+                block.begin = offset;
+                block.end = offset + n;
+            } else {
+                if (offset < block.begin) copyIn(block, offset, src, block.begin - offset);
+                if (offset + n > block.end) {
+                    copyIn(block, block.end, src + (size_t)(block.end - offset) * m_frame_size,
+                           offset + n - block.end);
+                }
+                block.begin = std::min(block.begin, offset);
+                block.end = std::max(block.end, offset + n);
+            }
+            touch(block);
+
+            pos += n;
+            src += (size_t)n * m_frame_size;
+            frames -= n;
+        }
+
+        evict();
+    }
+};
+
+// 位于 AVIO 回调与 JS 网络读取之间的字节缓存，同一位置的字节不会变化
+class ByteBlockCache : public BlockCache<uint8_t> {
+   public:
+    ByteBlockCache() { configure(64 * 1024, 8 * 1024 * 1024); }
+
+    void configure(int block_size, int64_t max_bytes) {
+        BlockCache::configure(std::max(4096, block_size), 1, max_bytes);
+    }
+
+    // 从 pos 开始复制缓存中连续命中的字节，返回复制的字节数
+    int read(int64_t pos, uint8_t* dst, int size) {
+        int copied = 0;
+        int available = 0;
+        while (copied < size) {
+            const uint8_t* data = peek(pos, available);
+            if (!data) break;
+            int n = std::min(available, size - copied);
+            memcpy(dst + copied, data, n);
+            copied += n;
+            pos += n;
+        }
+        return copied;
+    }
+};
+
+/**
+ * 已解码 PCM 的块缓存（交错 float，送入静音跳过与 SoundTouch 之前），按源样本序号分块。
+ * 已缓存的样本不会被覆盖：seek 后重新解码的样本可能带有解码器预热的误差。
+ */
+class PcmBlockCache : public BlockCache<float> {
+   public:
+    static constexpr int kBlockFrames = 32768;
+
+    void configure(int channels, int64_t max_bytes) {
+        BlockCache::configure(kBlockFrames, channels, max_bytes);
+    }
+};
+
 struct StreamContext {
     emscripten::val readFn;
     emscripten::val seekFn;
+
+    ByteBlockCache cache;
+
+    // FFmpeg 视角下的读取位置
+    int64_t pos = 0;
+    // JS 网络流当前的位置，与 pos 不一致时读取未命中才需要真正 seek
+    int64_t net_pos = 0;
+    int64_t file_size = -1;
+
+    IOCacheStats stats = {0, 0, 0, 0, 0, 0};
+
+    // ICY：每 icy_metaint 字节音频后插入一个元数据块（1 字节长度 ×16 + 文本），读取时剥离
+    int icy_metaint = 0;
+    // 距下一个元数据块还有多少字节音频
+    int icy_audio_left = 0;
+    // 正在读取的元数据块剩余字节，-1 表示不在块内
+    int icy_meta_left = -1;
+    std::string icy_meta;
+    // 剥离后的字节位置，及从该位置开始生效的元数据
+    std::deque<std::pair<int64_t, std::string>> icy_events;
 };
 
 static int read_packet_wrapper(void* opaque, uint8_t* buf, int buf_size) {
     StreamContext* ctx = (StreamContext*)opaque;
+
+    int cached = ctx->cache.read(ctx->pos, buf, buf_size);
+    if (cached > 0) {
+        ctx->pos += cached;
+        ctx->stats.hits++;
+        ctx->stats.hitBytes += cached;
+        return cached;
+    }
+
+    if (ctx->net_pos != ctx->pos) {
+        ctx->net_pos = (int64_t)ctx->seekFn((double)ctx->pos, SEEK_SET).as<double>();
+        ctx->stats.netSeeks++;
+        if (ctx->net_pos < 0) return AVERROR(EIO);
+        ctx->pos = ctx->net_pos;
+    }
+
     int bytesRead = ctx->readFn(reinterpret_cast<uintptr_t>(buf), buf_size).as<int>();
-    return bytesRead == 0 ? AVERROR_EOF : bytesRead;
+    if (bytesRead <= 0) return bytesRead == 0 ? AVERROR_EOF : bytesRead;
+
+    ctx->cache.write(ctx->pos, buf, bytesRead);
+    ctx->pos += bytesRead;
+    ctx->net_pos = ctx->pos;
+    ctx->stats.misses++;
+    ctx->stats.missBytes += bytesRead;
+    return bytesRead;
+}
+
+// 从 ICY 元数据（StreamTitle='...';StreamUrl='...';）中取出 StreamTitle
+static std::string icyStreamTitle(const std::string& meta) {
+    const std::string key = "StreamTitle='";
+    size_t begin = meta.find(key);
+    if (begin == std::string::npos) return "";
+    begin += key.size();
+    size_t end = meta.find("';", begin);
+    return meta.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+/**
+ * 直播流的读取回调：不经过块缓存（不会回读），并剥离 ICY 元数据块。
+ * ctx->pos 统计的是剥离后的字节数，与解复用得到的 AVPacket::pos 一致。
+ */
+static int read_live_wrapper(void* opaque, uint8_t* buf, int buf_size) {
+    StreamContext* ctx = (StreamContext*)opaque;
+
+    while (true) {
+        int n = ctx->readFn(reinterpret_cast<uintptr_t>(buf), buf_size).as<int>();
+        if (n <= 0) return n == 0 ? AVERROR_EOF : n;
+        if (ctx->icy_metaint <= 0) {
+            ctx->pos += n;
+            return n;
+        }
+
+        int out = 0;
+        for (int i = 0; i < n;) {
+            if (ctx->icy_meta_left < 0 && ctx->icy_audio_left > 0) {
+                int take = std::min(n - i, ctx->icy_audio_left);
+                memmove(buf + out, buf + i, take);
+                out += take;
+                i += take;
+                ctx->icy_audio_left -= take;
+                continue;
+            }
+
+            if (ctx->icy_meta_left < 0) {
+                ctx->icy_meta_left = buf[i++] * 16;
+                ctx->icy_meta.clear();
+            } else {
+                int take = std::min(n - i, ctx->icy_meta_left);
+                ctx->icy_meta.append(reinterpret_cast<const char*>(buf + i), take);
+                i += take;
+                ctx->icy_meta_left -= take;
+            }
+
+            if (ctx->icy_meta_left == 0) {
+                // 文本以 NUL 填充到 16 字节对齐；长度为 0 的块表示元数据没有变化
+                ctx->icy_meta.resize(strnlen(ctx->icy_meta.c_str(), ctx->icy_meta.size()));
+                if (!ctx->icy_meta.empty()) {
+                    ctx->icy_events.emplace_back(ctx->pos + out, ctx->icy_meta);
+                }
+                ctx->icy_meta_left = -1;
+                ctx->icy_audio_left = ctx->icy_metaint;
+            }
+        }
+
+        ctx->pos += out;
+        if (out > 0) return out;
+    }
 }
 
 static int64_t seek_wrapper(void* opaque, int64_t offset, int whence) {
     StreamContext* ctx = (StreamContext*)opaque;
-    return (int64_t)ctx->seekFn((double)offset, whence).as<double>();
+
+    if (whence & AVSEEK_SIZE) {
+        if (ctx->file_size < 0) {
+            ctx->file_size = (int64_t)ctx->seekFn((double)offset, whence).as<double>();
+        }
+        return ctx->file_size;
+    }
+
+    int64_t target = offset;
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_CUR:
+            target = ctx->pos + offset;
+            break;
+        case SEEK_END:
+            if (ctx->file_size < 0) {
+                ctx->file_size = (int64_t)ctx->seekFn(0.0, AVSEEK_SIZE).as<double>();
+            }
+            if (ctx->file_size < 0) return AVERROR(ENOSYS);
+            target = ctx->file_size + offset;
+            break;
+    }
+
+    // 超出文件末尾时交给 JS 处理（会回退到安全位置），其余情况延迟到读取未命中时再 seek
+    if (ctx->file_size >= 0 && target >= ctx->file_size) {
+        ctx->net_pos = (int64_t)ctx->seekFn((double)target, SEEK_SET).as<double>();
+        ctx->stats.netSeeks++;
+        if (ctx->net_pos < 0) return ctx->net_pos;
+        ctx->pos = ctx->net_pos;
+        return ctx->pos;
+    }
+
+    ctx->pos = target;
+    return target;
 }
 
 std::string get_error_str(int status) {
@@ -144,517 +1251,4010 @@ class AudioSampleBuffer {
     int linesize() const { return m_linesize; }
 };
 
-class AudioStreamDecoder {
+/**
+ * 已解复用、尚未送入解码器的压缩包队列。
+ * 压缩数据比 PCM 小一到两个数量级，提前缓冲它可以让解码在网络读取阻塞时继续进行。
+ */
+class PacketQueue {
    private:
-    FormatCtxPtr format_ctx;
-    CodecCtxPtr codec_ctx;
-    PacketPtr packet;
-    FramePtr frame;
-    SwrCtxPtr swr_ctx;
+    std::deque<AVPacket*> m_packets;
+    int64_t m_bytes = 0;
+    // 以流的 time_base 为单位，只统计带有 duration 的包
+    int64_t m_duration = 0;
 
-    AVIOContext* avio_ctx = nullptr;
-    uint8_t* avio_buffer = nullptr;
-    std::unique_ptr<StreamContext> stream_ctx;
+    int64_t m_max_bytes = 1024 * 1024;
+    double m_max_seconds = 10.0;
 
-    // SoundTouch 实例
-    soundtouch::SoundTouch m_soundTouch;
+   public:
+    PacketQueue() = default;
+    ~PacketQueue() { clear(); }
 
-    // 用于从 SoundTouch 接收交错数据的临时 buffer
-    std::vector<float> m_st_receive_buffer;
+    PacketQueue(const PacketQueue&) = delete;
+    PacketQueue& operator=(const PacketQueue&) = delete;
 
-    AudioSampleBuffer resample_buffer;
+    void setLimits(int64_t max_bytes, double max_seconds) {
+        m_max_bytes = max_bytes;
+        m_max_seconds = max_seconds;
+    }
 
-    int audio_stream_index = -1;
-    bool initialized = false;
+    // 接管 src 的引用，src 会被重置为空包
+    bool push(AVPacket* src) {
+        AVPacket* pkt = av_packet_alloc();
+        if (!pkt) return false;
+        av_packet_move_ref(pkt, src);
 
-    std::vector<float> pcm_buffer;
+        m_bytes += pkt->size;
+        if (pkt->duration > 0) m_duration += pkt->duration;
+        m_packets.push_back(pkt);
+        return true;
+    }
 
-    // 用于存储交错的 Int16 数据
-    std::vector<int16_t> m_s16_output;
+    // 把队首的包移动到 dst，队列为空时返回 false
+    bool pop(AVPacket* dst) {
+        if (m_packets.empty()) return false;
 
-    // 用于暂存每个通道的 Planar 数据
-    std::vector<std::vector<float>> m_staging_buffers;
-    // 用于最终输出的交错或拼接后的数据
-    std::vector<float> m_pcm_output;
+        AVPacket* pkt = m_packets.front();
+        m_packets.pop_front();
 
-    // 下一帧预期的 PTS ，基于 time_base
-    int64_t m_next_pts = AV_NOPTS_VALUE;
-    // 当前流的时间基
-    AVRational m_time_base = {1, 1};
+        m_bytes -= pkt->size;
+        if (pkt->duration > 0) m_duration -= pkt->duration;
 
-    double m_current_tempo = 1.0;
+        av_packet_move_ref(dst, pkt);
+        av_packet_free(&pkt);
+        return true;
+    }
+
+    void clear() {
+        for (AVPacket* pkt : m_packets) {
+            av_packet_free(&pkt);
+        }
+        m_packets.clear();
+        m_bytes = 0;
+        m_duration = 0;
+    }
+
+    bool full(AVRational time_base) const {
+        return m_bytes >= m_max_bytes || durationSeconds(time_base) >= m_max_seconds;
+    }
+
+    // 丢弃队首的包
+    void dropFront() {
+        AVPacket* pkt = m_packets.front();
+        m_packets.pop_front();
+        m_bytes -= pkt->size;
+        if (pkt->duration > 0) m_duration -= pkt->duration;
+        av_packet_free(&pkt);
+    }
+
+    bool empty() const { return m_packets.empty(); }
+    int size() const { return static_cast<int>(m_packets.size()); }
+    int64_t bytes() const { return m_bytes; }
+    double durationSeconds(AVRational time_base) const { return m_duration * av_q2d(time_base); }
+};
+
+/**
+ * 跳过静音：连续静音超过 min_silence 时，只保留首尾各 keep/2 的静音，
+ * 中间丢弃，并在剪切点用等功率交叉淡化衔接。输出按源时间分段，供时间戳映射使用。
+ */
+class SilenceSkipper {
+   public:
+    struct Segment {
+        int offset;  // 在 output() 中的起始帧
+        int count;
+        double source_time;
+    };
+
+   private:
+    bool m_enabled = false;
+    int m_sample_rate = 0;
+    int m_channels = 0;
+
+    double m_threshold_db = -50.0;
+    double m_min_silence_ms = 500.0;
+    double m_keep_ms = 200.0;
+    double m_crossfade_ms = 10.0;
+
+    float m_threshold = 0.0f;
+    int64_t m_min_frames = 0;
+    int m_head_keep = 0;
+    int m_tail_keep = 0;
+    int m_crossfade = 0;
+
+    int64_t m_run = 0;
+    bool m_skipping = false;
+
+    // 尚未确定是否要丢弃的静音
+    std::vector<float> m_pending;
+    double m_pending_time = 0.0;
+
+    // 保留头部之后紧接着的几帧，用于和尾部交叉淡化
+    std::vector<float> m_fade;
+
+    // 跳过期间最近的 m_tail_keep 帧静音（环形）
+    std::vector<float> m_tail;
+    int m_tail_pos = 0;
+    int m_tail_count = 0;
+    double m_last_time = 0.0;
+
+    std::vector<float> m_out;
+    std::vector<Segment> m_segments;
+
+    double m_skipped_seconds = 0.0;
+
+    void emit(const float* frames, int count, double source_time) {
+        if (count <= 0) return;
+        int offset = static_cast<int>(m_out.size() / m_channels);
+        m_out.insert(m_out.end(), frames, frames + count * m_channels);
+
+        if (!m_segments.empty()) {
+            Segment& last = m_segments.back();
+            double expected = last.source_time + (double)last.count / m_sample_rate;
+            if (std::fabs(expected - source_time) < 0.5 / m_sample_rate) {
+                last.count += count;
+                return;
+            }
+        }
+        m_segments.push_back({offset, count, source_time});
+    }
+
+    // 把以毫秒为单位的参数换算成当前采样率下的帧数
+    void applyParams() {
+        m_threshold = (float)std::pow(10.0, m_threshold_db / 20.0);
+        m_min_frames = std::max<int64_t>(1, (int64_t)(m_min_silence_ms * m_sample_rate / 1000.0));
+
+        int keep = std::max(0, (int)(m_keep_ms * m_sample_rate / 1000.0));
+        keep = (int)std::min<int64_t>(keep, m_min_frames);
+        m_head_keep = keep / 2;
+        m_tail_keep = keep - m_head_keep;
+
+        int crossfade = std::max(0, (int)(m_crossfade_ms * m_sample_rate / 1000.0));
+        m_crossfade = std::min(m_tail_keep, crossfade);
+        reset();
+    }
+
+    void pushTail(const float* frame, double time) {
+        if (m_tail_keep <= 0) return;
+        std::copy(frame, frame + m_channels, m_tail.begin() + m_tail_pos * m_channels);
+        m_tail_pos = (m_tail_pos + 1) % m_tail_keep;
+        m_tail_count = std::min(m_tail_count + 1, m_tail_keep);
+        m_last_time = time;
+    }
+
+    void enterSkip() {
+        int pending_frames = static_cast<int>(m_pending.size() / m_channels);
+        int head = std::min(m_head_keep, pending_frames);
+        emit(m_pending.data(), head, m_pending_time);
+
+        int fade = std::min(m_crossfade, pending_frames - head);
+        m_fade.assign(m_pending.begin() + head * m_channels,
+                      m_pending.begin() + (head + fade) * m_channels);
+
+        m_tail_pos = 0;
+        m_tail_count = 0;
+        for (int i = head; i < pending_frames; i++) {
+            pushTail(m_pending.data() + i * m_channels,
+                     m_pending_time + (double)i / m_sample_rate);
+        }
+
+        m_skipped_seconds += (double)(pending_frames - head) / m_sample_rate;
+        m_pending.clear();
+        m_skipping = true;
+    }
+
+    void leaveSkip() {
+        int count = m_tail_count;
+        double tail_time = m_last_time - (double)(count - 1) / m_sample_rate;
+
+        std::vector<float> tail(count * m_channels);
+        int start = (m_tail_pos - count + m_tail_keep) % std::max(1, m_tail_keep);
+        for (int i = 0; i < count; i++) {
+            int src = (start + i) % m_tail_keep;
+            std::copy(m_tail.begin() + src * m_channels, m_tail.begin() + (src + 1) * m_channels,
+                      tail.begin() + i * m_channels);
+        }
+
+        int fade = std::min<int>(static_cast<int>(m_fade.size() / m_channels), count);
+        for (int i = 0; i < fade; i++) {
+            float w = (i + 0.5f) / fade;
+            float gain_in = std::sqrt(w);
+            float gain_out = std::sqrt(1.0f - w);
+            for (int ch = 0; ch < m_channels; ch++) {
+                float& v = tail[i * m_channels + ch];
+                v = v * gain_in + m_fade[i * m_channels + ch] * gain_out;
+            }
+        }
+
+        // 保留的尾部已经计入了 enterSkip/跳过期间的丢弃量，这里把它扣回来
+        m_skipped_seconds -= (double)count / m_sample_rate;
+        emit(tail.data(), count, tail_time);
+
+        m_fade.clear();
+        m_tail_count = 0;
+        m_skipping = false;
+    }
+
+   public:
+    void configure(int sample_rate, int channels) {
+        m_sample_rate = sample_rate;
+        m_channels = channels;
+        applyParams();
+    }
+
+    void setParams(bool enabled, double threshold_db, double min_silence_ms, double keep_ms,
+                   double crossfade_ms) {
+        m_enabled = enabled;
+        m_threshold_db = threshold_db;
+        m_min_silence_ms = min_silence_ms;
+        m_keep_ms = keep_ms;
+        m_crossfade_ms = crossfade_ms;
+        applyParams();
+    }
+
+    bool enabled() const { return m_enabled && m_channels > 0 && m_sample_rate > 0; }
+    double skippedSeconds() const { return m_skipped_seconds; }
+
+    void reset() {
+        m_run = 0;
+        m_skipping = false;
+        m_pending.clear();
+        m_fade.clear();
+        m_tail.assign(std::max(1, m_tail_keep) * std::max(1, m_channels), 0.0f);
+        m_tail_pos = 0;
+        m_tail_count = 0;
+        m_out.clear();
+        m_segments.clear();
+    }
+
+    // 处理一段交错数据，结果通过 output()/segments() 取出，下次调用前有效
+    void process(const float* in, int frames, double source_time) {
+        m_out.clear();
+        m_segments.clear();
+
+        int run_start = -1;  // 连续的有声帧直接整段输出
+        for (int i = 0; i < frames; i++) {
+            const float* frame = in + i * m_channels;
+            double t = source_time + (double)i / m_sample_rate;
+
+            float peak = 0.0f;
+            for (int ch = 0; ch < m_channels; ch++) peak = std::max(peak, std::fabs(frame[ch]));
+            bool silent = peak < m_threshold;
+
+            if (!silent) {
+                if (m_skipping) leaveSkip();
+                if (!m_pending.empty()) {
+                    emit(m_pending.data(), static_cast<int>(m_pending.size() / m_channels),
+                         m_pending_time);
+                    m_pending.clear();
+                }
+                m_run = 0;
+                if (run_start < 0) run_start = i;
+                continue;
+            }
+
+            if (run_start >= 0) {
+                emit(in + run_start * m_channels, i - run_start,
+                     source_time + (double)run_start / m_sample_rate);
+                run_start = -1;
+            }
+
+            m_run++;
+            if (m_skipping) {
+                pushTail(frame, t);
+                m_skipped_seconds += 1.0 / m_sample_rate;
+                continue;
+            }
+
+            if (m_pending.empty()) m_pending_time = t;
+            m_pending.insert(m_pending.end(), frame, frame + m_channels);
+            if (m_run >= m_min_frames) enterSkip();
+        }
+
+        if (run_start >= 0) {
+            emit(in + run_start * m_channels, frames - run_start,
+                 source_time + (double)run_start / m_sample_rate);
+        }
+    }
+
+    // 流结束：输出仍在等待判断的静音和保留的尾部
+    void flush() {
+        m_out.clear();
+        m_segments.clear();
+        if (m_skipping) leaveSkip();
+        if (!m_pending.empty()) {
+            emit(m_pending.data(), static_cast<int>(m_pending.size() / m_channels),
+                 m_pending_time);
+            m_pending.clear();
+        }
+        m_run = 0;
+    }
+
+    const float* output() const { return m_out.data(); }
+    const std::vector<Segment>& segments() const { return m_segments; }
+};
+
+/**
+ * varispeed：可变比例的三次（Catmull-Rom）插值重采样，音调随速度变化（磁带/唱盘效果）。
+ * 只有插值，没有 TDStretch 的互相关搜索和重叠相加。比例变化在 kRampMs 内线性过渡，
+ * 每个输出样本的源位置都精确已知。加速时不做抗混叠滤波。
+ */
+class VarispeedResampler {
+   private:
+    static constexpr double kRampMs = 50.0;
+
+    int m_channels = 0;
+    int m_ramp_frames = 0;
+
+    // 交错输入，首帧是累计输入中的第 m_base 帧
+    std::vector<float> m_input;
+    int64_t m_base = 0;
+    int64_t m_total = 0;
+    // flush 后真实输入的帧数，之后补了几帧 0 供插值
+    int64_t m_end = -1;
+
+    // 下一个输出样本在累计输入中的位置
+    double m_pos = 0.0;
+    // 每个输出样本推进的输入帧数
+    double m_ratio = 1.0;
+    double m_target = 1.0;
+    double m_step = 0.0;
+    int m_ramp_left = 0;
+
+    // 插值需要 floor(pos) 之后的两帧
+    int64_t limit() const { return m_end >= 0 ? m_end : m_total - 2; }
+
+    const float* frameAt(int64_t index) const {
+        index = std::max(m_base, std::min(index, m_total - 1));
+        return m_input.data() + (index - m_base) * m_channels;
+    }
+
+   public:
+    void configure(int sampleRate, int channels) {
+        m_channels = channels;
+        m_ramp_frames = std::max(1, (int)(sampleRate * kRampMs / 1000.0));
+        clear();
+    }
+
+    // 没有待输出的样本时直接生效，否则从当前比例线性过渡
+    void setRatio(double ratio) {
+        if (ratio <= 0) return;
+        m_target = ratio;
+        if (m_total == 0) {
+            m_ratio = ratio;
+            m_ramp_left = 0;
+            return;
+        }
+        m_ramp_left = m_ramp_frames;
+        m_step = (m_target - m_ratio) / m_ramp_left;
+    }
+
+    double ratio() const { return m_ratio; }
+    double position() const { return m_pos; }
+
+    void putSamples(const float* samples, int frames) {
+        if (frames <= 0 || m_channels <= 0) return;
+        if (m_end >= 0) {
+            // flush 之后又有输入（例如循环回绕），去掉补的 0
+            m_input.resize((m_end - m_base) * m_channels);
+            m_total = m_end;
+            m_end = -1;
+        }
+        m_input.insert(m_input.end(), samples, samples + (size_t)frames * m_channels);
+        m_total += frames;
+    }
+
+    int receiveSamples(float* out, int maxFrames) {
+        int produced = 0;
+        int64_t end = limit();
+        const int ch = m_channels;
+
+        while (produced < maxFrames && m_pos < (double)end) {
+            int64_t i = (int64_t)m_pos;
+            float t = (float)(m_pos - i);
+            const float* a = frameAt(i - 1);
+            const float* b = frameAt(i);
+            const float* c = frameAt(i + 1);
+            const float* d = frameAt(i + 2);
+            float* dst = out + (size_t)produced * ch;
+            for (int k = 0; k < ch; k++) {
+                dst[k] = b[k] + 0.5f * t *
+                                    (c[k] - a[k] +
+                                     t * (2.0f * a[k] - 5.0f * b[k] + 4.0f * c[k] - d[k] +
+                                          t * (3.0f * (b[k] - c[k]) + d[k] - a[k])));
+            }
+            produced++;
+
+            m_pos += m_ratio;
+            if (m_ramp_left > 0) {
+                m_ratio = --m_ramp_left == 0 ? m_target : m_ratio + m_step;
+            }
+        }
+
+        // 保留插值需要的前一帧，攒够一半再整体前移，避免每次都搬动
+        int64_t keep = std::max(m_base, std::min((int64_t)m_pos - 1, m_total));
+        if ((keep - m_base) * 2 > m_total - m_base) {
+            m_input.erase(m_input.begin(), m_input.begin() + (keep - m_base) * ch);
+            m_base = keep;
+        }
+        return produced;
+    }
+
+    // 不用更多输入就能产出的样本数（过渡期间为估计值）
+    int numSamples() const {
+        double left = (double)limit() - m_pos;
+        return left > 0 ? std::max(1, (int)(left / m_ratio)) : 0;
+    }
+
+    int numUnprocessedSamples() const {
+        return (int)std::max<int64_t>(0, (m_end >= 0 ? m_end : m_total) - (int64_t)m_pos);
+    }
+
+    // 输入结束：补 0 让最后两帧也能插值输出
+    void flush() {
+        if (m_end >= 0 || m_channels <= 0) return;
+        m_end = m_total;
+        m_input.resize(m_input.size() + 3 * (size_t)m_channels, 0.0f);
+        m_total += 3;
+    }
+
+    void clear() {
+        m_input.clear();
+        m_base = m_total = 0;
+        m_end = -1;
+        m_pos = 0.0;
+        m_ratio = m_target;
+        m_ramp_left = 0;
+    }
+};
+
+/**
+ * SoundTouch 与 varispeed 之间的切换层，接口沿用 SoundTouch 中解码管线用到的部分。
+ * 默认由 SoundTouch 保持音调变速；varispeed 模式下速度由 setTempo 决定，setPitch 不生效。
+ * 切换模式前调用方需要 clear。
+ */
+class TimeStretcher {
+   private:
+    soundtouch::SoundTouch m_soundTouch;
+    VarispeedResampler m_varispeed;
+    bool m_varispeed_on = false;
+    int m_sample_rate = 44100;
+    int m_channels = 0;
+
+   public:
+    void setSampleRate(int sampleRate) {
+        m_sample_rate = sampleRate;
+        m_soundTouch.setSampleRate(sampleRate);
+        m_varispeed.configure(m_sample_rate, m_channels);
+    }
+
+    void setChannels(int channels) {
+        m_channels = channels;
+        m_soundTouch.setChannels(channels);
+        m_varispeed.configure(m_sample_rate, m_channels);
+    }
+
+    void setTempo(double tempo) {
+        m_soundTouch.setTempo(tempo);
+        m_varispeed.setRatio(tempo);
+    }
+
+    void setPitch(double pitch) { m_soundTouch.setPitch(pitch); }
+    void setRate(double rate) { m_soundTouch.setRate(rate); }
+
+    void setVarispeed(bool enabled) { m_varispeed_on = enabled; }
+    bool varispeed() const { return m_varispeed_on; }
+
+    /**
+     * SoundTouch 内部、没有体现在 numUnprocessedSamples / numSamples 中的延迟（输入样本数）。
+     * SETTING_INITIAL_LATENCY 是首次出样前需要送入的样本，它们都留在 TDStretch 的输入 FIFO 中，
+     * 已按未处理样本计入；没有计入的是每段在 seek window 内搜索最佳重叠位置的偏移，
+     * 输出平均比输入 FIFO 头部晚半个 seek window（SoundTouch 首段也按 0.5 * seekLength 补偿）。
+     */
+    double hiddenLatency() {
+        if (m_varispeed_on) return 0.0;
+        int initial = m_soundTouch.getSetting(SETTING_INITIAL_LATENCY);
+        int seek_window = m_soundTouch.getSetting(SETTING_SEEKWINDOW_MS) * m_sample_rate / 1000;
+        return std::min(0.5 * seek_window, (double)initial);
+    }
+    // varispeed 模式下一个输出样本在累计输入中的精确位置
+    double varispeedPosition() const { return m_varispeed.position(); }
+
+    // 输出/输入的样本数之比
+    double getInputOutputSampleRatio() {
+        return m_varispeed_on ? 1.0 / m_varispeed.ratio()
+                              : m_soundTouch.getInputOutputSampleRatio();
+    }
+
+    void putSamples(const float* samples, int frames) {
+        if (m_varispeed_on) {
+            m_varispeed.putSamples(samples, frames);
+        } else {
+            m_soundTouch.putSamples(samples, frames);
+        }
+    }
+
+    int receiveSamples(float* out, int maxFrames) {
+        return m_varispeed_on ? m_varispeed.receiveSamples(out, maxFrames)
+                              : (int)m_soundTouch.receiveSamples(out, maxFrames);
+    }
+
+    int numSamples() const {
+        return m_varispeed_on ? m_varispeed.numSamples() : (int)m_soundTouch.numSamples();
+    }
+
+    int numUnprocessedSamples() const {
+        return m_varispeed_on ? m_varispeed.numUnprocessedSamples()
+                              : (int)m_soundTouch.numUnprocessedSamples();
+    }
+
+    void flush() {
+        if (m_varispeed_on) {
+            m_varispeed.flush();
+        } else {
+            m_soundTouch.flush();
+        }
+    }
+
+    void clear() {
+        m_soundTouch.clear();
+        m_varispeed.clear();
+    }
+};
+
+/**
+ * 输出端的样本转换内核。C 为编译期声道数，0 表示运行时声道数的通用实现；
+ * 编译期声道数让内层循环完全展开，立体声另有显式向量化的反交错。
+ */
+template <int C>
+struct ChannelKernels {
+    static int count(int channels) { return C > 0 ? C : channels; }
+
+    // 交错 -> planar，顺带乘上逐帧线性变化的增益，Measure 时统计增益前的平方和与峰值
+    template <bool Measure>
+    static void deinterleave(const float* src, float* const* dst, int frames, int channels,
+                             float gain, float step, double& sum_sq, float& peak) {
+        const int n = count(channels);
+        for (int i = 0; i < frames; i++) {
+            for (int ch = 0; ch < n; ch++) {
+                float v = src[i * n + ch];
+                if (Measure) {
+                    sum_sq += v * v;
+                    peak = std::max(peak, std::fabs(v));
+                }
+                dst[ch][i] = v * gain;
+            }
+            gain += step;
+        }
+    }
+
+    static void interleaveS16(const float* const* src, int16_t* dst, int frames, int channels) {
+        const int n = count(channels);
+        for (int i = 0; i < frames; i++) {
+            for (int ch = 0; ch < n; ch++) {
+                float sample = std::max(-1.0f, std::min(1.0f, src[ch][i]));
+                dst[i * n + ch] = static_cast<int16_t>(sample * 32767.0f);
+            }
+        }
+    }
+
+    static void interleaveS32(const float* const* src, int32_t* dst, int frames, int channels) {
+        const int n = count(channels);
+        for (int i = 0; i < frames; i++) {
+            for (int ch = 0; ch < n; ch++) {
+                double sample = std::max(-1.0f, std::min(1.0f, src[ch][i]));
+                dst[i * n + ch] = static_cast<int32_t>(sample * 2147483647.0);
+            }
+        }
+    }
+
+    static void interleaveF32(const float* const* src, float* dst, int frames, int channels) {
+        const int n = count(channels);
+        for (int i = 0; i < frames; i++) {
+            for (int ch = 0; ch < n; ch++) dst[i * n + ch] = src[ch][i];
+        }
+    }
+};
+
+// 立体声：左右声道各读 4 帧，交织成两个向量写出
+template <>
+void ChannelKernels<2>::interleaveF32(const float* const* src, float* dst, int frames, int) {
+    const float* left = src[0];
+    const float* right = src[1];
+
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        f32x4 l, r;
+        memcpy(&l, left + i, sizeof(l));
+        memcpy(&r, right + i, sizeof(r));
+        f32x4 a = __builtin_shufflevector(l, r, 0, 4, 1, 5);
+        f32x4 b = __builtin_shufflevector(l, r, 2, 6, 3, 7);
+        memcpy(dst + 2 * i, &a, sizeof(a));
+        memcpy(dst + 2 * i + 4, &b, sizeof(b));
+    }
+    for (; i < frames; i++) {
+        dst[2 * i] = left[i];
+        dst[2 * i + 1] = right[i];
+    }
+}
+
+// 立体声：一次读 4 帧（两个向量），用 shuffle 拆成左右声道
+template <>
+template <bool Measure>
+void ChannelKernels<2>::deinterleave(const float* src, float* const* dst, int frames, int,
+                                     float gain, float step, double& sum_sq, float& peak) {
+    float* left = dst[0];
+    float* right = dst[1];
+    f32x4 ramp = {0.0f, step, 2.0f * step, 3.0f * step};
+    f32x4 acc = {0, 0, 0, 0};
+    f32x4 vpeak = {0, 0, 0, 0};
+
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        f32x4 a, b;
+        memcpy(&a, src + 2 * i, sizeof(a));
+        memcpy(&b, src + 2 * i + 4, sizeof(b));
+        f32x4 l = __builtin_shufflevector(a, b, 0, 2, 4, 6);
+        f32x4 r = __builtin_shufflevector(a, b, 1, 3, 5, 7);
+
+        if (Measure) {
+            acc += l * l + r * r;
+            f32x4 al = l < 0 ? -l : l;
+            f32x4 ar = r < 0 ? -r : r;
+            vpeak = vpeak > al ? vpeak : al;
+            vpeak = vpeak > ar ? vpeak : ar;
+        }
+
+        f32x4 g = gain + ramp;
+        l *= g;
+        r *= g;
+        memcpy(left + i, &l, sizeof(l));
+        memcpy(right + i, &r, sizeof(r));
+        gain += 4.0f * step;
+    }
+
+    if (Measure) {
+        sum_sq += (double)acc[0] + acc[1] + acc[2] + acc[3];
+        peak = std::max({peak, vpeak[0], vpeak[1], vpeak[2], vpeak[3]});
+    }
+
+    for (; i < frames; i++) {
+        float l = src[2 * i];
+        float r = src[2 * i + 1];
+        if (Measure) {
+            sum_sq += l * l + r * r;
+            peak = std::max({peak, std::fabs(l), std::fabs(r)});
+        }
+        left[i] = l * gain;
+        right[i] = r * gain;
+        gain += step;
+    }
+}
+
+/**
+ * 交错 S32 -> packed S24（小端，取高 24 位）。每 4 个样本读 16 字节、shuffle 出 12 字节写回，
+ * 写入位置始终落后于读取位置，dst 可以与 src 是同一块内存
+ */
+static void packS24(const int32_t* src, uint8_t* dst, size_t samples) {
+    typedef uint8_t u8x16 __attribute__((vector_size(16)));
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(src);
+
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        u8x16 v;
+        memcpy(&v, in + 4 * i, sizeof(v));
+        u8x16 packed =
+            __builtin_shufflevector(v, v, 1, 2, 3, 5, 6, 7, 9, 10, 11, 13, 14, 15, 0, 0, 0, 0);
+        memcpy(dst + 3 * i, &packed, 12);
+    }
+    for (; i < samples; i++) {
+        dst[3 * i] = in[4 * i + 1];
+        dst[3 * i + 1] = in[4 * i + 2];
+        dst[3 * i + 2] = in[4 * i + 3];
+    }
+}
+
+// 把 count 个样本包装为对应类型的 TypedArray 视图，S24 为 count * 3 字节的 Uint8Array
+static emscripten::val sampleView(SampleFormat format, const void* data, size_t count) {
+    switch (format) {
+        case SampleFormat::InterleavedS16:
+            return emscripten::val(
+                emscripten::memory_view<int16_t>(count, static_cast<const int16_t*>(data)));
+        case SampleFormat::InterleavedS24:
+            return emscripten::val(
+                emscripten::memory_view<uint8_t>(count * 3, static_cast<const uint8_t*>(data)));
+        case SampleFormat::InterleavedS32:
+            return emscripten::val(
+                emscripten::memory_view<int32_t>(count, static_cast<const int32_t*>(data)));
+        default:
+            return emscripten::val(
+                emscripten::memory_view<float>(count, static_cast<const float*>(data)));
+    }
+}
+
+/**
+ * 按声道数选好的一组内核，每次打开音频流时确定一次，解码循环中不再判断声道数
+ */
+struct SampleKernels {
+    using DeinterleaveFn = void (*)(const float*, float* const*, int, int, float, float,
+                                    double&, float&);
+    using InterleaveS16Fn = void (*)(const float* const*, int16_t*, int, int);
+    using InterleaveS32Fn = void (*)(const float* const*, int32_t*, int, int);
+    using InterleaveF32Fn = void (*)(const float* const*, float*, int, int);
+
+    DeinterleaveFn deinterleave;
+    DeinterleaveFn deinterleaveMeasured;
+    InterleaveS16Fn interleaveS16;
+    InterleaveS32Fn interleaveS32;
+    InterleaveF32Fn interleaveF32;
+
+    template <int C>
+    static SampleKernels make() {
+        return {
+            &ChannelKernels<C>::template deinterleave<false>,
+            &ChannelKernels<C>::template deinterleave<true>,
+            &ChannelKernels<C>::interleaveS16,
+            &ChannelKernels<C>::interleaveS32,
+            &ChannelKernels<C>::interleaveF32,
+        };
+    }
+
+    static SampleKernels forChannels(int channels) {
+        switch (channels) {
+            case 1:
+                return make<1>();
+            case 2:
+                return make<2>();
+            case 6:
+                return make<6>();
+            case 8:
+                return make<8>();
+            default:
+                return make<0>();
+        }
+    }
+};
+
+/**
+ * 解析 CUE 表文本，只取第一个 FILE（单一整轨镜像）中的 AUDIO 音轨。
+ * 音轨从 INDEX 01 开始，到下一轨的 INDEX 01 结束（预间隙归入上一轨，与常见播放器一致），
+ * 最后一轨到 duration 结束。mm:ss:ff 的 ff 为 1/75 秒的 CD 帧，在 44.1/48 kHz 等
+ * 常见采样率下换算为整数样本。没有 INDEX 01 的音轨被忽略。
+ */
+std::vector<CueTrack> parseCueSheet(const std::string& text, double duration) {
+    std::vector<CueTrack> tracks;
+    std::string album_performer;
+    bool in_audio_track = false;
+    int files = 0;
+
+    auto unquote = [](const std::string& value) {
+        if (value.empty() || value[0] != '"') {
+            size_t end = value.find_last_not_of(" \t");
+            return end == std::string::npos ? std::string() : value.substr(0, end + 1);
+        }
+        size_t close = value.find('"', 1);
+        return value.substr(1, close == std::string::npos ? std::string::npos : close - 1);
+    };
+
+    size_t pos = text.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string::npos) eol = text.size();
+        std::string line = text.substr(pos, eol - pos);
+        pos = eol + 1;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        size_t begin = line.find_first_not_of(" \t");
+        if (begin == std::string::npos) continue;
+        size_t cmd_end = std::min(line.find_first_of(" \t", begin), line.size());
+        std::string cmd = line.substr(begin, cmd_end - begin);
+        std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+        size_t arg = line.find_first_not_of(" \t", cmd_end);
+        std::string rest = arg == std::string::npos ? "" : line.substr(arg);
+
+        if (cmd == "FILE") {
+            if (++files > 1) break;
+        } else if (cmd == "TRACK") {
+            in_audio_track = rest.find("AUDIO") != std::string::npos;
+            if (in_audio_track) {
+                tracks.push_back({atoi(rest.c_str()), -1.0, 0.0, "", album_performer});
+            }
+        } else if (cmd == "TITLE" && in_audio_track) {
+            tracks.back().title = unquote(rest);
+        } else if (cmd == "PERFORMER") {
+            if (tracks.empty()) {
+                album_performer = unquote(rest);
+            } else if (in_audio_track) {
+                tracks.back().performer = unquote(rest);
+            }
+        } else if (cmd == "INDEX" && in_audio_track) {
+            int index = 0, mm = 0, ss = 0, ff = 0;
+            if (sscanf(rest.c_str(), "%d %d:%d:%d", &index, &mm, &ss, &ff) == 4 && index == 1) {
+                tracks.back().start = mm * 60 + ss + ff / 75.0;
+            }
+        }
+    }
+
+    tracks.erase(std::remove_if(tracks.begin(), tracks.end(),
+                                [](const CueTrack& t) { return t.start < 0; }),
+                 tracks.end());
+    for (size_t i = 0; i < tracks.size(); i++) {
+        tracks[i].end = i + 1 < tracks.size() ? tracks[i + 1].start : duration;
+    }
+    return tracks;
+}
+
+class AudioStreamDecoder {
+   private:
+    FormatCtxPtr format_ctx;
+    CodecCtxPtr codec_ctx;
+    PacketPtr packet;
+    FramePtr frame;
+    SwrCtxPtr swr_ctx;
+
+    AVIOContext* avio_ctx = nullptr;
+    uint8_t* avio_buffer = nullptr;
+    std::unique_ptr<StreamContext> stream_ctx;
+    // 下一次 initStream 使用的块缓存配置
+    int m_io_cache_block_size = 64 * 1024;
+    int64_t m_io_cache_max_bytes = 8 * 1024 * 1024;
+
+    // SoundTouch 或 varispeed 重采样
+    TimeStretcher m_stretch;
+
+    // 用于从 SoundTouch 接收交错数据的临时 buffer
+    std::vector<float> m_st_receive_buffer;
+
+    AudioSampleBuffer resample_buffer;
+
+    int audio_stream_index = -1;
+    bool initialized = false;
+
+    // 预读的压缩包，readChunk 优先从这里取包
+    PacketQueue m_packet_queue;
+    // 解复用已到达文件末尾，此后只消费队列中剩余的包
+    bool m_demux_eof = false;
+    // 预读时遇到的非 EOF 错误，等队列消费完后再报告给 readChunk
+    int m_demux_error = 0;
+
+    std::vector<float> pcm_buffer;
+
+    // 拖动预览时收集的交错样本，以及转为 planar 后的输出
+    std::vector<float> m_scrub_buffer;
+    std::vector<float> m_scrub_output;
+
+    // 用于存储交错的 Int16 数据
+    std::vector<int16_t> m_s16_output;
+    std::vector<int32_t> m_s32_output;
+
+    // 整数直通时尚未输出完的解码帧，m_pt_offset 之前的样本已经输出
+    FramePtr m_pt_frame;
+    int m_pt_offset = 0;
+    double m_pt_time = 0.0;
+
+    double m_tempo = 1.0;
+    double m_pitch = 1.0;
+
+    // 用于暂存每个通道的 Planar 数据
+    std::vector<std::vector<float>> m_staging_buffers;
+    std::vector<float*> m_staging_ptrs;
+
+    // 当前流声道数对应的转换内核
+    SampleKernels m_kernels = SampleKernels::forChannels(0);
+    // 用于最终输出的交错或拼接后的数据
+    std::vector<float> m_pcm_output;
+
+    // 下一帧预期的 PTS ，基于 time_base
+    int64_t m_next_pts = AV_NOPTS_VALUE;
+    // 当前流的时间基
+    AVRational m_time_base = {1, 1};
+
+    // 送入 SoundTouch 的一段连续样本在源时间轴上的位置
+    struct SourceSpan {
+        int64_t input_start;  // 在 SoundTouch 累计输入中的起始样本序号
+        int64_t count;
+        double source_time;  // 第一个样本的源时间（秒）
+        int direction;       // 倒放时为 -1，源时间随样本递减
+    };
+    std::deque<SourceSpan> m_source_spans;
+
+    // 自上次 clear 以来累计送入 SoundTouch 的样本数
+    int64_t m_st_input_samples = 0;
+    // 变速前已经生成、尚未取走的输出样本，仍按旧的输入/输出比例换算
+    int64_t m_st_stale_ready = 0;
+    double m_st_stale_ratio = 1.0;
+
+    // 没有任何可用映射时（刚 seek 完或刚打开）报告的源时间
     double m_current_output_time = 0.0;
 
-    AudioProperties setupDecoder() {
-        Status status = {0, ""};
+    // 解码器已输出全部帧，只剩各级缓冲中的样本
+    bool m_decode_done = false;
+
+    // 响度归一化，增益在输出转换时顺带乘上
+    NormalizationMode m_norm_mode = NormalizationMode::Off;
+    double m_norm_preamp_db = 0.0;
+    bool m_norm_prevent_clipping = true;
+    // 由标签计算出的线性增益，<0 表示当前流没有可用标签
+    float m_norm_tag_gain = -1.0f;
+    // 上一个 chunk 结束时实际使用的增益，本 chunk 从它线性过渡到目标值
+    float m_norm_gain = 1.0f;
+    // 没有标签时的运行响度估计：均方值与衰减峰值
+    double m_loudness_ms = 0.0;
+    float m_loudness_peak = 0.0f;
+
+    // 最近解码过的 PCM，落在其中的 seek 不经过解复用器和解码器
+    PcmBlockCache m_pcm_cache;
+    int64_t m_pcm_cache_max_bytes = 0;
+    PcmCacheStats m_pcm_cache_stats = {0, 0, 0, 0};
+    // 正在从缓存输出，m_cache_pos 为下一个要送出的源样本序号
+    bool m_cache_reading = false;
+    int64_t m_cache_pos = 0;
+    // 解复用器定位后解码器的预热长度（MP3 比特池、AAC 重叠变换等），这段样本不写入缓存
+    static constexpr double kWarmupSeconds = 0.5;
+    int64_t m_cache_warmup_left = 0;
+    // 解码器下一个输出样本的源样本序号，-1 表示未知（刚 seek 或直通中）
+    int64_t m_codec_next_sample = -1;
+    // 缓存读完后重新定位解码器时，丢弃该序号之前的样本，-1 表示不丢弃
+    int64_t m_discard_until = -1;
+
+    // 倒放：按块向前定位、正向解码，再把块内样本倒序送入 SoundTouch
+    bool m_reverse = false;
+    // 下一个要倒序送出的样本之后的位置（源样本序号，不含）
+    int64_t m_rev_pos = 0;
+    // 当前已解码的块，覆盖 [m_rev_block_start, m_rev_block_end)
+    std::vector<float> m_rev_block;
+    int64_t m_rev_block_start = 0;
+    int64_t m_rev_block_end = 0;
+    std::vector<float> m_rev_out;
+
+    // C ABI 热路径的结果头及其错误信息
+    ChunkHeader m_chunk_header = {0, 0, 0, 0, 0.0, 0.0, "", nullptr};
+    std::string m_chunk_error;
+
+    // A-B 循环：区间解码一次后常驻内存，末尾与 A 之前的样本交叉淡化，回绕时不 seek、不冲刷
+    bool m_loop_active = false;
+    // 正向播放已进入区间，样本改由 m_loop_buf 提供
+    bool m_loop_engaged = false;
+    int64_t m_loop_start = 0;
+    int64_t m_loop_end = 0;
+    // 下一个要送出的源样本序号
+    int64_t m_loop_pos = 0;
+    std::vector<float> m_loop_buf;
+
+    // CUE 虚拟音轨：整轨镜像保持打开，音轨只是其中的样本区间
+    std::vector<CueTrack> m_cue_tracks;
+
+    // 直播模式：不可 seek、时长未知。预读队列即抖动缓冲，积压维持在目标延迟附近
+    bool m_live = false;
+    double m_live_target = 2.0;
+    double m_live_max = 8.0;
+    // 起播或队列读空后先攒够目标延迟再输出
+    bool m_live_buffering = false;
+    // 积压偏高时临时加快播放速度追赶
+    bool m_live_catching_up = false;
+    static constexpr double kLiveCatchupTempo = 1.05;
+    static constexpr double kLiveHysteresis = 0.5;
+    std::vector<StreamMetadataEvent> m_stream_events;
+    // 单曲播放时的结束位置（源样本序号，不含），-1 表示连续播放到文件结尾
+    int64_t m_track_end = -1;
+    bool m_track_end_reached = false;
+
+    // 离线分段解码（beginSegment / readSegment），只做格式转换
+    SwrCtxPtr m_seg_swr;
+    SampleFormat m_seg_format = SampleFormat::InterleavedS16;
+    int64_t m_seg_start = 0;
+    int64_t m_seg_end = 0;
+    // 下一个要输出的源样本序号
+    int64_t m_seg_pos = 0;
+    // 分段起点之前的预滚秒数，seek 越过起点时加长；-1 表示已从文件开头解码
+    static constexpr double kSegmentPreroll = 0.5;
+    double m_seg_preroll = 0;
+    bool m_seg_done = true;
+    std::vector<uint8_t> m_seg_frame;
+    std::vector<uint8_t> m_seg_out;
+
+    // 解码后、送入 SoundTouch 之前跳过静音
+    SilenceSkipper m_silence;
+
+    // 输出端的频谱分析，参数在切换流时按新的采样率重建
+    SpectrumAnalyzer m_spectrum;
+    int m_spectrum_size = 0;
+    int m_spectrum_hop = 0;
+    int m_spectrum_bands = 0;
+
+    // SoundTouch 之后、输出格式转换之前的 DSP
+    DspChain m_dsp;
+    double m_dsp_last_ms = 0.0;
+    double m_dsp_total_ms = 0.0;
+    int m_dsp_chunks = 0;
+
+    void feedStretch(const float* samples, int frames, double source_time, int direction = 1) {
+        if (frames <= 0) return;
+        m_source_spans.push_back({m_st_input_samples, frames, source_time, direction});
+        m_st_input_samples += frames;
+        m_stretch.putSamples(samples, frames);
+    }
+
+    // 解码输出的入口：需要时先经过静音跳过，再按源时间分段送入 SoundTouch
+    void feedSource(const float* samples, int frames, double source_time) {
+        if (frames <= 0) return;
+        if (m_track_end >= 0 && !m_reverse) {
+            int64_t start = llround(source_time * codec_ctx->sample_rate);
+            int64_t allowed = std::max<int64_t>(0, m_track_end - start);
+            if (allowed < frames) {
+                frames = (int)allowed;
+                m_track_end_reached = true;
+            }
+            if (frames <= 0) return;
+        }
+        if (!m_silence.enabled()) {
+            feedStretch(samples, frames, source_time);
+            return;
+        }
+
+        m_silence.process(samples, frames, source_time);
+        feedSilenceOutput();
+    }
+
+    void feedSilenceOutput() {
+        int channels = codec_ctx->ch_layout.nb_channels;
+        for (const auto& seg : m_silence.segments()) {
+            feedStretch(m_silence.output() + seg.offset * channels, seg.count, seg.source_time);
+        }
+    }
+
+    /**
+     * 计算 SoundTouch 下一个输出样本对应的源时间。
+     * 仍在 SoundTouch 内部的样本 = 未处理的输入 + 已就绪的输出（按输入/输出比例折算回输入域），
+     * 从累计输入中减去它们即得到输出头部在输入序列中的位置，再通过 m_source_spans 映射回源时间。
+     */
+    double stretchHeadTime() {
+        if (m_source_spans.empty()) return m_current_output_time;
+
+        double head;
+        if (m_stretch.varispeed()) {
+            // 重采样器逐样本推进，位置是精确的，过渡期间也不需要估算
+            head = m_stretch.varispeedPosition();
+        } else {
+            double ratio = m_stretch.getInputOutputSampleRatio();
+            if (ratio <= 0) ratio = 1.0;
+
+            int64_t ready = m_stretch.numSamples();
+            int64_t stale = std::min(m_st_stale_ready, ready);
+            double buffered_input = m_stretch.numUnprocessedSamples() +
+                                    stale / m_st_stale_ratio + (ready - stale) / ratio -
+                                    m_stretch.hiddenLatency();
+            head = (double)(m_st_input_samples - static_cast<int64_t>(buffered_input + 0.5));
+            head = std::min(head, (double)m_st_input_samples);
+        }
+
+        while (m_source_spans.size() > 1 &&
+               m_source_spans.front().input_start + m_source_spans.front().count <= head) {
+            m_source_spans.pop_front();
+        }
+
+        const SourceSpan& span = m_source_spans.front();
+        double offset = std::max(0.0, head - span.input_start);
+        return span.source_time + span.direction * offset / codec_ctx->sample_rate;
+    }
+
+    // 考虑 DSP 前瞻延迟后，下一个输出样本的源时间
+    double outputHeadTime() {
+        double time = stretchHeadTime();
+        int latency = m_dsp.latency();
+        if (latency > 0) {
+            double ratio = m_stretch.getInputOutputSampleRatio();
+            if (ratio <= 0) ratio = 1.0;
+            time -= (m_reverse ? -1 : 1) * latency / ratio / codec_ctx->sample_rate;
+        }
+        return time;
+    }
+
+    /**
+     * 从 REPLAYGAIN_* / R128_* 标签计算增益（不区分大小写，流级标签优先）。
+     * R128 是相对 -23 LUFS 的 Q7.8 定点数，+5 dB 换算到 ReplayGain 的 -18 LUFS 参考。
+     */
+    void updateNormalizationTagGain() {
+        m_norm_tag_gain = -1.0f;
+        if (m_norm_mode == NormalizationMode::Off || !format_ctx) return;
+
+        auto lookup = [&](const char* key) -> const char* {
+            AVDictionaryEntry* tag = nullptr;
+            if (audio_stream_index >= 0) {
+                tag = av_dict_get(format_ctx->streams[audio_stream_index]->metadata, key,
+                                  nullptr, 0);
+            }
+            if (!tag) tag = av_dict_get(format_ctx->metadata, key, nullptr, 0);
+            return tag ? tag->value : nullptr;
+        };
+
+        bool album = m_norm_mode == NormalizationMode::Album;
+        const char* rg_gain = lookup(album ? "REPLAYGAIN_ALBUM_GAIN" : "REPLAYGAIN_TRACK_GAIN");
+        const char* rg_peak = lookup(album ? "REPLAYGAIN_ALBUM_PEAK" : "REPLAYGAIN_TRACK_PEAK");
+        if (!rg_gain && album) {
+            rg_gain = lookup("REPLAYGAIN_TRACK_GAIN");
+            rg_peak = lookup("REPLAYGAIN_TRACK_PEAK");
+        }
+
+        double gain_db = 0.0;
+        double peak = 0.0;
+        if (rg_gain) {
+            gain_db = atof(rg_gain);
+            if (rg_peak) peak = atof(rg_peak);
+        } else {
+            const char* r128 = lookup(album ? "R128_ALBUM_GAIN" : "R128_TRACK_GAIN");
+            if (!r128 && album) r128 = lookup("R128_TRACK_GAIN");
+            if (!r128) return;
+            gain_db = atoi(r128) / 256.0 + 5.0;
+        }
+
+        double gain = std::pow(10.0, (gain_db + m_norm_preamp_db) / 20.0);
+        if (m_norm_prevent_clipping && peak > 0.0 && gain * peak > 1.0) {
+            gain = 1.0 / peak;
+        }
+        m_norm_tag_gain = (float)gain;
+    }
+
+    // 本 chunk 的目标增益：有标签用标签，否则按运行响度估计向 -18 dBFS RMS 靠拢
+    float normalizationTarget() const {
+        if (m_norm_mode == NormalizationMode::Off) return 1.0f;
+        if (m_norm_tag_gain >= 0.0f) return m_norm_tag_gain;
+        if (m_loudness_ms < 1e-8) return m_norm_gain;
+
+        const double reference_rms = 0.125893;  // -18 dBFS
+        double gain = reference_rms / std::sqrt(m_loudness_ms) *
+                      std::pow(10.0, m_norm_preamp_db / 20.0);
+        gain = std::max(0.25, std::min(4.0, gain));  // ±12 dB
+        if (m_norm_prevent_clipping && m_loudness_peak > 0.0f) {
+            gain = std::min(gain, 0.99 / m_loudness_peak);
+        }
+        return (float)gain;
+    }
+
+    void resetStretchClock(double source_time) {
+        m_source_spans.clear();
+        m_st_input_samples = 0;
+        m_st_stale_ready = 0;
+        m_st_stale_ratio = 1.0;
+        m_current_output_time = source_time;
+    }
+
+    // 参数变化只影响尚未处理的输入，已就绪的输出仍按旧比例折算
+    void markStretchRatioChange() {
+        int64_t ready = m_stretch.numSamples();
+        if (ready <= 0) {
+            m_st_stale_ready = 0;
+            return;
+        }
+
+        double ratio = m_stretch.getInputOutputSampleRatio();
+        if (ratio <= 0) ratio = 1.0;
+
+        int64_t stale = std::min(m_st_stale_ready, ready);
+        double input_equiv = stale / m_st_stale_ratio + (ready - stale) / ratio;
+
+        m_st_stale_ready = ready;
+        m_st_stale_ratio = ready / input_equiv;
+    }
+
+    // 读取下一个音频包：优先从预读队列取，队列为空时才直接解复用（可能阻塞在网络读取上）
+    int nextPacket(AVPacket* dst) {
+        if (m_packet_queue.pop(dst)) return 0;
+        if (m_demux_error < 0) return m_demux_error;
+        if (m_demux_eof) return AVERROR_EOF;
+
+        // 直播流只从抖动缓冲取包，读空即重新缓冲，不在网络读取上阻塞
+        if (m_live) {
+            m_live_buffering = true;
+            return AVERROR(EAGAIN);
+        }
+
+        while (true) {
+            int ret = av_read_frame(format_ctx.get(), dst);
+            if (ret < 0) {
+                if (ret == AVERROR_EOF) m_demux_eof = true;
+                return ret;
+            }
+            if (dst->stream_index == audio_stream_index) return 0;
+            av_packet_unref(dst);
+        }
+    }
+
+    double liveTempoFactor() const { return m_live_catching_up ? kLiveCatchupTempo : 1.0; }
+
+    // 抖动缓冲中数据的时长；包没有 duration 时按码率估算，码率也未知时视为已达目标
+    double liveBacklog() const {
+        double seconds = m_packet_queue.durationSeconds(m_time_base);
+        if (seconds > 0 || m_packet_queue.empty()) return seconds;
+        int64_t bit_rate = codec_ctx->bit_rate > 0 ? codec_ctx->bit_rate : format_ctx->bit_rate;
+        return bit_rate > 0 ? m_packet_queue.bytes() * 8.0 / bit_rate : m_live_target;
+    }
+
+    /**
+     * 直播模式下每个 chunk 之前调用，返回 false 表示仍在缓冲、本次不输出。
+     * 积压超过目标 kLiveHysteresis 秒后开始加速，回到目标以下恢复原速
+     */
+    bool updateLiveLatency() {
+        double backlog = liveBacklog();
+
+        if (m_live_buffering) {
+            bool draining = m_demux_eof || m_demux_error < 0;
+            if (backlog < m_live_target && !draining) return false;
+            m_live_buffering = false;
+        }
+
+        bool catch_up = m_live_catching_up ? backlog > m_live_target
+                                           : backlog > m_live_target + kLiveHysteresis;
+        if (catch_up != m_live_catching_up) {
+            markStretchRatioChange();
+            m_live_catching_up = catch_up;
+            m_stretch.setTempo(m_tempo * liveTempoFactor());
+        }
+        return true;
+    }
+
+    // 积压超过最大延迟（长时间暂停、网络突发）时丢弃最旧的包，直接回到目标延迟
+    void trimLiveBacklog() {
+        if (liveBacklog() <= m_live_max) return;
+        while (!m_packet_queue.empty() && liveBacklog() > m_live_target) {
+            m_packet_queue.dropFront();
+        }
+    }
+
+    // ICY 元数据的生效时间取字节流中位于其后的第一个包的时间
+    void resolveStreamEvents(const AVPacket* pkt) {
+        if (!stream_ctx || pkt->pos < 0) return;
+        auto& pending = stream_ctx->icy_events;
+        while (!pending.empty() && pending.front().first <= pkt->pos) {
+            double time = pkt->pts != AV_NOPTS_VALUE ? pkt->pts * av_q2d(m_time_base)
+                                                     : m_current_output_time;
+            const std::string& raw = pending.front().second;
+            m_stream_events.push_back({time, icyStreamTitle(raw), raw});
+            pending.pop_front();
+        }
+    }
+
+    /**
+     * 把 m_scrub_buffer 中交错的预览样本转为 planar 写入 m_scrub_output。
+     * 不使用 m_pcm_output，播放中取缓存预览不会覆盖最近一个 chunk 的样本。
+     */
+    ChunkResult finishScrub(ChunkResult result, int channels) {
+        int got = (int)(m_scrub_buffer.size() / channels);
+        m_scrub_output.resize((size_t)got * channels);
+        m_staging_ptrs.resize(channels);
+        for (int ch = 0; ch < channels; ch++) {
+            m_staging_ptrs[ch] = m_scrub_output.data() + (size_t)ch * got;
+        }
+
+        double sum_sq = 0.0;
+        float peak = 0.0f;
+        m_kernels.deinterleave(m_scrub_buffer.data(), m_staging_ptrs.data(), got, channels, 1.0f,
+                               0.0f, sum_sq, peak);
+
+        result.samples = emscripten::val(
+            emscripten::memory_view<float>(m_scrub_output.size(), m_scrub_output.data()));
+        return result;
+    }
+
+    // 按当前流的采样率设置单曲播放的结束时间（秒），负数表示连续播放
+    void restoreTrackEnd(double end_time) {
+        m_track_end = end_time >= 0 ? llround(end_time * codec_ctx->sample_rate) : -1;
+    }
+
+    /**
+     * 为指定的音频流创建解码器与重采样上下文。
+     * 其余流设为 AVDISCARD_ALL，解复用时直接跳过它们的包。
+     */
+    Status openAudioStream(int stream_index) {
+        Status status = {0, ""};
+
+        AVStream* stream = format_ctx->streams[stream_index];
+        const AVCodec* decoder = avcodec_find_decoder(stream->codecpar->codec_id);
+        if (!decoder) {
+            return {AVERROR_DECODER_NOT_FOUND,
+                    "No decoder for stream " + std::to_string(stream_index)};
+        }
+
+        codec_ctx.reset(avcodec_alloc_context3(decoder));
+        if (!codec_ctx) {
+            status.status = -1;
+            status.error = "Failed to alloc context";
+            return status;
+        }
+
+        avcodec_parameters_to_context(codec_ctx.get(), stream->codecpar);
+
+        if ((status.status = avcodec_open2(codec_ctx.get(), decoder, nullptr)) < 0) {
+            status.error = "avcodec_open2: " + get_error_str(status.status);
+            return status;
+        }
+
+        m_stretch.setSampleRate(codec_ctx->sample_rate);
+        m_stretch.setChannels(codec_ctx->ch_layout.nb_channels);
+        m_kernels = SampleKernels::forChannels(codec_ctx->ch_layout.nb_channels);
+        m_dsp.configure(codec_ctx->sample_rate, codec_ctx->ch_layout.nb_channels);
+        m_silence.configure(codec_ctx->sample_rate, codec_ctx->ch_layout.nb_channels);
+        m_spectrum.configure(m_spectrum_size, m_spectrum_hop, m_spectrum_bands,
+                             codec_ctx->sample_rate);
+
+        swr_ctx.reset(swr_alloc());
+        av_opt_set_chlayout(swr_ctx.get(), "in_chlayout", &codec_ctx->ch_layout, 0);
+        av_opt_set_int(swr_ctx.get(), "in_sample_rate", codec_ctx->sample_rate, 0);
+        av_opt_set_sample_fmt(swr_ctx.get(), "in_sample_fmt", codec_ctx->sample_fmt, 0);
+
+        av_opt_set_chlayout(swr_ctx.get(), "out_chlayout", &codec_ctx->ch_layout, 0);
+        av_opt_set_int(swr_ctx.get(), "out_sample_rate", codec_ctx->sample_rate, 0);
+        av_opt_set_sample_fmt(swr_ctx.get(), "out_sample_fmt", AV_SAMPLE_FMT_FLT, 0);
+
+        if ((status.status = swr_init(swr_ctx.get())) < 0) {
+            status.error = "Failed to initialize swresample context";
+            return status;
+        }
+
+        for (unsigned int i = 0; i < format_ctx->nb_streams; i++) {
+            format_ctx->streams[i]->discard =
+                (int)i == stream_index ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+        }
+
+        audio_stream_index = stream_index;
+        m_time_base = stream->time_base;
+        m_next_pts = AV_NOPTS_VALUE;
+        if (m_pt_frame) av_frame_unref(m_pt_frame.get());
+        m_pt_offset = 0;
+
+        m_pcm_cache.configure(codec_ctx->ch_layout.nb_channels, m_pcm_cache_max_bytes);
+        m_cache_reading = false;
+        m_loop_active = m_loop_engaged = false;
+        m_loop_buf.clear();
+        m_rev_block.clear();
+        m_rev_block_start = m_rev_block_end = 0;
+        m_codec_next_sample = -1;
+        m_cache_warmup_left = 0;
+        m_discard_until = -1;
+        // 结束位置按源样本计，换流后由调用方按新采样率换算；CUE 音轨与流无关，保留
+        m_track_end = -1;
+        m_track_end_reached = false;
+
+        updateNormalizationTagGain();
+        m_loudness_ms = 0.0;
+        m_loudness_peak = 0.0f;
+
+        return status;
+    }
+
+    /**
+     * 源是 S16/S32 整数或 FLT 浮点样本、输出为能容纳它的交错格式，且中间没有任何会改变
+     * 样本的处理时，跳过 swr 与 SoundTouch，直接把解码帧重排为交错输出，结果与源逐位一致
+     * （S32 源输出 S24 时只保留高 24 位）。只在浮点管线完全排空时切换，避免丢掉 SoundTouch
+     * 里的样本。
+     */
+    bool exactPassthrough(SampleFormat format) {
+        AVSampleFormat fmt = codec_ctx->sample_fmt;
+        bool src_s16 = fmt == AV_SAMPLE_FMT_S16 || fmt == AV_SAMPLE_FMT_S16P;
+        bool src_s32 = fmt == AV_SAMPLE_FMT_S32 || fmt == AV_SAMPLE_FMT_S32P;
+        bool src_flt = fmt == AV_SAMPLE_FMT_FLT || fmt == AV_SAMPLE_FMT_FLTP;
+
+        switch (format) {
+            case SampleFormat::InterleavedS16:
+                if (!src_s16) return false;
+                break;
+            case SampleFormat::InterleavedS24:
+            case SampleFormat::InterleavedS32:
+                if (!src_s16 && !src_s32) return false;
+                break;
+            case SampleFormat::InterleavedF32:
+                if (!src_flt) return false;
+                break;
+            default:
+                return false;
+        }
+
+        if (m_tempo != 1.0 || m_pitch != 1.0) return false;
+        if (m_cache_reading || m_discard_until >= 0 || m_reverse || m_loop_active) return false;
+        if (m_track_end >= 0 || m_live_catching_up) return false;
+        if (m_silence.enabled() || m_dsp.active() || m_spectrum.enabled()) return false;
+        if (m_norm_mode != NormalizationMode::Off || m_norm_gain != 1.0f) return false;
+
+        return m_stretch.numSamples() == 0 && m_stretch.numUnprocessedSamples() == 0 &&
+               swr_get_delay(swr_ctx.get(), codec_ctx->sample_rate) == 0;
+    }
+
+    // 直通中途切回浮点管线时，把手里剩下的半帧交给 swr
+    void flushPassthroughFrame() {
+        if (!m_pt_frame || m_pt_frame->nb_samples <= m_pt_offset) return;
+
+        int channels = codec_ctx->ch_layout.nb_channels;
+        int remaining = m_pt_frame->nb_samples - m_pt_offset;
+        int bps = av_get_bytes_per_sample((AVSampleFormat)m_pt_frame->format);
+        bool planar = av_sample_fmt_is_planar((AVSampleFormat)m_pt_frame->format);
+
+        std::vector<const uint8_t*> in(planar ? channels : 1);
+        for (size_t ch = 0; ch < in.size(); ch++) {
+            in[ch] = m_pt_frame->extended_data[ch] +
+                     (size_t)m_pt_offset * bps * (planar ? 1 : channels);
+        }
+
+        uint8_t** out_data = resample_buffer.grow(channels, remaining);
+        if (out_data) {
+            int ret = swr_convert(swr_ctx.get(), out_data, remaining, in.data(), remaining);
+            feedDecoded((const float*)out_data[0], ret,
+                        m_pt_time + (double)m_pt_offset / codec_ctx->sample_rate);
+        }
+        av_frame_unref(m_pt_frame.get());
+        m_pt_offset = 0;
+    }
+
+    /**
+     * 把 S16/S32/FLT（packed 或 planar）帧中的一段样本写成交错的 Out，
+     * S16 写入 S32 时左移 16 位，同类型之间原样复制
+     */
+    template <typename In, typename Out>
+    static void interleaveFrame(const AVFrame* src, int offset, int frames, int channels,
+                                Out* dst) {
+        constexpr int shift = (int)(sizeof(Out) - sizeof(In)) * 8;
+        if (av_sample_fmt_is_planar((AVSampleFormat)src->format)) {
+            for (int ch = 0; ch < channels; ch++) {
+                const In* in = reinterpret_cast<const In*>(src->extended_data[ch]) + offset;
+                Out* out = dst + ch;
+                for (int i = 0; i < frames; i++, out += channels) {
+                    if constexpr (shift == 0) {
+                        *out = in[i];
+                    } else {
+                        *out = (Out)((uint32_t)in[i] << shift);
+                    }
+                }
+            }
+        } else {
+            const In* in = reinterpret_cast<const In*>(src->data[0]) + (size_t)offset * channels;
+            if constexpr (shift == 0) {
+                memcpy(dst, in, (size_t)frames * channels * sizeof(Out));
+            } else {
+                for (int i = 0; i < frames * channels; i++) {
+                    dst[i] = (Out)((uint32_t)in[i] << shift);
+                }
+            }
+        }
+    }
+
+    template <typename Out>
+    void copyPassthrough(int frames, Out* dst) {
+        int channels = codec_ctx->ch_layout.nb_channels;
+        AVSampleFormat fmt = (AVSampleFormat)m_pt_frame->format;
+        if constexpr (std::is_same_v<Out, float>) {
+            // F32 输出只接 FLT 源，见 exactPassthrough
+            interleaveFrame<float, float>(m_pt_frame.get(), m_pt_offset, frames, channels, dst);
+        } else if (fmt == AV_SAMPLE_FMT_S16 || fmt == AV_SAMPLE_FMT_S16P) {
+            interleaveFrame<int16_t, Out>(m_pt_frame.get(), m_pt_offset, frames, channels, dst);
+        } else if constexpr (sizeof(Out) == sizeof(int32_t)) {
+            // S32 源只会走 S24/S32 输出
+            interleaveFrame<int32_t, Out>(m_pt_frame.get(), m_pt_offset, frames, channels, dst);
+        }
+    }
+
+    /**
+     * 处理 avcodec_receive_frame 的非成功返回：统计解码错误，再送入下一个包。
+     * 返回 false 表示遇到致命错误，status 已填好。
+     */
+    bool feedDecoder(int receive_ret, int& consecutive_errors, Status& status) {
+        if (receive_ret != AVERROR(EAGAIN)) {
+            consecutive_errors++;
+
+            double current_time =
+                (m_next_pts != AV_NOPTS_VALUE) ? m_next_pts * av_q2d(m_time_base) : -1.0;
+            double total_duration = (format_ctx->duration != AV_NOPTS_VALUE)
+                                        ? (double)format_ctx->duration / AV_TIME_BASE
+                                        : -1.0;
+
+            fprintf(stderr,
+                    "[Decoder] Ignored decode error: %d (%s). Time: %.3f / %.3f. Count: %d\n",
+                    receive_ret, get_error_str(receive_ret).c_str(), current_time,
+                    total_duration, consecutive_errors);
+
+            if (consecutive_errors > 50 || receive_ret == AVERROR(ENOMEM) ||
+                receive_ret == AVERROR(EINVAL)) {
+                status = {receive_ret, "Fatal decode error: " + get_error_str(receive_ret)};
+                return false;
+            }
+        }
+
+        int read_ret = nextPacket(packet.get());
+        if (read_ret == AVERROR(EAGAIN)) return false;
+        if (read_ret < 0) {
+            if (read_ret == AVERROR_EOF) {
+                avcodec_send_packet(codec_ctx.get(), nullptr);
+            } else {
+                status = {read_ret, "Read frame error: " + get_error_str(read_ret)};
+                return false;
+            }
+        } else {
+            int send_ret = avcodec_send_packet(codec_ctx.get(), packet.get());
+
+            if (send_ret < 0 && send_ret != AVERROR(EAGAIN) && send_ret != AVERROR_EOF) {
+                double pkt_time =
+                    (packet->pts != AV_NOPTS_VALUE) ? packet->pts * av_q2d(m_time_base) : -1.0;
+
+                fprintf(stderr, "[Decoder] Packet send failed: %d (%s). Packet Time: %.3f\n",
+                        send_ret, get_error_str(send_ret).c_str(), pkt_time);
+            }
+            av_packet_unref(packet.get());
+        }
+        return true;
+    }
+
+    // 更新帧时钟并返回本帧第一个样本的源时间（未计 swr 延迟）
+    double advanceFrameClock(const AVFrame* decoded) {
+        int64_t current_pts = decoded->pts;
+        if (current_pts == AV_NOPTS_VALUE) {
+            current_pts = decoded->best_effort_timestamp;
+        }
+
+        // 如果当前帧有 PTS，强制更新内部时钟；否则沿用递推值
+        if (current_pts != AV_NOPTS_VALUE) {
+            m_next_pts = current_pts;
+        }
+
+        // 如果是流的开头且没有 PTS，假定从 0 开始
+        if (m_next_pts == AV_NOPTS_VALUE) {
+            m_next_pts = 0;
+        }
+
+        double time = m_next_pts * av_q2d(m_time_base);
+
+        // 计算当前帧持续时间并累加到 m_next_pts
+        // 时长 = 样本数 / 采样率，需要转换到 m_time_base 单位
+        if (decoded->nb_samples > 0) {
+            int64_t duration = av_rescale_q(decoded->nb_samples,
+                                            (AVRational){1, codec_ctx->sample_rate}, m_time_base);
+            m_next_pts += duration;
+        }
+        return time;
+    }
+
+    /**
+     * 分段解码能与顺序解码逐样本一致的前提：seek 后的包带有精确时间戳（排除按码率估算位置的
+     * 裸流），且解码器状态只依赖有限的历史（无损或帧内编码，或只有重叠变换、比特池的有损编码）。
+     * Opus 等带长程预测的编码预滚后只会近似收敛，不切分。AAC 只切分 LC：HE-AAC 的 SBR/PS
+     * 带有跨帧的包络与参数状态，预滚后不保证逐样本一致
+     */
+    bool segmentable() const {
+        static const char* const kRawDemuxers[] = {"mp3",    "aac", "ac3",  "eac3", "dts",
+                                                   "truehd", "mlp", "loas", "mpeg"};
+        for (const char* name : kRawDemuxers) {
+            if (strcmp(format_ctx->iformat->name, name) == 0) return false;
+        }
+
+        const AVCodecDescriptor* desc = avcodec_descriptor_get(codec_ctx->codec_id);
+        if (desc && (desc->props & (AV_CODEC_PROP_INTRA_ONLY | AV_CODEC_PROP_LOSSLESS))) {
+            return true;
+        }
+        switch (codec_ctx->codec_id) {
+            case AV_CODEC_ID_AAC:
+                return codec_ctx->profile == AV_PROFILE_AAC_LOW;
+            case AV_CODEC_ID_MP2:
+            case AV_CODEC_ID_MP3:
+            case AV_CODEC_ID_VORBIS:
+            case AV_CODEC_ID_AC3:
+            case AV_CODEC_ID_EAC3:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    DecodedChunk decodePassthrough(int chunkSize, SampleFormat format) {
+        int channels = codec_ctx->ch_layout.nb_channels;
+        DecodedChunk result = {{0, ""}, nullptr, 0, channels, false, -1.0};
+        int consecutive_errors = 0;
+
+        if (!m_pt_frame) m_pt_frame.reset(av_frame_alloc());
+
+        // S24 先按 S32 写入，结束时就地打包
+        size_t capacity = (size_t)chunkSize * channels;
+        if (format == SampleFormat::InterleavedS16) {
+            m_s16_output.resize(capacity);
+        } else if (format == SampleFormat::InterleavedF32) {
+            m_pcm_output.resize(capacity);
+        } else {
+            m_s32_output.resize(capacity);
+        }
+
+        int produced = 0;
+        while (produced < chunkSize) {
+            int available = m_pt_frame->nb_samples - m_pt_offset;
+            if (available > 0) {
+                double head = m_pt_time + (double)m_pt_offset / codec_ctx->sample_rate;
+                if (result.startTime < 0) result.startTime = head;
+
+                int n = std::min(available, chunkSize - produced);
+                size_t at = (size_t)produced * channels;
+                if (format == SampleFormat::InterleavedS16) {
+                    copyPassthrough(n, m_s16_output.data() + at);
+                } else if (format == SampleFormat::InterleavedF32) {
+                    copyPassthrough(n, m_pcm_output.data() + at);
+                } else {
+                    copyPassthrough(n, m_s32_output.data() + at);
+                }
+                m_pt_offset += n;
+                produced += n;
+                continue;
+            }
+
+            if (m_decode_done) {
+                result.isEOF = true;
+                break;
+            }
+
+            av_frame_unref(m_pt_frame.get());
+            m_pt_offset = 0;
+
+            int receive_ret = avcodec_receive_frame(codec_ctx.get(), m_pt_frame.get());
+            if (receive_ret == 0) {
+                consecutive_errors = 0;
+                m_pt_time = advanceFrameClock(m_pt_frame.get());
+                // 直通输出不记入 PCM 缓存，解码器位置对缓存来说未知
+                m_codec_next_sample = -1;
+            } else if (receive_ret == AVERROR_EOF) {
+                m_decode_done = true;
+            } else if (!feedDecoder(receive_ret, consecutive_errors, result.status)) {
+                break;
+            }
+        }
+
+        // 浮点管线以后接手时从这里继续计时
+        double next_time = m_pt_frame->nb_samples > m_pt_offset
+                               ? m_pt_time + (double)m_pt_offset / codec_ctx->sample_rate
+                               : (m_next_pts != AV_NOPTS_VALUE ? m_next_pts * av_q2d(m_time_base)
+                                                               : m_current_output_time);
+        resetStretchClock(next_time);
+        if (result.startTime < 0) result.startTime = next_time;
+
+        if (format == SampleFormat::InterleavedS16) {
+            result.data = m_s16_output.data();
+        } else if (format == SampleFormat::InterleavedF32) {
+            result.data = m_pcm_output.data();
+        } else {
+            if (format == SampleFormat::InterleavedS24) {
+                packS24(m_s32_output.data(), reinterpret_cast<uint8_t*>(m_s32_output.data()),
+                        (size_t)produced * channels);
+            }
+            result.data = m_s32_output.data();
+        }
+        result.frames = produced;
+        return result;
+    }
+
+    /**
+     * 把 swr 输出的一段样本记入 PCM 缓存并送入后续处理。
+     * 按解码器的样本序号对齐时间戳；缓存读完后重新定位时，丢弃目标之前的样本。
+     */
+    void feedDecoded(const float* samples, int frames, double source_time) {
+        if (frames <= 0) return;
+
+        int sr = codec_ctx->sample_rate;
+        int channels = codec_ctx->ch_layout.nb_channels;
+        int64_t start = llround(source_time * sr);
+        if (m_codec_next_sample >= 0 && std::llabs(start - m_codec_next_sample) <= 1) {
+            start = m_codec_next_sample;
+        }
+        m_codec_next_sample = start + frames;
+
+        // 预热中的样本照常播放，但不作为准确结果写入缓存
+        int64_t warm = std::min<int64_t>(frames, m_cache_warmup_left);
+        m_cache_warmup_left -= warm;
+        int64_t cache_from = start + warm;
+
+        if (m_discard_until >= 0) {
+            int64_t skip = std::min<int64_t>(frames, std::max<int64_t>(0, m_discard_until - start));
+            samples += skip * channels;
+            frames -= (int)skip;
+            start += skip;
+            if (frames <= 0) return;
+            m_discard_until = -1;
+        }
+
+        int64_t cached = std::max<int64_t>(0, cache_from - start);
+        if (cached < frames) {
+            m_pcm_cache.write(start + cached, samples + cached * channels, frames - (int)cached);
+        }
+        feedSource(samples, enterLoop(start, frames), (double)start / sr);
+    }
+
+    /**
+     * 把源样本区间 [start, end) 解码为交错 f32 写入 out，filled_end 为实际得到的结束位置
+     * （文件比 end 短时更小）。整段都在 PCM 缓存中时直接复制；否则从 start 之前
+     * kWarmupSeconds 处定位并正向解码，预热部分不写入 out，
+     * 因此相邻区间逐样本衔接。调用后解码器位置不确定，正向播放需要重新定位。
+     */
+    Status decodeRange(int64_t start, int64_t end, std::vector<float>& out, int64_t& filled_end) {
+        int sr = codec_ctx->sample_rate;
+        int channels = codec_ctx->ch_layout.nb_channels;
+        out.assign((size_t)(end - start) * channels, 0.0f);
+
+        int64_t pos = start;
+        int cached = 0;
+        while (pos < end) {
+            const float* data = m_pcm_cache.enabled() ? m_pcm_cache.peek(pos, cached) : nullptr;
+            if (!data) break;
+            int n = (int)std::min<int64_t>(cached, end - pos);
+            memcpy(out.data() + (size_t)(pos - start) * channels, data,
+                   (size_t)n * channels * sizeof(float));
+            pos += n;
+        }
+        filled_end = pos;
+        if (pos >= end) return {0, ""};
+
+        Status status = seekDemuxer(std::max(0.0, (double)start / sr - kWarmupSeconds));
+        if (status.status < 0) return status;
+
+        int consecutive_errors = 0;
+        filled_end = start;
+
+        while (filled_end < end) {
+            int receive_ret = avcodec_receive_frame(codec_ctx.get(), frame.get());
+            if (receive_ret == 0) {
+                consecutive_errors = 0;
+                int64_t swr_delay = swr_get_delay(swr_ctx.get(), sr);
+                double frame_time = advanceFrameClock(frame.get()) - (double)swr_delay / sr;
+
+                int dst_nb_samples = (int)swr_delay + frame->nb_samples;
+                uint8_t** out_data = resample_buffer.grow(channels, dst_nb_samples);
+                if (!out_data) return {-1, "Failed to allocate resample buffer"};
+
+                int ret = swr_convert(swr_ctx.get(), out_data, dst_nb_samples,
+                                      (const uint8_t**)frame->data, frame->nb_samples);
+                av_frame_unref(frame.get());
+                if (ret < 0) return {ret, "Swr convert error"};
+
+                int64_t first = llround(frame_time * sr);
+                if (m_codec_next_sample >= 0 && std::llabs(first - m_codec_next_sample) <= 1) {
+                    first = m_codec_next_sample;
+                }
+                m_codec_next_sample = first + ret;
+
+                int64_t from = std::max(first, start);
+                int64_t to = std::min(first + ret, end);
+                if (to <= from) continue;
+
+                const float* src = (const float*)out_data[0] + (size_t)(from - first) * channels;
+                memcpy(out.data() + (size_t)(from - start) * channels, src,
+                       (size_t)(to - from) * channels * sizeof(float));
+                m_pcm_cache.write(from, src, (int)(to - from));
+                filled_end = std::max(filled_end, to);
+            } else if (receive_ret == AVERROR_EOF) {
+                // 文件实际比预期短：区间在解码到的位置结束
+                out.resize((size_t)(filled_end - start) * channels);
+                break;
+            } else if (!feedDecoder(receive_ret, consecutive_errors, status)) {
+                return status;
+            }
+        }
+
+        // 正向播放恢复时需要重新定位
+        m_codec_next_sample = -1;
+        return {0, ""};
+    }
+
+    // 解码以 end 结尾的倒放块 [end - 块长, end)
+    Status decodeReverseBlock(int64_t end) {
+        const double kReverseBlockSeconds = 3.0;
+
+        int64_t start =
+            std::max<int64_t>(0, end - (int64_t)(kReverseBlockSeconds * codec_ctx->sample_rate));
+        int64_t filled_end = start;
+        m_rev_block_start = m_rev_block_end = start;
+
+        Status status = decodeRange(start, end, m_rev_block, filled_end);
+        if (status.status < 0) return status;
+        m_rev_block_end = filled_end;
+        return status;
+    }
+
+    /**
+     * 正向送出的样本到达循环起点时切换到常驻的循环区间，
+     * 返回这段样本中 A 之前、仍需正常送出的帧数
+     */
+    int enterLoop(int64_t start, int frames) {
+        if (!m_loop_active || m_loop_engaged) return frames;
+        if (start + frames <= m_loop_start || start >= m_loop_end) return frames;
+
+        m_loop_engaged = true;
+        m_loop_pos = std::max(start, m_loop_start);
+        return (int)(m_loop_pos - start);
+    }
+
+    // 从循环区间送出一批样本，到达 B 后回到 A（末尾已与 A 之前的样本交叉淡化）
+    void feedLoop() {
+        const int kMaxFeedFrames = 4096;
+        if (m_loop_pos >= m_loop_end) m_loop_pos = m_loop_start;
+
+        int channels = codec_ctx->ch_layout.nb_channels;
+        int n = (int)std::min<int64_t>(kMaxFeedFrames, m_loop_end - m_loop_pos);
+        feedSource(m_loop_buf.data() + (size_t)(m_loop_pos - m_loop_start) * channels, n,
+                   (double)m_loop_pos / codec_ctx->sample_rate);
+        m_loop_pos += n;
+    }
+
+    // 从 pos 继续正向播放：优先从 PCM 缓存输出，否则重新定位解码器并丢弃 pos 之前的样本
+    void resumeForwardAt(int64_t pos) {
+        int frames = 0;
+        if (m_pcm_cache.enabled() && m_pcm_cache.peek(pos, frames)) {
+            m_cache_reading = true;
+            m_cache_pos = pos;
+            return;
+        }
+        m_cache_reading = false;
+        seekDemuxer((double)pos / codec_ctx->sample_rate);
+        m_discard_until = pos;
+    }
+
+    /**
+     * 倒序送出一批样本，需要时先解码上一个块。
+     * 返回 false 表示已到达文件开头，或者出错（status 非负时为前者）。
+     */
+    bool feedReverse(Status& status) {
+        const int kMaxFeedFrames = 4096;
+        int channels = codec_ctx->ch_layout.nb_channels;
+
+        while (m_rev_pos <= m_rev_block_start || m_rev_pos > m_rev_block_end) {
+            if (m_rev_pos <= 0) return false;
+            if ((status = decodeReverseBlock(m_rev_pos)).status < 0) return false;
+            // 起点超出文件长度时从实际解码到的末尾开始；整块都在文件之外则继续往前
+            m_rev_pos = m_rev_block_end > m_rev_block_start ? std::min(m_rev_pos, m_rev_block_end)
+                                                            : m_rev_block_start;
+        }
+
+        int n = (int)std::min<int64_t>(kMaxFeedFrames, m_rev_pos - m_rev_block_start);
+        m_rev_out.resize((size_t)n * channels);
+
+        const float* src =
+            m_rev_block.data() + (size_t)(m_rev_pos - 1 - m_rev_block_start) * channels;
+        float* dst = m_rev_out.data();
+        for (int i = 0; i < n; i++, src -= channels, dst += channels) {
+            memcpy(dst, src, channels * sizeof(float));
+        }
+
+        feedStretch(m_rev_out.data(), n, (double)(m_rev_pos - 1) / codec_ctx->sample_rate, -1);
+        m_rev_pos -= n;
+        return true;
+    }
+
+    // 从 PCM 缓存送出一批样本；缓存断开时返回 false，并在需要时把解码器定位到断点
+    bool feedFromPcmCache() {
+        const int kMaxFeedFrames = 4096;
+        int frames = 0;
+        const float* data = m_pcm_cache.peek(m_cache_pos, frames);
+
+        if (frames > 0) {
+            frames = std::min(frames, kMaxFeedFrames);
+            feedSource(data, enterLoop(m_cache_pos, frames),
+                       (double)m_cache_pos / codec_ctx->sample_rate);
+            m_cache_pos += frames;
+            if (m_loop_engaged) m_cache_reading = false;
+            return true;
+        }
+
+        m_cache_reading = false;
+        if (m_cache_pos != m_codec_next_sample) {
+            m_pcm_cache_stats.resyncs++;
+            seekDemuxer((double)m_cache_pos / codec_ctx->sample_rate);
+            m_discard_until = m_cache_pos;
+        }
+        return false;
+    }
+
+    /**
+     * 解复用器与解码器定位到 timestamp 之前的关键帧（nearest 时取前后最近的关键帧），
+     * 不触碰 SoundTouch 等后级状态
+     */
+    Status seekDemuxer(double timestamp, bool nearest = false) {
+        Status status = {0, ""};
+        AVStream* stream = format_ctx->streams[audio_stream_index];
+
+        int64_t target_ts =
+            av_rescale_q(timestamp * AV_TIME_BASE, AV_TIME_BASE_Q, stream->time_base);
+
+        int64_t max_ts = nearest ? INT64_MAX : target_ts;
+        if ((status.status = avformat_seek_file(format_ctx.get(), audio_stream_index, INT64_MIN,
+                                                target_ts, max_ts, 0)) < 0) {
+            status.error = "avformat_seek_file error: " + get_error_str(status.status);
+            return status;
+        }
+
+        avcodec_flush_buffers(codec_ctx.get());
+
+        m_packet_queue.clear();
+        m_demux_eof = false;
+        m_demux_error = 0;
+
+        if (m_pt_frame) av_frame_unref(m_pt_frame.get());
+        m_pt_offset = 0;
+
+        // Seek 后重置预测时钟为 NOPTS，强制让下一帧的真实 PTS 来校准
+        m_next_pts = AV_NOPTS_VALUE;
+        m_codec_next_sample = -1;
+        m_discard_until = -1;
+
+        // 只有帧内编码（PCM、FLAC 等）从任意包开始解码都是准确的；从文件开头解码也不需要预热
+        const AVCodecDescriptor* desc = avcodec_descriptor_get(codec_ctx->codec_id);
+        bool intra_only = desc && (desc->props & AV_CODEC_PROP_INTRA_ONLY);
+        m_cache_warmup_left =
+            intra_only || timestamp <= 0 ? 0 : llround(kWarmupSeconds * codec_ctx->sample_rate);
+
+        return status;
+    }
+
+    /**
+     * 读取容器的章节表。打开文件时解复用器已从文件头解析出来，不需要额外扫描；
+     * 缺少结束时间的章节以下一章的开始（或文件时长）结束
+     */
+    std::vector<ChapterInfo> listChapters() const {
+        std::vector<ChapterInfo> chapters;
+        double duration = format_ctx->duration > 0
+                              ? format_ctx->duration / static_cast<double>(AV_TIME_BASE)
+                              : 0.0;
+
+        for (unsigned int i = 0; i < format_ctx->nb_chapters; i++) {
+            const AVChapter* ch = format_ctx->chapters[i];
+            AVDictionaryEntry* title = av_dict_get(ch->metadata, "title", nullptr, 0);
+            double start = ch->start * av_q2d(ch->time_base);
+            double end = ch->end != AV_NOPTS_VALUE ? ch->end * av_q2d(ch->time_base) : start;
+            chapters.push_back({start, end, title ? title->value : ""});
+        }
+
+        for (size_t i = 0; i < chapters.size(); i++) {
+            if (chapters[i].end > chapters[i].start) continue;
+            chapters[i].end = i + 1 < chapters.size() ? chapters[i + 1].start : duration;
+        }
+        return chapters;
+    }
+
+    std::vector<AudioStreamInfo> listAudioStreams() const {
+        std::vector<AudioStreamInfo> streams;
+
+        for (unsigned int i = 0; i < format_ctx->nb_streams; i++) {
+            AVStream* st = format_ctx->streams[i];
+            if (st->codecpar->codec_type != AVMEDIA_TYPE_AUDIO) continue;
+            if (st->disposition & AV_DISPOSITION_ATTACHED_PIC) continue;
+
+            AVDictionaryEntry* language = av_dict_get(st->metadata, "language", nullptr, 0);
+            AVDictionaryEntry* title = av_dict_get(st->metadata, "title", nullptr, 0);
+
+            streams.push_back({
+                (int)i,
+                avcodec_get_name(st->codecpar->codec_id),
+                st->codecpar->ch_layout.nb_channels,
+                st->codecpar->sample_rate,
+                language ? language->value : "",
+                title ? title->value : "",
+                (st->disposition & AV_DISPOSITION_DEFAULT) != 0,
+            });
+        }
+
+        return streams;
+    }
+
+    AudioProperties describeStream() const {
+        std::map<std::string, std::string> meta_map;
+        AVDictionaryEntry* tag = nullptr;
+
+        while ((tag = av_dict_get(format_ctx->metadata, "", tag, AV_DICT_IGNORE_SUFFIX))) {
+            meta_map[std::string(tag->key)] = std::string(tag->value);
+        }
+
+        if (audio_stream_index >= 0 && audio_stream_index < format_ctx->nb_streams) {
+            AVDictionary* stream_meta = format_ctx->streams[audio_stream_index]->metadata;
+            tag = nullptr;
+            while ((tag = av_dict_get(stream_meta, "", tag, AV_DICT_IGNORE_SUFFIX))) {
+                meta_map[std::string(tag->key)] = std::string(tag->value);
+            }
+        }
+
+        std::vector<uint8_t> cover_data;
+
+        for (int i = 0; i < format_ctx->nb_streams; i++) {
+            AVStream* st = format_ctx->streams[i];
+            if (st->disposition & AV_DISPOSITION_ATTACHED_PIC) {
+                AVPacket pkt = st->attached_pic;
+                if (pkt.size > 0) {
+                    cover_data.assign(pkt.data, pkt.data + pkt.size);
+
+                    break;
+                }
+            }
+        }
+
+        int bits = codec_ctx->bits_per_raw_sample;
+
+        if (bits <= 0) {
+            bits = av_get_bytes_per_sample(codec_ctx->sample_fmt) * 8;
+        }
+
+        return {
+            {0, ""},
+            avcodec_get_name(codec_ctx->codec_id),
+            codec_ctx->sample_rate,
+            codec_ctx->ch_layout.nb_channels,
+            // 时长未知（直播流）时为 0
+            std::max<int64_t>(format_ctx->duration, 0) / static_cast<double>(AV_TIME_BASE),
+            meta_map,
+            cover_data,
+            bits,
+            listAudioStreams(),
+            audio_stream_index,
+            listChapters(),
+        };
+    }
+
+    AudioProperties setupDecoder() {
+        Status status = {0, ""};
+
+        if ((status.status = avformat_find_stream_info(format_ctx.get(), nullptr)) < 0) {
+            status.error = "avformat_find_stream_info: " + get_error_str(status.status);
+            return {status};
+        }
+
+        int best_stream =
+            av_find_best_stream(format_ctx.get(), AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+        if (best_stream < 0) {
+            status.status = best_stream;
+            status.error = "av_find_best_stream: No audio stream found";
+            return {status};
+        }
+
+        if ((status = openAudioStream(best_stream)).status < 0) {
+            return {status};
+        }
+
+        m_stretch.setTempo(1.0);
+        m_stretch.setPitch(1.0);
+        m_stretch.setRate(1.0);
+        m_stretch.setVarispeed(false);
+        m_tempo = 1.0;
+        m_pitch = 1.0;
+        m_reverse = false;
+
+        packet.reset(av_packet_alloc());
+        frame.reset(av_frame_alloc());
+
+        initialized = true;
+
+        return describeStream();
+    }
+
+   public:
+    AudioStreamDecoder() {}
+    ~AudioStreamDecoder() { close(); }
+
+    void setTempo(double tempo) {
+        markStretchRatioChange();
+        m_tempo = tempo;
+        m_stretch.setTempo(tempo * liveTempoFactor());
+    }
+
+    void setPitch(double pitch) {
+        markStretchRatioChange();
+        m_pitch = pitch;
+        m_stretch.setPitch(pitch);
+    }
+
+    /**
+     * varispeed 模式：只做重采样，音调随 setTempo 的速度变化，CPU 开销远低于 SoundTouch 的
+     * 保持音调变速，pitch 设置在该模式下不生效。模式内的速度变化平滑过渡；
+     * 切换模式时从当前位置重新定位。
+     * 直播流不支持：追赶积压时的加速要保持音调，必须经过 SoundTouch。
+     */
+    Status setVarispeed(bool enabled) {
+        if (!initialized) return {-1, "Not initialized"};
+        if (enabled == m_stretch.varispeed()) return {0, ""};
+        if (m_live) return {-1, "Varispeed is not available for live streams"};
+
+        double position = stretchHeadTime();
+        m_stretch.clear();
+        m_stretch.setVarispeed(enabled);
+        return seek(position);
+    }
+
+    bool isVarispeed() const { return m_stretch.varispeed(); }
+
+    /**
+     * 变速/变调生效前仍会以旧参数输出的时长（秒）：已就绪的输出加上 TDStretch 的重叠搜索延迟。
+     * readChunk 每次只在输出不足时送入一帧，因此该值不超过 SoundTouch 的一个处理批次
+     * 加半个 seek window。
+     */
+    double getStretchLatency() {
+        if (!initialized || codec_ctx->sample_rate <= 0) return 0.0;
+        double ratio = m_stretch.getInputOutputSampleRatio();
+        if (ratio <= 0) ratio = 1.0;
+        double output = m_stretch.numSamples() + m_stretch.hiddenLatency() * ratio;
+        return output / codec_ctx->sample_rate;
+    }
+
+    AudioProperties init(std::string path) {
+        av_log_set_level(AV_LOG_ERROR);
+        close();
+
+        Status status = {0, ""};
+        AVFormatContext* raw_fmt_ctx = nullptr;
+
+        if ((status.status = avformat_open_input(&raw_fmt_ctx, path.c_str(), nullptr, nullptr)) !=
+            0) {
+            status.error = "avformat_open_input: " + get_error_str(status.status);
+            return {status};
+        }
+        format_ctx.reset(raw_fmt_ctx);
+
+        return setupDecoder();
+    }
+
+    AudioProperties initStream(emscripten::val readFn, emscripten::val seekFn) {
+        av_log_set_level(AV_LOG_ERROR);
+        close();
+
+        stream_ctx = std::make_unique<StreamContext>();
+        stream_ctx->readFn = readFn;
+        stream_ctx->seekFn = seekFn;
+        stream_ctx->cache.configure(m_io_cache_block_size, m_io_cache_max_bytes);
+
+        return openCustomIO(&read_packet_wrapper, &seek_wrapper);
+    }
+
+    /**
+     * 打开直播流（网络电台等）：只有读取回调，不可 seek，时长未知。
+     * icyMetaint 为 HTTP 响应头 icy-metaint 的值，非 0 时从字节流中剥离 ICY 元数据，
+     * 按其在流中的位置换算成播放时间，通过 takeStreamMetadata 取出。
+     */
+    AudioProperties initLive(emscripten::val readFn, int icyMetaint) {
+        av_log_set_level(AV_LOG_ERROR);
+        close();
+
+        stream_ctx = std::make_unique<StreamContext>();
+        stream_ctx->readFn = readFn;
+        stream_ctx->icy_metaint = std::max(0, icyMetaint);
+        stream_ctx->icy_audio_left = stream_ctx->icy_metaint;
+        m_live = true;
+        m_live_buffering = true;
+
+        return openCustomIO(&read_live_wrapper, nullptr);
+    }
+
+    AudioProperties openCustomIO(int (*read_fn)(void*, uint8_t*, int),
+                                 int64_t (*seek_fn)(void*, int64_t, int)) {
+        Status status = {0, ""};
+
+        const int avio_buffer_size = 32768;
+        avio_buffer = (uint8_t*)av_malloc(avio_buffer_size);
+        if (!avio_buffer) return {{-1, "Failed to alloc avio buffer"}};
+
+        avio_ctx = avio_alloc_context(avio_buffer, avio_buffer_size, 0, stream_ctx.get(), read_fn,
+                                      nullptr, seek_fn);
+        if (!avio_ctx) return {{-1, "Failed to alloc AVIOContext"}};
+        if (!seek_fn) avio_ctx->seekable = 0;
+
+        format_ctx.reset(avformat_alloc_context());
+        if (!format_ctx) return {{-1, "Failed to alloc AVFormatContext"}};
+
+        format_ctx->pb = avio_ctx;
+        format_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+        AVFormatContext* raw_fmt_ctx = format_ctx.release();
+        if ((status.status = avformat_open_input(&raw_fmt_ctx, nullptr, nullptr, nullptr)) != 0) {
+            status.error = "avformat_open_input: " + get_error_str(status.status);
+            format_ctx.reset(nullptr);
+            return {status};
+        }
+        format_ctx.reset(raw_fmt_ctx);
+
+        return setupDecoder();
+    }
+
+    /**
+     * readChunk 的 C++ 版本，供混音器等内部调用方使用。
+     * 返回的样本指针指向解码器内部缓冲，在下一次解码之前有效。
+     */
+    DecodedChunk decodeChunk(int chunkSize, SampleFormat format = SampleFormat::PlanarF32) {
+        if (!initialized || !swr_ctx)
+            return {{-1, "Decoder or SwrContext not initialized"}, nullptr, 0, 0, true, -1.0};
+
+        if (m_live && !updateLiveLatency()) {
+            return {{0, ""}, nullptr, 0, codec_ctx->ch_layout.nb_channels, false, -1.0};
+        }
+
+        if (exactPassthrough(format)) return decodePassthrough(chunkSize, format);
+        flushPassthroughFrame();
+
+        int output_channels = codec_ctx->ch_layout.nb_channels;
+
+        DecodedChunk result = {{0, ""}, nullptr, 0, output_channels, false, -1.0};
+        int consecutive_errors = 0;
+
+        if (m_staging_buffers.size() != static_cast<size_t>(output_channels)) {
+            m_staging_buffers.resize(output_channels);
+        }
+
+        m_staging_ptrs.resize(output_channels);
+        for (int ch = 0; ch < output_channels; ch++) {
+            if (m_staging_buffers[ch].size() < static_cast<size_t>(chunkSize)) {
+                m_staging_buffers[ch].resize(chunkSize);
+            }
+        }
+
+        int current_output_samples = 0;
+        double dsp_ms = 0.0;
+        m_spectrum.beginChunk();
+
+        // 归一化增益在反交错时顺带乘上，并在同一循环里统计响度
+        const float norm_target = normalizationTarget();
+        const float norm_step = (norm_target - m_norm_gain) / chunkSize;
+        const bool measure_loudness =
+            m_norm_mode != NormalizationMode::Off && m_norm_tag_gain < 0.0f;
+        double chunk_sum_sq = 0.0;
+        float chunk_peak = 0.0f;
+
+        while (current_output_samples < chunkSize) {
+            int needed_frames = chunkSize - current_output_samples;
+
+            if (m_st_receive_buffer.size() < needed_frames * output_channels) {
+                m_st_receive_buffer.resize(needed_frames * output_channels);
+            }
+
+            // 在取走样本之前计算，得到本 chunk 第一个输出样本的源时间
+            if (result.startTime < 0 && m_stretch.numSamples() > 0) {
+                result.startTime = outputHeadTime();
+            }
+
+            int received_frames =
+                m_stretch.receiveSamples(m_st_receive_buffer.data(), needed_frames);
+
+            if (received_frames > 0) {
+                m_st_stale_ready = std::max<int64_t>(0, m_st_stale_ready - received_frames);
+            } else if (m_decode_done) {
+                if (result.startTime < 0) result.startTime = outputHeadTime();
+                received_frames = m_dsp.drain(m_st_receive_buffer.data(), needed_frames);
+            }
+
+            if (received_frames > 0) {
+                if (m_dsp.active()) {
+                    auto dsp_start = std::chrono::steady_clock::now();
+                    m_dsp.process(m_st_receive_buffer.data(), received_frames);
+                    dsp_ms += std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - dsp_start)
+                                  .count();
+                }
+                m_spectrum.process(m_st_receive_buffer.data(), received_frames, output_channels,
+                                   current_output_samples);
+
+                for (int ch = 0; ch < output_channels; ch++) {
+                    m_staging_ptrs[ch] = m_staging_buffers[ch].data() + current_output_samples;
+                }
+                if (m_norm_mode == NormalizationMode::Off && m_norm_gain == 1.0f) {
+                    m_kernels.deinterleave(m_st_receive_buffer.data(), m_staging_ptrs.data(),
+                                           received_frames, output_channels, 1.0f, 0.0f,
+                                           chunk_sum_sq, chunk_peak);
+                } else {
+                    auto kernel =
+                        measure_loudness ? m_kernels.deinterleaveMeasured : m_kernels.deinterleave;
+                    kernel(m_st_receive_buffer.data(), m_staging_ptrs.data(), received_frames,
+                           output_channels, m_norm_gain, norm_step, chunk_sum_sq, chunk_peak);
+                    m_norm_gain += norm_step * received_frames;
+                }
+                current_output_samples += received_frames;
+
+                if (current_output_samples >= chunkSize) break;
+            }
+
+            if (m_decode_done) {
+                if (received_frames == 0) {
+                    result.isEOF = true;
+                    break;
+                }
+                continue;
+            }
+
+            // 单曲播放到音轨边界：与文件结尾一样排空后级
+            if (m_track_end_reached) {
+                if (m_silence.enabled()) {
+                    m_silence.flush();
+                    feedSilenceOutput();
+                }
+                m_stretch.flush();
+                m_decode_done = true;
+                continue;
+            }
+
+            if (m_reverse) {
+                if (feedReverse(result.status)) continue;
+                if (result.status.status < 0) break;
+                // 到达文件开头
+                m_stretch.flush();
+                m_decode_done = true;
+                continue;
+            }
+
+            if (m_loop_engaged) {
+                feedLoop();
+                continue;
+            }
+
+            if (m_cache_reading && feedFromPcmCache()) continue;
+
+            int receive_ret = avcodec_receive_frame(codec_ctx.get(), frame.get());
+
+            if (receive_ret == 0) {
+                consecutive_errors = 0;
+
+                // swr 内部缓存的样本会排在本帧之前输出
+                int64_t swr_delay = swr_get_delay(swr_ctx.get(), codec_ctx->sample_rate);
+                double frame_time = advanceFrameClock(frame.get()) -
+                                    (double)swr_delay / codec_ctx->sample_rate;
+
+                int dst_nb_samples =
+                    av_rescale_rnd(swr_delay + frame->nb_samples, codec_ctx->sample_rate,
+                                   codec_ctx->sample_rate, AV_ROUND_UP);
+
+                uint8_t** out_data = resample_buffer.grow(output_channels, dst_nb_samples);
+                if (!out_data) {
+                    result.status = {-1, "Failed to allocate resample buffer"};
+                    break;
+                }
+
+                int ret = swr_convert(swr_ctx.get(), out_data, dst_nb_samples,
+                                      (const uint8_t**)frame->data, frame->nb_samples);
+
+                if (ret < 0) {
+                    result.status = {ret, "Swr convert error"};
+                    break;
+                }
+
+                feedDecoded((const float*)out_data[0], ret, frame_time);
+
+                av_frame_unref(frame.get());
+            } else if (receive_ret == AVERROR_EOF) {
+                int64_t delay = swr_get_delay(swr_ctx.get(), codec_ctx->sample_rate);
+                if (delay > 0) {
+                    int dst_nb_samples = av_rescale_rnd(delay, codec_ctx->sample_rate,
+                                                        codec_ctx->sample_rate, AV_ROUND_UP);
+                    uint8_t** out_data = resample_buffer.grow(output_channels, dst_nb_samples);
+
+                    if (out_data) {
+                        double tail_time = (m_next_pts != AV_NOPTS_VALUE)
+                                               ? m_next_pts * av_q2d(m_time_base) -
+                                                     (double)delay / codec_ctx->sample_rate
+                                               : m_current_output_time;
+                        int ret = swr_convert(swr_ctx.get(), out_data, dst_nb_samples, nullptr, 0);
+                        feedDecoded((const float*)out_data[0], ret, tail_time);
+                    }
+                }
+
+                if (m_silence.enabled()) {
+                    m_silence.flush();
+                    feedSilenceOutput();
+                }
+
+                m_stretch.flush();
+                m_decode_done = true;
+            } else if (!feedDecoder(receive_ret, consecutive_errors, result.status)) {
+                break;
+            }
+        }
+
+        if (measure_loudness && current_output_samples > 0) {
+            double chunk_seconds = (double)current_output_samples / codec_ctx->sample_rate;
+            double chunk_ms = chunk_sum_sq / ((double)current_output_samples * output_channels);
+            // 约 3 秒时间常数的指数平均；峰值按 10 秒衰减
+            double a = 1.0 - std::exp(-chunk_seconds / 3.0);
+            m_loudness_ms = m_loudness_ms > 0.0 ? m_loudness_ms + (chunk_ms - m_loudness_ms) * a
+                                                : chunk_ms;
+            float decay = (float)std::exp(-chunk_seconds / 10.0);
+            m_loudness_peak = std::max(chunk_peak, m_loudness_peak * decay);
+        }
+        if (m_norm_mode == NormalizationMode::Off && current_output_samples > 0) {
+            m_norm_gain = 1.0f;
+        }
+
+        if (m_dsp.active()) {
+            m_dsp_last_ms = dsp_ms;
+            m_dsp_total_ms += dsp_ms;
+            m_dsp_chunks++;
+        }
+
+        // 下一个 chunk 在没有新样本可映射时沿用当前输出头部的源时间
+        m_current_output_time = outputHeadTime();
+        if (result.startTime < 0) {
+            result.startTime = m_current_output_time;
+        }
+
+        for (int ch = 0; ch < output_channels; ch++) {
+            m_staging_ptrs[ch] = m_staging_buffers[ch].data();
+        }
+        int total_samples = current_output_samples * output_channels;
+
+        // Interleaved Int16 格式
+        if (format == SampleFormat::InterleavedS16) {
+            m_s16_output.resize(total_samples);
+            m_kernels.interleaveS16(m_staging_ptrs.data(), m_s16_output.data(),
+                                    current_output_samples, output_channels);
+            result.data = m_s16_output.data();
+        } else if (format == SampleFormat::InterleavedS32 ||
+                   format == SampleFormat::InterleavedS24) {
+            m_s32_output.resize(total_samples);
+            m_kernels.interleaveS32(m_staging_ptrs.data(), m_s32_output.data(),
+                                    current_output_samples, output_channels);
+            if (format == SampleFormat::InterleavedS24) {
+                packS24(m_s32_output.data(), reinterpret_cast<uint8_t*>(m_s32_output.data()),
+                        total_samples);
+            }
+            result.data = m_s32_output.data();
+        } else if (format == SampleFormat::InterleavedF32) {
+            m_pcm_output.resize(total_samples);
+            m_kernels.interleaveF32(m_staging_ptrs.data(), m_pcm_output.data(),
+                                    current_output_samples, output_channels);
+            result.data = m_pcm_output.data();
+        } else {  // LLL... RRR... Planer 格式
+            m_pcm_output.resize(total_samples);
+
+            float* dst_ptr = m_pcm_output.data();
+            for (int ch = 0; ch < output_channels; ch++) {
+                if (current_output_samples > 0) {
+                    memcpy(dst_ptr, m_staging_ptrs[ch], current_output_samples * sizeof(float));
+                }
+                dst_ptr += current_output_samples;
+            }
 
-        if ((status.status = avformat_find_stream_info(format_ctx.get(), nullptr)) < 0) {
-            status.error = "avformat_find_stream_info: " + get_error_str(status.status);
-            return {status};
+            result.data = m_pcm_output.data();
         }
 
-        const AVCodec* decoder;
-        if ((audio_stream_index = av_find_best_stream(format_ctx.get(), AVMEDIA_TYPE_AUDIO, -1, -1,
-                                                      &decoder, -1)) < 0) {
-            status.status = audio_stream_index;
-            status.error = "av_find_best_stream: No audio stream found";
-            return {status};
-        }
+        result.frames = current_output_samples;
+        return result;
+    }
 
-        codec_ctx.reset(avcodec_alloc_context3(decoder));
-        if (!codec_ctx) {
-            status.status = -1;
-            status.error = "Failed to alloc context";
-            return {status};
+    ChunkResult readChunk(int chunkSize, SampleFormat format = SampleFormat::PlanarF32) {
+        DecodedChunk chunk = decodeChunk(chunkSize, format);
+        if (chunk.channels == 0) {
+            return {chunk.status, emscripten::val::undefined(), chunk.isEOF, chunk.startTime};
         }
 
-        avcodec_parameters_to_context(codec_ctx.get(),
-                                      format_ctx->streams[audio_stream_index]->codecpar);
+        size_t count = (size_t)chunk.frames * chunk.channels;
+        return {chunk.status, sampleView(format, chunk.data, count), chunk.isEOF,
+                chunk.startTime};
+    }
 
-        if ((status.status = avcodec_open2(codec_ctx.get(), decoder, nullptr)) < 0) {
-            status.error = "avcodec_open2: " + get_error_str(status.status);
-            return {status};
+    /**
+     * 能无损容纳源样本的交错输出格式：整数源按有效位数取 S16 / S24 / S32，浮点源取 F32。
+     * 导出时按它决定 WAV 的位深
+     */
+    SampleFormat nativeSampleFormat() const {
+        if (!initialized) return SampleFormat::InterleavedS16;
+        switch (av_get_packed_sample_fmt(codec_ctx->sample_fmt)) {
+            case AV_SAMPLE_FMT_U8:
+            case AV_SAMPLE_FMT_S16:
+                return SampleFormat::InterleavedS16;
+            case AV_SAMPLE_FMT_S32: {
+                int bits = codec_ctx->bits_per_raw_sample;
+                return bits > 0 && bits <= 24 ? SampleFormat::InterleavedS24
+                                              : SampleFormat::InterleavedS32;
+            }
+            case AV_SAMPLE_FMT_S64:
+                return SampleFormat::InterleavedS32;
+            default:
+                return SampleFormat::InterleavedF32;
         }
+    }
 
-        m_soundTouch.setSampleRate(codec_ctx->sample_rate);
-        m_soundTouch.setChannels(codec_ctx->ch_layout.nb_channels);
-        m_soundTouch.setTempo(1.0);
-        m_soundTouch.setPitch(1.0);
-        m_soundTouch.setRate(1.0);
+    // 声道位掩码（WAVE_FORMAT_EXTENSIBLE 的 dwChannelMask），布局未指定时取该声道数的默认布局
+    uint32_t channelMask() const {
+        if (!initialized) return 0;
+        AVChannelLayout layout = codec_ctx->ch_layout;
+        if (layout.order == AV_CHANNEL_ORDER_UNSPEC) {
+            av_channel_layout_default(&layout, layout.nb_channels);
+        }
+        return layout.order == AV_CHANNEL_ORDER_NATIVE ? (uint32_t)layout.u.mask : 0;
+    }
 
-        swr_ctx.reset(swr_alloc());
-        av_opt_set_chlayout(swr_ctx.get(), "in_chlayout", &codec_ctx->ch_layout, 0);
-        av_opt_set_int(swr_ctx.get(), "in_sample_rate", codec_ctx->sample_rate, 0);
-        av_opt_set_sample_fmt(swr_ctx.get(), "in_sample_fmt", codec_ctx->sample_fmt, 0);
+    /**
+     * 离线任务（导出、分析）的分段计划：把文件按关键帧切成最多 count 段，返回 count + 1 个
+     * 分界点（源样本序号），首个为 0，最后一个为 -1 表示到文件结尾。各段用 beginSegment /
+     * readSegment 在独立的解码器实例上并行解码，按顺序拼接即与整段顺序解码逐样本一致。
+     * 不满足 segmentable 的文件只返回一段 [0, -1]。
+     */
+    std::vector<double> segmentBoundaries(int count) {
+        const double kMinSegmentSeconds = 1.0;
+
+        std::vector<double> bounds = {0.0};
+        if (initialized && count > 1 && format_ctx->duration > 0 && segmentable()) {
+            AVStream* stream = format_ctx->streams[audio_stream_index];
+            int sr = codec_ctx->sample_rate;
+            double duration = (double)format_ctx->duration / AV_TIME_BASE;
+            for (int i = 1; i < count; i++) {
+                double time = duration * i / count;
+                int64_t ts =
+                    av_rescale_q(time * AV_TIME_BASE, AV_TIME_BASE_Q, stream->time_base);
+                // 有索引时对齐到之前的关键帧，各段的预滚从同一个关键帧开始
+                const AVIndexEntry* entry =
+                    avformat_index_get_entry_from_timestamp(stream, ts, AVSEEK_FLAG_BACKWARD);
+                if (entry && entry->timestamp != AV_NOPTS_VALUE) {
+                    time = entry->timestamp * av_q2d(stream->time_base);
+                }
+                double sample = (double)llround(time * sr);
+                if (sample >= bounds.back() + kMinSegmentSeconds * sr) bounds.push_back(sample);
+            }
+        }
+        bounds.push_back(-1.0);
+        return bounds;
+    }
 
-        av_opt_set_chlayout(swr_ctx.get(), "out_chlayout", &codec_ctx->ch_layout, 0);
-        av_opt_set_int(swr_ctx.get(), "out_sample_rate", codec_ctx->sample_rate, 0);
-        av_opt_set_sample_fmt(swr_ctx.get(), "out_sample_fmt", AV_SAMPLE_FMT_FLT, 0);
+    /**
+     * 开始分段解码源样本区间 [start, end)，end < 0 表示到文件结尾。输出交错样本，
+     * 不经过 SoundTouch、DSP 与归一化。从 start 之前 kSegmentPreroll 秒处的关键帧开始解码，
+     * 预滚部分只用来让解码器状态（重叠变换、比特池等）收敛，不输出。
+     * 会移动解码位置，只用于专门的离线解码器实例。
+     */
+    Status beginSegment(double start, double end, SampleFormat format) {
+        if (!initialized) return {-1, "Decoder not initialized"};
+        if (format == SampleFormat::PlanarF32) {
+            return {-1, "Segment decoding only outputs interleaved samples"};
+        }
 
-        if ((status.status = swr_init(swr_ctx.get())) < 0) {
+        Status status = {0, ""};
+        m_seg_swr.reset(swr_alloc());
+        av_opt_set_chlayout(m_seg_swr.get(), "in_chlayout", &codec_ctx->ch_layout, 0);
+        av_opt_set_int(m_seg_swr.get(), "in_sample_rate", codec_ctx->sample_rate, 0);
+        av_opt_set_sample_fmt(m_seg_swr.get(), "in_sample_fmt", codec_ctx->sample_fmt, 0);
+
+        av_opt_set_chlayout(m_seg_swr.get(), "out_chlayout", &codec_ctx->ch_layout, 0);
+        av_opt_set_int(m_seg_swr.get(), "out_sample_rate", codec_ctx->sample_rate, 0);
+        // S24 先转换为 S32，读取时再打包
+        AVSampleFormat out_fmt = AV_SAMPLE_FMT_S32;
+        if (format == SampleFormat::InterleavedS16) out_fmt = AV_SAMPLE_FMT_S16;
+        if (format == SampleFormat::InterleavedF32) out_fmt = AV_SAMPLE_FMT_FLT;
+        av_opt_set_sample_fmt(m_seg_swr.get(), "out_sample_fmt", out_fmt, 0);
+
+        if ((status.status = swr_init(m_seg_swr.get())) < 0) {
+            m_seg_swr.reset();
             status.error = "Failed to initialize swresample context";
-            return {status};
+            return status;
         }
 
-        packet.reset(av_packet_alloc());
-        frame.reset(av_frame_alloc());
-
-        m_time_base = format_ctx->streams[audio_stream_index]->time_base;
-        m_next_pts = AV_NOPTS_VALUE;
+        m_seg_format = format;
+        m_seg_start = m_seg_pos = (int64_t)start;
+        m_seg_end = end < 0 ? INT64_MAX : (int64_t)end;
+        m_seg_done = m_seg_pos >= m_seg_end;
+        m_seg_preroll = kSegmentPreroll;
 
-        initialized = true;
+        return seekSegment();
+    }
 
-        std::map<std::string, std::string> meta_map;
-        AVDictionaryEntry* tag = nullptr;
+    // 定位到分段起点之前 m_seg_preroll 秒，返回的目标为 0 时即从文件开头顺序解码
+    Status seekSegment() {
+        double start = (double)m_seg_start / codec_ctx->sample_rate;
+        double target = std::max(0.0, start - m_seg_preroll);
+        if (target == 0) m_seg_preroll = -1;
+        return seekDemuxer(target);
+    }
 
-        while ((tag = av_dict_get(format_ctx->metadata, "", tag, AV_DICT_IGNORE_SUFFIX))) {
-            meta_map[std::string(tag->key)] = std::string(tag->value);
+    // 读取当前分段的下一批样本（至多 maxFrames 帧），分段结束时 isEOF
+    ChunkResult readSegment(int maxFrames) {
+        if (!m_seg_swr) {
+            return {{-1, "Segment not started"}, emscripten::val::undefined(), true, -1.0};
         }
 
-        if (audio_stream_index >= 0 && audio_stream_index < format_ctx->nb_streams) {
-            AVDictionary* stream_meta = format_ctx->streams[audio_stream_index]->metadata;
-            tag = nullptr;
-            while ((tag = av_dict_get(stream_meta, "", tag, AV_DICT_IGNORE_SUFFIX))) {
-                meta_map[std::string(tag->key)] = std::string(tag->value);
+        int sr = codec_ctx->sample_rate;
+        int channels = codec_ctx->ch_layout.nb_channels;
+        bool s24 = m_seg_format == SampleFormat::InterleavedS24;
+        // swr 输出与最终输出的每帧字节数，只有 S24 不同
+        int frame_bytes = channels * (m_seg_format == SampleFormat::InterleavedS16 ? 2 : 4);
+        int out_frame_bytes = channels * bytesPerSample(m_seg_format);
+        double start_time = (double)m_seg_pos / sr;
+        Status status = {0, ""};
+        int consecutive_errors = 0;
+
+        m_seg_out.clear();
+        while (!m_seg_done && m_seg_out.size() < (size_t)maxFrames * out_frame_bytes) {
+            int receive_ret = avcodec_receive_frame(codec_ctx.get(), frame.get());
+            if (receive_ret == 0) {
+                consecutive_errors = 0;
+                int n = frame->nb_samples;
+                int64_t first = llround(advanceFrameClock(frame.get()) * sr);
+                if (m_codec_next_sample >= 0 && std::llabs(first - m_codec_next_sample) <= 1) {
+                    first = m_codec_next_sample;
+                }
+                m_codec_next_sample = first + n;
+
+                int64_t from = std::max(first, m_seg_pos);
+                int64_t to = std::min(first + n, m_seg_end);
+                if (to <= from) {
+                    av_frame_unref(frame.get());
+                    if (first >= m_seg_end) m_seg_done = true;
+                    continue;
+                }
+                // 预滚后的第一帧必须覆盖分段起点，否则与上一段之间会缺样本。关键帧稀疏或
+                // 索引不准时 seek 会越过起点，此时加长预滚重新定位，直到退回文件开头顺序解码。
+                // 首段从文件的第一帧开始，允许起始时间戳大于 0
+                if (from > m_seg_pos && m_seg_pos == m_seg_start && m_seg_start > 0) {
+                    av_frame_unref(frame.get());
+                    if (m_seg_preroll < 0) {
+                        status = {-1, "Seek overshot the segment start"};
+                        break;
+                    }
+                    m_seg_preroll *= 8;
+                    if ((status = seekSegment()).status < 0) break;
+                    continue;
+                }
+
+                m_seg_frame.resize((size_t)n * frame_bytes);
+                uint8_t* dst = m_seg_frame.data();
+                int ret = swr_convert(m_seg_swr.get(), &dst, n, (const uint8_t**)frame->data, n);
+                av_frame_unref(frame.get());
+                if (ret < 0) {
+                    status = {ret, "Swr convert error"};
+                    break;
+                }
+
+                to = std::min(to, first + ret);
+                const uint8_t* src = m_seg_frame.data() + (from - first) * frame_bytes;
+                if (s24) {
+                    size_t at = m_seg_out.size();
+                    m_seg_out.resize(at + (to - from) * out_frame_bytes);
+                    packS24(reinterpret_cast<const int32_t*>(src), m_seg_out.data() + at,
+                            (size_t)(to - from) * channels);
+                } else {
+                    m_seg_out.insert(m_seg_out.end(), src, src + (to - from) * frame_bytes);
+                }
+                m_seg_pos = to;
+                if (m_seg_pos >= m_seg_end) m_seg_done = true;
+            } else if (receive_ret == AVERROR_EOF) {
+                m_seg_done = true;
+            } else if (!feedDecoder(receive_ret, consecutive_errors, status)) {
+                break;
             }
         }
 
-        std::vector<uint8_t> cover_data;
+        size_t count = m_seg_out.size() / bytesPerSample(m_seg_format);
+        return {status, sampleView(m_seg_format, m_seg_out.data(), count), m_seg_done,
+                start_time};
+    }
 
-        for (int i = 0; i < format_ctx->nb_streams; i++) {
-            AVStream* st = format_ctx->streams[i];
-            if (st->disposition & AV_DISPOSITION_ATTACHED_PIC) {
-                AVPacket pkt = st->attached_pic;
-                if (pkt.size > 0) {
-                    cover_data.assign(pkt.data, pkt.data + pkt.size);
+    /**
+     * readChunk 的 C ABI 版本，结果写入 m_chunk_header，返回样本指针（没有样本时为空）。
+     * 每个 chunk 只有一次 wasm 调用，不构造 Status / memory_view 等 Embind 对象
+     */
+    const void* readChunkRaw(int chunkSize, SampleFormat format) {
+        DecodedChunk chunk = decodeChunk(chunkSize, format);
+        m_chunk_error = chunk.status.error;
+        m_chunk_header = {chunk.status.status,
+                          chunk.channels ? chunk.frames : 0,
+                          chunk.channels,
+                          chunk.isEOF ? 1 : 0,
+                          chunk.startTime,
+                          m_packet_queue.durationSeconds(m_time_base),
+                          m_chunk_error.c_str(),
+                          chunk.channels ? chunk.data : nullptr};
+        return m_chunk_header.data;
+    }
+
+    const ChunkHeader* chunkHeader() const { return &m_chunk_header; }
+
+    // 供 C ABI 使用的对象地址，在对象生命周期内不变
+    uintptr_t nativeHandle() { return reinterpret_cast<uintptr_t>(this); }
+
+    /**
+     * 配置流模式下的字节块缓存，maxBytes 小于块大小时关闭缓存。
+     * 对已打开的流立即生效（清空已有缓存）。
+     */
+    void setIOCache(int blockSize, double maxBytes) {
+        m_io_cache_block_size = blockSize;
+        m_io_cache_max_bytes = static_cast<int64_t>(maxBytes);
+        if (stream_ctx) stream_ctx->cache.configure(blockSize, m_io_cache_max_bytes);
+    }
+
+    IOCacheStats getIOCacheStats() const {
+        if (!stream_ctx) return {0, 0, 0, 0, 0, 0};
+        IOCacheStats stats = stream_ctx->stats;
+        stats.cachedBytes = (double)stream_ctx->cache.bytes();
+        return stats;
+    }
+
+    /**
+     * 在当前位置切换到另一条音频流。
+     * 复用已打开的 AVFormatContext，只重建解码器和重采样器，然后 seek 回当前源时间。
+     */
+    AudioProperties selectStream(int index) {
+        if (!initialized) return {{-1, "Not initialized"}};
+
+        if (index < 0 || index >= (int)format_ctx->nb_streams ||
+            format_ctx->streams[index]->codecpar->codec_type != AVMEDIA_TYPE_AUDIO) {
+            return {{AVERROR_STREAM_NOT_FOUND, "Not an audio stream: " + std::to_string(index)}};
+        }
+
+        if (index == audio_stream_index) return describeStream();
+
+        double position = stretchHeadTime();
+        int previous_index = audio_stream_index;
+        // 正在单曲播放的 CUE 音轨在新流中保持同一结束时间
+        double track_end =
+            m_track_end >= 0 ? m_track_end / (double)codec_ctx->sample_rate : -1.0;
+
+        Status status = openAudioStream(index);
+        if (status.status >= 0) {
+            restoreTrackEnd(track_end);
+            status = seek(position);
+            if (status.status >= 0) return describeStream();
+        }
+
+        // 新流打不开或无法定位到当前位置时恢复原来的流，保证解码器仍然可用
+        openAudioStream(previous_index);
+        restoreTrackEnd(track_end);
+        seek(position);
+        return {status};
+    }
+
+    /**
+     * 响度归一化。Track/Album 优先使用 ReplayGain/R128 标签（peak 防削波在设置时预先算好），
+     * 没有标签时退化为运行响度估计。增益在输出转换中顺带应用，不额外遍历样本。
+     */
+    void setNormalization(NormalizationMode mode, double preampDb, bool preventClipping) {
+        m_norm_mode = mode;
+        m_norm_preamp_db = preampDb;
+        m_norm_prevent_clipping = preventClipping;
+        updateNormalizationTagGain();
+    }
+
+    /**
+     * 跳过静音：低于 thresholdDb 且持续超过 minSilenceMs 的静音被缩短到 keepMs，
+     * 剪切点做 crossfadeMs 的交叉淡化。在送入 SoundTouch 之前处理，startTime 仍是源时间。
+     * 需要在流打开之后调用。
+     */
+    void setSkipSilence(bool enabled, double thresholdDb, double minSilenceMs, double keepMs,
+                        double crossfadeMs) {
+        m_silence.setParams(enabled, thresholdDb, minSilenceMs, keepMs, crossfadeMs);
+    }
+
+    // 跳过静音累计省掉的源时长（秒）
+    double getSkippedDuration() const { return m_silence.skippedSeconds(); }
+
+    /**
+     * 设置第 index 个均衡频段（0-15），参数变化在下一个 chunk 内平滑过渡
+     */
+    bool setEqBand(int index, EqFilterType type, double freq, double gainDb, double q) {
+        return m_dsp.setBand(index, type, freq, gainDb, q);
+    }
+
+    void disableEqBand(int index) { m_dsp.disableBand(index); }
+
+    void clearEq() { m_dsp.clearBands(); }
+
+    /**
+     * 前瞻峰值限制器，lookaheadMs 同时也是它引入的输出延迟，已计入 startTime
+     */
+    void setLimiter(bool enabled, double thresholdDb, double lookaheadMs, double releaseMs) {
+        m_dsp.setLimiter(enabled, thresholdDb, lookaheadMs, releaseMs);
+    }
+
+    /**
+     * 开启解码端频谱分析：fftSize（64-16384 的 2 的幂，0 关闭）、帧移 hop（样本）、
+     * 对数频带数 bands（1-256）。每次 readChunk 后用 getSpectrum 取本 chunk 的分析帧
+     */
+    bool setSpectrum(int fftSize, int hop, int bands) {
+        int sr = initialized ? codec_ctx->sample_rate : 48000;
+        SpectrumAnalyzer probe;
+        if (!probe.configure(fftSize, hop, bands, sr)) return false;
+
+        m_spectrum_size = fftSize;
+        m_spectrum_hop = hop;
+        m_spectrum_bands = bands;
+        if (initialized) m_spectrum.configure(fftSize, hop, bands, sr);
+        return true;
+    }
+
+    // 最近一次 readChunk 产生的频谱帧，按输出顺序排列
+    SpectrumFrames getSpectrum() const {
+        const std::vector<float>& out = m_spectrum.output();
+        const std::vector<float>& offsets = m_spectrum.offsets();
+        return {
+            emscripten::val(emscripten::memory_view<float>(out.size(), out.data())),
+            emscripten::val(emscripten::memory_view<float>(offsets.size(), offsets.data())),
+            (int)offsets.size(),
+            m_spectrum.bands(),
+        };
+    }
+
+    DspStats getDspStats() const {
+        return {
+            m_dsp_last_ms,
+            m_dsp_chunks > 0 ? m_dsp_total_ms / m_dsp_chunks : 0.0,
+            m_dsp_chunks,
+            m_dsp.latency(),
+        };
+    }
+
+    void setPacketQueueLimits(int maxBytes, double maxSeconds) {
+        m_packet_queue.setLimits(maxBytes, maxSeconds);
+    }
+
+    /**
+     * 向预读队列中解复用最多 maxPackets 个音频包，队列已满或到达文件末尾时提前返回。
+     * 由宿主在确认数据源有足够字节可读时调用，这样真正阻塞的读取只发生在队列耗尽之后。
+     */
+    Status fillPacketQueue(int maxPackets) {
+        if (!initialized) return {-1, "Not initialized"};
+
+        PacketPtr pkt(av_packet_alloc());
+        if (!pkt) return {AVERROR(ENOMEM), "Failed to alloc packet"};
 
+        for (int i = 0; i < maxPackets; i++) {
+            if (m_demux_eof || m_demux_error < 0) break;
+            // 直播流的积压由 trimLiveBacklog 限制，队列满时也要继续读走网络数据
+            if (!m_live && m_packet_queue.full(m_time_base)) break;
+
+            int ret = av_read_frame(format_ctx.get(), pkt.get());
+            if (ret < 0) {
+                if (ret == AVERROR_EOF) {
+                    m_demux_eof = true;
                     break;
                 }
+                m_demux_error = ret;
+                return {ret, "Read frame error: " + get_error_str(ret)};
             }
-        }
 
-        int bits = codec_ctx->bits_per_raw_sample;
+            if (pkt->stream_index != audio_stream_index) {
+                av_packet_unref(pkt.get());
+                continue;
+            }
 
-        if (bits <= 0) {
-            bits = av_get_bytes_per_sample(codec_ctx->sample_fmt) * 8;
+            if (m_live) resolveStreamEvents(pkt.get());
+            if (!m_packet_queue.push(pkt.get())) {
+                av_packet_unref(pkt.get());
+                return {AVERROR(ENOMEM), "Failed to queue packet"};
+            }
+            if (m_live) trimLiveBacklog();
         }
 
+        return {0, ""};
+    }
+
+    /**
+     * 设置直播流的目标延迟与最大延迟（秒，只计抖动缓冲中的数据）。
+     * 起播和读空后缓冲到 targetSeconds 才开始输出；积压超过 targetSeconds 后以 5% 的速度
+     * 追赶（经过 SoundTouch，不变调），超过 maxSeconds 时直接丢弃最旧的包回到目标延迟。
+     */
+    void setLiveLatency(double targetSeconds, double maxSeconds) {
+        m_live_target = std::max(0.1, targetSeconds);
+        m_live_max = std::max(m_live_target + 0.5, maxSeconds);
+    }
+
+    // 取出自上次调用以来新确定时间的直播元数据
+    std::vector<StreamMetadataEvent> takeStreamMetadata() {
+        std::vector<StreamMetadataEvent> events;
+        events.swap(m_stream_events);
+        return events;
+    }
+
+    PacketQueueStatus getPacketQueueStatus() const {
         return {
-            {0, ""},
-            avcodec_get_name(codec_ctx->codec_id),
-            codec_ctx->sample_rate,
-            codec_ctx->ch_layout.nb_channels,
-            format_ctx->duration / static_cast<double>(AV_TIME_BASE),
-            meta_map,
-            cover_data,
-            bits,
+            m_packet_queue.size(),
+            static_cast<int>(m_packet_queue.bytes()),
+            m_packet_queue.durationSeconds(m_time_base),
+            m_packet_queue.full(m_time_base),
+            m_demux_eof,
         };
     }
 
-   public:
-    AudioStreamDecoder() {}
-    ~AudioStreamDecoder() { close(); }
+    Status seek(double timestamp) {
+        if (!initialized) return {-1, "Not initialized"};
+        if (m_live) return {-1, "Live stream is not seekable"};
 
-    void setTempo(double tempo) {
-        m_soundTouch.setTempo(tempo);
-        m_current_tempo = tempo;
+        Status status = {0, ""};
+
+        if (format_ctx->duration > 0) {
+            double file_duration = (double)format_ctx->duration / AV_TIME_BASE;
+            if (timestamp >= file_duration - 0.2) {
+                timestamp = std::max(0.0, file_duration - 0.2);
+            }
+        }
+
+        auto reset_pipeline = [this](double source_time) {
+            m_decode_done = false;
+            m_track_end_reached = false;
+            m_stretch.clear();
+            m_silence.reset();
+            m_dsp.reset();
+            m_spectrum.reset();
+            resetStretchClock(source_time);
+        };
+
+        int frames = 0;
+        int64_t target = llround(timestamp * codec_ctx->sample_rate);
+
+        // 倒放只移动读取位置，需要时 feedReverse 再定位解码器；已解码的块仍可复用
+        if (m_reverse) {
+            m_cache_reading = false;
+            m_rev_pos = target;
+            reset_pipeline((double)target / codec_ctx->sample_rate);
+            return status;
+        }
+
+        // 目标在循环区间内：直接从常驻样本输出；区间外则退出区间，正向播放到 A 时再进入
+        m_loop_engaged = false;
+        if (m_loop_active && target >= m_loop_start && target < m_loop_end) {
+            m_cache_reading = false;
+            m_loop_engaged = true;
+            m_loop_pos = target;
+            reset_pipeline((double)target / codec_ctx->sample_rate);
+            return status;
+        }
+
+        // 目标在 PCM 缓存中：解复用器和解码器保持原样，缓存读完后再按需重新定位
+        if (m_pcm_cache.enabled() && m_pcm_cache.peek(target, frames)) {
+            m_pcm_cache_stats.seekHits++;
+            if (m_pt_frame) av_frame_unref(m_pt_frame.get());
+            m_pt_offset = 0;
+            m_cache_reading = true;
+            m_cache_pos = target;
+            reset_pipeline((double)target / codec_ctx->sample_rate);
+            return status;
+        }
+        if (m_pcm_cache.enabled()) m_pcm_cache_stats.seekMisses++;
+
+        if ((status = seekDemuxer(timestamp)).status < 0) {
+            return status;
+        }
+
+        m_cache_reading = false;
+        reset_pipeline(timestamp);
+
+        return status;
     }
 
-    void setPitch(double pitch) { m_soundTouch.setPitch(pitch); }
+    /**
+     * 跳到第 index 个章节的开头。按容器中的章节时间定位，并丢弃关键帧到章节起点之间的样本，
+     * 第一个 chunk 的 startTime 精确等于章节开始时间
+     */
+    Status seekChapter(int index) {
+        if (!initialized) return {-1, "Not initialized"};
+        if (index < 0 || index >= (int)format_ctx->nb_chapters) {
+            return {-1, "Chapter index out of range"};
+        }
 
-    AudioProperties init(std::string path) {
-        av_log_set_level(AV_LOG_ERROR);
-        close();
+        const AVChapter* ch = format_ctx->chapters[index];
+        return seekExact(ch->start * av_q2d(ch->time_base));
+    }
 
-        Status status = {0, ""};
-        AVFormatContext* raw_fmt_ctx = nullptr;
+    /**
+     * 加载 CUE 表，text 为空时使用文件内嵌的 CUESHEET 标签（FLAC、APE、WavPack 常见）。
+     * 返回解析出的音轨，没有可用的 CUE 时为空
+     */
+    std::vector<CueTrack> loadCueSheet(std::string text) {
+        m_cue_tracks.clear();
+        if (!initialized) return m_cue_tracks;
+
+        if (text.empty()) {
+            AVDictionaryEntry* tag = av_dict_get(format_ctx->metadata, "cuesheet", nullptr, 0);
+            if (!tag) {
+                AVStream* stream = format_ctx->streams[audio_stream_index];
+                tag = av_dict_get(stream->metadata, "cuesheet", nullptr, 0);
+            }
+            if (!tag) return m_cue_tracks;
+            text = tag->value;
+        }
+
+        double duration = format_ctx->duration > 0
+                              ? format_ctx->duration / static_cast<double>(AV_TIME_BASE)
+                              : 0.0;
+        m_cue_tracks = parseCueSheet(text, duration);
+        return m_cue_tracks;
+    }
+
+    /**
+     * 从 CUE 音轨 index 的 INDEX 01 样本开始播放，不重新打开文件。
+     * continuous 时越过音轨边界继续播放后续音轨，中间没有间隙；
+     * 否则在下一轨的起点精确结束（isEOF）
+     */
+    Status playCueTrack(int index, bool continuous) {
+        if (!initialized) return {-1, "Not initialized"};
+        if (index < 0 || index >= (int)m_cue_tracks.size()) {
+            return {-1, "Cue track index out of range"};
+        }
+
+        const CueTrack& track = m_cue_tracks[index];
+        // 时长未知时最后一轨没有结束位置，播放到文件结尾
+        bool bounded = !continuous && track.end > track.start;
+        m_track_end = bounded ? llround(track.end * codec_ctx->sample_rate) : -1;
+        return seekExact(track.start);
+    }
+
+    // seek 到 start，并丢弃关键帧到 start 之间的样本，第一个 chunk 的 startTime 精确等于 start
+    Status seekExact(double start) {
+        Status status = seek(start);
+        if (status.status < 0) return status;
+
+        // 缓存、循环区间和倒放本身就按样本定位，只有经过解复用器的 seek 落在关键帧上
+        // seek 会把过于靠近文件末尾的目标往前挪，以它实际采用的时间为准
+        if (!m_cache_reading && !m_loop_engaged && !m_reverse) {
+            m_discard_until =
+                llround(std::min(start, m_current_output_time) * codec_ctx->sample_rate);
+        }
+        return status;
+    }
+
+    /**
+     * 开启已解码 PCM 缓存，maxBytes 小于一个块（32768 帧）时关闭。
+     * 对当前流立即生效（清空已有缓存），切换音频流时按新的声道数重建。
+     */
+    void setPcmCache(double maxBytes) {
+        m_pcm_cache_max_bytes = static_cast<int64_t>(maxBytes);
+        m_cache_reading = false;
+        m_pcm_cache.configure(initialized ? codec_ctx->ch_layout.nb_channels : 0,
+                              m_pcm_cache_max_bytes);
+    }
+
+    /**
+     * 设置 A-B 循环。区间 [start, end) 立即解码并常驻内存（优先取自 PCM 缓存），
+     * 末尾 crossfadeMs 与 A 之前的样本做等功率交叉淡化，回绕处没有间隙。
+     * 样本在 SoundTouch 之前循环，变速、变调照常生效。解码区间会移动解码器，
+     * 调用后需要 seek 到当前位置；播放到 A 时进入循环，倒放时不循环。
+     */
+    Status setLoop(double start, double end, double crossfadeMs) {
+        if (!initialized) return {-1, "Not initialized"};
+        if (m_live) return {-1, "Live stream is not seekable"};
+        const double kMaxLoopSeconds = 120.0;
+
+        int sr = codec_ctx->sample_rate;
+        int channels = codec_ctx->ch_layout.nb_channels;
+        int64_t a = llround(std::max(0.0, start) * sr);
+        int64_t b = llround(end * sr);
+        if (b <= a) return {-1, "Invalid loop region"};
+        if (b - a > (int64_t)(kMaxLoopSeconds * sr)) return {-1, "Loop region too long"};
+
+        int64_t fade = std::min({(int64_t)llround(std::max(0.0, crossfadeMs) / 1000.0 * sr), a,
+                                 (b - a) / 2});
+
+        // region 的前 fade 帧是 A 之前的样本，用于淡入回绕后的衔接
+        std::vector<float> region;
+        int64_t filled_end = a - fade;
+        Status status = decodeRange(a - fade, b, region, filled_end);
+        if (status.status < 0) return status;
+        b = filled_end;
+        if (b - a <= fade) return {-1, "Loop region is outside the file"};
+
+        m_loop_buf.assign(region.begin() + fade * channels, region.end());
+        int64_t length = b - a;
+        for (int64_t i = 0; i < fade; i++) {
+            double t = (i + 0.5) / fade;
+            float fade_in = (float)std::sin(t * M_PI / 2);
+            float fade_out = (float)std::cos(t * M_PI / 2);
+            float* dst = m_loop_buf.data() + (size_t)(length - fade + i) * channels;
+            const float* pre = region.data() + (size_t)i * channels;
+            for (int ch = 0; ch < channels; ch++) {
+                dst[ch] = dst[ch] * fade_out + pre[ch] * fade_in;
+            }
+        }
+
+        m_loop_active = true;
+        m_loop_engaged = false;
+        m_loop_start = a;
+        m_loop_end = b;
+        m_cache_reading = false;
+        return status;
+    }
+
+    // 取消 A-B 循环，从区间内的当前位置无缝继续正向播放
+    void clearLoop() {
+        if (!initialized) return;
+        if (m_loop_engaged) resumeForwardAt(m_loop_pos);
+        m_loop_active = false;
+        m_loop_engaged = false;
+        std::vector<float>().swap(m_loop_buf);
+    }
+
+    /**
+     * 切换倒放。从当前输出位置开始反向（或恢复正向）播放，startTime 随之递减。
+     * 倒放时不做静音跳过，也不走整数直通。
+     */
+    Status setReverse(bool enabled) {
+        if (!initialized) return {-1, "Not initialized"};
+        if (m_live && enabled) return {-1, "Live stream is not seekable"};
+        if (enabled == m_reverse) return {0, ""};
+
+        double position = stretchHeadTime();
+        m_reverse = enabled;
+        if (!enabled) {
+            m_rev_block.clear();
+            m_rev_block_start = m_rev_block_end = 0;
+        }
+        return seek(position);
+    }
+
+    PcmCacheStats getPcmCacheStats() const {
+        PcmCacheStats stats = m_pcm_cache_stats;
+        stats.cachedBytes = (double)m_pcm_cache.bytes();
+        return stats;
+    }
+
+    /**
+     * 从播放解码器的 PCM 缓存中取 position 开始的 frames 帧预览（PlanarF32），不改变解码位置，
+     * 可以在播放中随时调用。缓存没有 position 处的样本时返回 0 帧，调用方改用另一个解码器的
+     * scrubPreview；缓存中途断开时只返回连续的部分。
+     */
+    ChunkResult cachedPreview(double position, int frames) {
+        if (!initialized) return {{-1, "Not initialized"}, emscripten::val::undefined(), true};
+
+        int channels = codec_ctx->ch_layout.nb_channels;
+        int64_t target = llround(position * codec_ctx->sample_rate);
+        ChunkResult result = {{0, ""}, emscripten::val::undefined(), false, position};
+
+        m_scrub_buffer.clear();
+        int cached = 0;
+        const float* data = m_pcm_cache.enabled() ? m_pcm_cache.peek(target, cached) : nullptr;
+        int64_t pos = target;
+        while (data && (int)(m_scrub_buffer.size() / channels) < frames) {
+            int n = std::min(cached, frames - (int)(m_scrub_buffer.size() / channels));
+            m_scrub_buffer.insert(m_scrub_buffer.end(), data, data + (size_t)n * channels);
+            pos += n;
+            data = m_pcm_cache.peek(pos, cached);
+        }
+        result.startTime = (double)target / codec_ctx->sample_rate;
+        return finishScrub(result, channels);
+    }
+
+    /**
+     * 拖动进度条时的快速预览：定位到离 position 最近的关键帧（不解码丢弃到精确位置），
+     * 解码 frames 帧后直接返回 PlanarF32，不经过静音跳过、SoundTouch 与 DSP。
+     * startTime 为预览片段实际的源时间。预览会打断正常解码的位置，继续播放前需要 seek，
+     * 因此应使用单独的解码器；播放解码器缓存中已有的位置用 cachedPreview。
+     */
+    ChunkResult scrubPreview(double position, int frames) {
+        if (!initialized) return {{-1, "Not initialized"}, emscripten::val::undefined(), true};
+
+        int sr = codec_ctx->sample_rate;
+        int channels = codec_ctx->ch_layout.nb_channels;
+        ChunkResult result = {{0, ""}, emscripten::val::undefined(), false, position};
+
+        m_scrub_buffer.clear();
+        m_scrub_buffer.reserve((size_t)frames * channels);
+
+        {
+            m_decode_done = false;
+            m_cache_reading = false;
+            m_stretch.clear();
+            m_silence.reset();
+            m_dsp.reset();
+            resetStretchClock(position);
+
+            if ((result.status = seekDemuxer(position, true)).status < 0) {
+                result.isEOF = true;
+                return result;
+            }
+
+            int consecutive_errors = 0;
+            result.startTime = -1.0;
+
+            while ((int)(m_scrub_buffer.size() / channels) < frames) {
+                int receive_ret = avcodec_receive_frame(codec_ctx.get(), frame.get());
+                if (receive_ret == 0) {
+                    consecutive_errors = 0;
+                    double frame_time = advanceFrameClock(frame.get());
+                    if (result.startTime < 0) result.startTime = frame_time;
+
+                    int dst_nb_samples =
+                        (int)swr_get_delay(swr_ctx.get(), sr) + frame->nb_samples;
+                    uint8_t** out_data = resample_buffer.grow(channels, dst_nb_samples);
+                    if (!out_data) {
+                        result.status = {-1, "Failed to allocate resample buffer"};
+                        break;
+                    }
+                    int ret = swr_convert(swr_ctx.get(), out_data, dst_nb_samples,
+                                          (const uint8_t**)frame->data, frame->nb_samples);
+                    av_frame_unref(frame.get());
+                    if (ret < 0) {
+                        result.status = {ret, "Swr convert error"};
+                        break;
+                    }
+
+                    int n = std::min(ret, frames - (int)(m_scrub_buffer.size() / channels));
+                    const float* src = (const float*)out_data[0];
+                    m_scrub_buffer.insert(m_scrub_buffer.end(), src, src + (size_t)n * channels);
+                } else if (receive_ret == AVERROR_EOF) {
+                    result.isEOF = true;
+                    break;
+                } else if (!feedDecoder(receive_ret, consecutive_errors, result.status)) {
+                    break;
+                }
+            }
+
+            if (result.startTime < 0) result.startTime = position;
+            // 预览没有解码到的位置，下一次 readChunk 之前应当 seek
+            m_current_output_time = result.startTime;
+        }
+
+        return finishScrub(result, channels);
+    }
+
+    bool isOpen() const { return initialized; }
+    bool isLive() const { return m_live; }
+    int sampleRate() const { return initialized ? codec_ctx->sample_rate : 0; }
+    int channelCount() const { return initialized ? codec_ctx->ch_layout.nb_channels : 0; }
+
+    // 每个输出帧对应的源时长（秒），随 tempo/rate 变化
+    double sourceSecondsPerFrame() {
+        if (!initialized || codec_ctx->sample_rate <= 0) return 0.0;
+        double ratio = m_stretch.getInputOutputSampleRatio();
+        if (ratio <= 0) ratio = 1.0;
+        return 1.0 / (ratio * codec_ctx->sample_rate);
+    }
+
+    void close() {
+        m_packet_queue.clear();
+        m_demux_eof = false;
+        m_demux_error = 0;
+        m_decode_done = false;
+
+        packet.reset();
+        frame.reset();
+        m_pt_frame.reset();
+        m_pt_offset = 0;
+        m_pcm_cache.clear();
+        m_pcm_cache_stats = {0, 0, 0, 0};
+        m_reverse = false;
+        std::vector<float>().swap(m_rev_block);
+        m_loop_active = m_loop_engaged = false;
+        std::vector<float>().swap(m_loop_buf);
+        m_rev_block_start = m_rev_block_end = 0;
+        m_cache_reading = false;
+        m_codec_next_sample = -1;
+        m_cache_warmup_left = 0;
+        m_discard_until = -1;
+        m_cue_tracks.clear();
+        m_track_end = -1;
+        m_track_end_reached = false;
+        m_live = m_live_buffering = m_live_catching_up = false;
+        m_seg_swr.reset();
+        m_seg_done = true;
+        m_stream_events.clear();
+        swr_ctx.reset();
+        codec_ctx.reset();
+        format_ctx.reset();
+        resample_buffer.reset();
 
-        if ((status.status = avformat_open_input(&raw_fmt_ctx, path.c_str(), nullptr, nullptr)) !=
-            0) {
-            status.error = "avformat_open_input: " + get_error_str(status.status);
-            return {status};
+        if (avio_ctx) {
+            av_freep(&avio_ctx->buffer);
+            avio_context_free(&avio_ctx);
+            avio_ctx = nullptr;
+            avio_buffer = nullptr;
         }
-        format_ctx.reset(raw_fmt_ctx);
+        stream_ctx.reset();
 
-        return setupDecoder();
+        initialized = false;
+        m_next_pts = AV_NOPTS_VALUE;
+        m_stretch.clear();
+        resetStretchClock(0.0);
+
+        for (auto& buf : m_staging_buffers) {
+            std::vector<float>().swap(buf);
+        }
+        m_staging_buffers.clear();
+        m_staging_ptrs.clear();
+        std::vector<float>().swap(m_pcm_output);
+        std::vector<int16_t>().swap(m_s16_output);
+        std::vector<int32_t>().swap(m_s32_output);
     }
+};
 
-    AudioProperties initStream(emscripten::val readFn, emscripten::val seekFn) {
-        av_log_set_level(AV_LOG_ERROR);
-        close();
+enum class CrossfadeCurve { Linear = 0, EqualPower = 1, SCurve = 2 };
 
-        Status status = {0, ""};
+struct MixChunkResult {
+    Status status;
+    emscripten::val samples;
+    bool isEOF;
+    double startTime;
+    // 第一个样本所属曲目的序号，每切换一次加 1
+    int trackIndex;
+    // 本 chunk 中下一首开始淡入的帧，-1 表示本 chunk 没有开始过渡
+    int transitionFrame;
+    int sampleRate;
+    int channels;
+};
 
-        stream_ctx = std::make_unique<StreamContext>(StreamContext{readFn, seekFn});
+/**
+ * 混音器 C ABI（mixer_read_chunk）的结果头：前 40 字节与 ChunkHeader 相同，之后为
+ * 40 trackIndex, 44 transitionFrame, 48 mixed
+ */
+struct MixChunkHeader {
+    ChunkHeader chunk;
+    int32_t trackIndex;
+    int32_t transitionFrame;
+    // 为 0 时样本直接来自当前解码器，频谱等逐 chunk 的附加数据与样本对齐
+    int32_t mixed;
+};
 
-        const int avio_buffer_size = 32768;
-        avio_buffer = (uint8_t*)av_malloc(avio_buffer_size);
-        if (!avio_buffer) return {{-1, "Failed to alloc avio buffer"}};
+#ifdef __EMSCRIPTEN__
+static_assert(offsetof(MixChunkHeader, trackIndex) == 40, "MixChunkHeader layout");
+static_assert(offsetof(MixChunkHeader, transitionFrame) == 44, "MixChunkHeader layout");
+static_assert(offsetof(MixChunkHeader, mixed) == 48, "MixChunkHeader layout");
+#endif
+
+/**
+ * 持有两个 AudioStreamDecoder 的交叉淡化混音器，对外只输出一路流。
+ * 没有排队的下一首时直接输出当前解码器的 chunk，不做拷贝；排队后当前曲目始终多解码
+ * 一个淡化长度的样本，到达 EOF 时手里正好是它的尾巴，下一首只在淡化开始时才开始解码。
+ * 两首曲目采样率或声道数不同、或输出格式不是 PlanarF32 时退化为无缝硬切换。
+ */
+class CrossfadeMixer {
+   private:
+    struct TimeMark {
+        int frames;
+        double start_time;
+        double seconds_per_frame;
+    };
+
+    // 某个解码器已解码、尚未输出的 planar 样本
+    struct TrackBuffer {
+        std::vector<std::vector<float>> planar;
+        int offset = 0;
+        std::deque<TimeMark> times;
+        bool eof = false;
+
+        int available() const { return planar.empty() ? 0 : (int)planar[0].size() - offset; }
+
+        void clear() {
+            for (auto& ch : planar) ch.clear();
+            offset = 0;
+            times.clear();
+            eof = false;
+        }
 
-        avio_ctx = avio_alloc_context(avio_buffer, avio_buffer_size, 0, stream_ctx.get(),
-                                      &read_packet_wrapper, nullptr, &seek_wrapper);
-        if (!avio_ctx) return {{-1, "Failed to alloc AVIOContext"}};
+        void append(const DecodedChunk& chunk, double seconds_per_frame) {
+            if (planar.size() != (size_t)chunk.channels) {
+                clear();
+                planar.resize(chunk.channels);
+            }
+            if (chunk.frames <= 0) return;
 
-        format_ctx.reset(avformat_alloc_context());
-        if (!format_ctx) return {{-1, "Failed to alloc AVFormatContext"}};
+            const float* src = static_cast<const float*>(chunk.data);
+            for (int ch = 0; ch < chunk.channels; ch++) {
+                planar[ch].insert(planar[ch].end(), src + ch * chunk.frames,
+                                  src + (ch + 1) * chunk.frames);
+            }
+            times.push_back({chunk.frames, chunk.startTime, seconds_per_frame});
+        }
 
-        format_ctx->pb = avio_ctx;
-        format_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+        double headTime() const {
+            if (times.empty()) return -1.0;
+            return times.front().start_time;
+        }
 
-        AVFormatContext* raw_fmt_ctx = format_ctx.release();
-        if ((status.status = avformat_open_input(&raw_fmt_ctx, nullptr, nullptr, nullptr)) != 0) {
-            status.error = "avformat_open_input: " + get_error_str(status.status);
-            format_ctx.reset(nullptr);
-            return {status};
+        void consume(int frames) {
+            offset += frames;
+            while (frames > 0 && !times.empty()) {
+                TimeMark& mark = times.front();
+                int n = std::min(frames, mark.frames);
+                mark.frames -= n;
+                mark.start_time += n * mark.seconds_per_frame;
+                frames -= n;
+                if (mark.frames == 0) times.pop_front();
+            }
+
+            // 已消费的部分超过一半时整体前移，避免缓冲无限增长
+            if (!planar.empty() && offset > (int)planar[0].size() / 2) {
+                for (auto& ch : planar) ch.erase(ch.begin(), ch.begin() + offset);
+                offset = 0;
+            }
         }
-        format_ctx.reset(raw_fmt_ctx);
+    };
+
+    AudioStreamDecoder m_decoders[2];
+    TrackBuffer m_buffers[2];
+    int m_current = 0;
+    bool m_has_next = false;
+    int m_track_index = 0;
+
+    double m_fade_seconds = 5.0;
+    CrossfadeCurve m_curve = CrossfadeCurve::EqualPower;
+    // 打开曲目会重置解码器的变速参数，新曲目打开后重新应用
+    double m_tempo = 1.0;
+    double m_pitch = 1.0;
+
+    bool m_fading = false;
+    int m_fade_total = 0;
+    int m_fade_pos = 0;
+
+    std::vector<std::vector<float>> m_staging;
+    std::vector<float> m_out;
+    // 淡化曲线，每块按帧计算一次，各声道共用
+    std::vector<float> m_gain_out;
+    std::vector<float> m_gain_in;
+
+    MixChunkHeader m_header = {};
+    std::string m_error;
+    // 最近一个 chunk 的采样率，供 Embind 的 readChunk 返回
+    int m_chunk_rate = 0;
+
+    int next() const { return 1 - m_current; }
+
+    bool nextCompatible() {
+        AudioStreamDecoder& cur = m_decoders[m_current];
+        AudioStreamDecoder& nxt = m_decoders[next()];
+        return m_has_next && nxt.sampleRate() == cur.sampleRate() &&
+               nxt.channelCount() == cur.channelCount();
+    }
 
-        return setupDecoder();
+    int fadeFrames() const {
+        return std::max(0, (int)(m_fade_seconds * m_decoders[m_current].sampleRate()));
     }
 
-    ChunkResult readChunk(int chunkSize, SampleFormat format = SampleFormat::PlanarF32) {
-        if (!initialized || !swr_ctx)
-            return {
-                {-1, "Decoder or SwrContext not initialized"},
-                emscripten::val::undefined(),
-                true,
-            };
-
-        ChunkResult result;
-        result.status.status = 0;
-        result.isEOF = false;
-        result.startTime = m_current_output_time;
-        int consecutive_errors = 0;
+    void applySpeed(AudioStreamDecoder& decoder) {
+        decoder.setTempo(m_tempo);
+        decoder.setPitch(m_pitch);
+    }
 
-        int output_channels = codec_ctx->ch_layout.nb_channels;
+    // 从 slot 解码，直到缓冲中至少有 frames 帧或到达 EOF
+    Status fill(int slot, int frames, int chunk_size) {
+        TrackBuffer& buf = m_buffers[slot];
+        AudioStreamDecoder& decoder = m_decoders[slot];
 
-        if (m_staging_buffers.size() != static_cast<size_t>(output_channels)) {
-            m_staging_buffers.resize(output_channels);
+        while (!buf.eof && buf.available() < frames) {
+            DecodedChunk chunk = decoder.decodeChunk(chunk_size, SampleFormat::PlanarF32);
+            if (chunk.status.status < 0 && chunk.status.status != AVERROR_EOF) {
+                return chunk.status;
+            }
+            buf.append(chunk, decoder.sourceSecondsPerFrame());
+            if (chunk.isEOF) buf.eof = true;
         }
+        return {0, ""};
+    }
 
-        for (auto& buf : m_staging_buffers) {
-            buf.clear();
-            buf.reserve(chunkSize);
+    // 计算从 m_fade_pos 起 frames 帧的淡出/淡入增益；等功率曲线按固定角步长旋转，每块只算一次三角函数
+    void fillGains(int frames) {
+        m_gain_out.resize(frames);
+        m_gain_in.resize(frames);
+        const double total = m_fade_total;
+
+        switch (m_curve) {
+            case CrossfadeCurve::Linear:
+            case CrossfadeCurve::SCurve:
+                for (int i = 0; i < frames; i++) {
+                    double x = (m_fade_pos + i + 0.5) / total;
+                    if (m_curve == CrossfadeCurve::SCurve) x = x * x * (3.0 - 2.0 * x);
+                    m_gain_in[i] = (float)x;
+                    m_gain_out[i] = 1.0f - m_gain_in[i];
+                }
+                break;
+            case CrossfadeCurve::EqualPower:
+            default: {
+                const double step = M_PI / 2.0 / total;
+                const double theta = (m_fade_pos + 0.5) * step;
+                const double dc = std::cos(step), ds = std::sin(step);
+                double c = std::cos(theta), s = std::sin(theta);
+                for (int i = 0; i < frames; i++) {
+                    m_gain_out[i] = (float)c;
+                    m_gain_in[i] = (float)s;
+                    double nc = c * dc - s * ds;
+                    s = s * dc + c * ds;
+                    c = nc;
+                }
+                break;
+            }
         }
+    }
 
-        int current_output_samples = 0;
-        bool decode_done = false;
-
-        while (current_output_samples < chunkSize) {
-            int needed_frames = chunkSize - current_output_samples;
+    void copyFrames(TrackBuffer& buf, int frames) {
+        for (size_t ch = 0; ch < m_staging.size(); ch++) {
+            const float* src = buf.planar[ch].data() + buf.offset;
+            m_staging[ch].insert(m_staging[ch].end(), src, src + frames);
+        }
+        buf.consume(frames);
+    }
 
-            if (m_st_receive_buffer.size() < needed_frames * output_channels) {
-                m_st_receive_buffer.resize(needed_frames * output_channels);
+    // 输出 frames 帧过渡：前 overlap 帧与下一首混合，之后（下一首已经结束）只有淡出的当前曲目
+    void mixFade(TrackBuffer& out_buf, TrackBuffer& in_buf, int frames, int overlap) {
+        fillGains(frames);
+        const float* g_out = m_gain_out.data();
+        const float* g_in = m_gain_in.data();
+
+        for (size_t ch = 0; ch < m_staging.size(); ch++) {
+            const float* a = out_buf.planar[ch].data() + out_buf.offset;
+            auto& dst = m_staging[ch];
+            if (overlap > 0) {
+                const float* b = in_buf.planar[ch].data() + in_buf.offset;
+                for (int i = 0; i < overlap; i++) dst.push_back(a[i] * g_out[i] + b[i] * g_in[i]);
             }
+            for (int i = overlap; i < frames; i++) dst.push_back(a[i] * g_out[i]);
+        }
+        out_buf.consume(frames);
+        if (overlap > 0) in_buf.consume(overlap);
+    }
 
-            int received_frames =
-                m_soundTouch.receiveSamples(m_st_receive_buffer.data(), needed_frames);
+    void switchToNext() {
+        m_decoders[m_current].close();
+        m_buffers[m_current].clear();
+        m_current = next();
+        m_has_next = false;
+        m_fading = false;
+        m_track_index++;
+    }
 
-            if (received_frames > 0) {
-                const float* ptr = m_st_receive_buffer.data();
-                for (int i = 0; i < received_frames; i++) {
-                    for (int ch = 0; ch < output_channels; ch++) {
-                        m_staging_buffers[ch].push_back(*ptr++);
-                    }
-                }
-                current_output_samples += received_frames;
+    const MixChunkHeader* fail(const char* error) {
+        m_error = error;
+        m_header.chunk = {-1, 0, 0, 1, -1.0, 0.0, m_error.c_str(), nullptr};
+        m_header.mixed = 0;
+        return &m_header;
+    }
 
-                if (current_output_samples >= chunkSize) break;
-            }
+    // 直接输出当前解码器的 chunk
+    const MixChunkHeader* passThrough(int chunkSize, SampleFormat format) {
+        AudioStreamDecoder& cur = m_decoders[m_current];
+        m_chunk_rate = cur.sampleRate();
+        cur.readChunkRaw(chunkSize, format);
+        m_header.chunk = *cur.chunkHeader();
+        m_header.mixed = 0;
+
+        // 不能淡化的输出格式：当前曲目结束后无缝切换，下一个 chunk 开始输出下一首
+        if (m_header.chunk.isEOF && m_has_next &&
+            (m_header.chunk.status >= 0 || m_header.chunk.status == AVERROR_EOF)) {
+            switchToNext();
+            m_error.clear();
+            m_header.chunk.status = 0;
+            m_header.chunk.error = m_error.c_str();
+            m_header.chunk.isEOF = 0;
+        }
+        return &m_header;
+    }
 
-            if (decode_done) {
-                if (received_frames == 0) {
-                    result.isEOF = true;
-                    break;
-                }
-                continue;
-            }
+    // 经过缓冲输出一个 PlanarF32 chunk；切换到格式不同的曲目且还没有输出样本时返回 false
+    bool mix(int chunkSize) {
+        AudioStreamDecoder& cur = m_decoders[m_current];
+        const int channels = cur.channelCount();
+        m_chunk_rate = cur.sampleRate();
+        m_staging.resize(channels);
+        for (auto& ch : m_staging) {
+            ch.clear();
+            ch.reserve(chunkSize);
+        }
 
-            int receive_ret = avcodec_receive_frame(codec_ctx.get(), frame.get());
+        Status status = {0, ""};
+        bool is_eof = false;
+        double start_time = -1.0;
+        m_header.transitionFrame = -1;
 
-            if (receive_ret == 0) {
-                consecutive_errors = 0;
+        const int fade_frames = fadeFrames();
+        int produced = 0;
 
-                // 获取当前帧的 PTS
-                int64_t current_pts = frame->pts;
-                if (current_pts == AV_NOPTS_VALUE) {
-                    current_pts = frame->best_effort_timestamp;
-                }
+        while (produced < chunkSize) {
+            TrackBuffer& out_buf = m_buffers[m_current];
 
-                // 如果当前帧有 PTS，强制更新内部时钟；否则沿用递推值
-                if (current_pts != AV_NOPTS_VALUE) {
-                    m_next_pts = current_pts;
+            if (!m_fading) {
+                if (m_has_next) {
+                    status = fill(m_current, chunkSize - produced + fade_frames, chunkSize);
+                    if (status.status < 0) break;
                 }
-
-                // 如果是流的开头且没有 PTS，假定从 0 开始
-                if (m_next_pts == AV_NOPTS_VALUE) {
-                    m_next_pts = 0;
+                if (start_time < 0) start_time = out_buf.headTime();
+
+                // 有下一首时保留一个淡化长度；到 EOF 后只有能淡化时才保留尾巴
+                bool can_fade = out_buf.eof && fade_frames > 0 && nextCompatible();
+                int reserve = m_has_next && !out_buf.eof ? fade_frames : 0;
+                if (can_fade) reserve = std::min(fade_frames, out_buf.available());
+                int n = std::min(chunkSize - produced, out_buf.available() - reserve);
+                if (n > 0) {
+                    copyFrames(out_buf, n);
+                    produced += n;
+                    continue;
                 }
 
-                // 如果是本 Chunk 的第一帧数据，记录起始时间
-                if (result.startTime < 0) {
-                    result.startTime = m_next_pts * av_q2d(m_time_base);
-                }
+                // 没有下一首：缓冲中剩下的样本输出完，之后回到直通
+                if (!m_has_next && !out_buf.eof) break;
+                if (!out_buf.eof) continue;
 
-                // 计算当前帧持续时间并累加到 m_next_pts
-                // 时长 = 样本数 / 采样率，需要转换到 m_time_base 单位
-                if (frame->nb_samples > 0) {
-                    int64_t duration = av_rescale_q(
-                        frame->nb_samples, (AVRational){1, codec_ctx->sample_rate}, m_time_base);
-                    m_next_pts += duration;
+                if (can_fade && out_buf.available() > 0) {
+                    m_fading = true;
+                    m_fade_total = out_buf.available();
+                    m_fade_pos = 0;
+                    m_header.transitionFrame = produced;
+                    continue;
                 }
 
-                int dst_nb_samples = av_rescale_rnd(
-                    swr_get_delay(swr_ctx.get(), codec_ctx->sample_rate) + frame->nb_samples,
-                    codec_ctx->sample_rate, codec_ctx->sample_rate, AV_ROUND_UP);
-
-                uint8_t** out_data = resample_buffer.grow(output_channels, dst_nb_samples);
-                if (!out_data) {
-                    result.status = {-1, "Failed to allocate resample buffer"};
+                // 当前曲目已全部输出
+                if (!m_has_next) {
+                    is_eof = true;
                     break;
                 }
 
-                int ret = swr_convert(swr_ctx.get(), out_data, dst_nb_samples,
-                                      (const uint8_t**)frame->data, frame->nb_samples);
-
-                if (ret < 0) {
-                    result.status = {ret, "Swr convert error"};
+                bool compatible = nextCompatible();
+                switchToNext();
+                // 格式不同：提前结束本 chunk，下一个 chunk 以新格式输出
+                if (!compatible) {
+                    if (produced == 0) return false;
                     break;
                 }
+                m_header.transitionFrame = produced;
+                continue;
+            }
 
-                if (ret > 0) {
-                    m_soundTouch.putSamples((const float*)out_data[0], ret);
-                }
+            // 过渡中：当前曲目的尾巴与下一首的开头按曲线混合。缓冲里正好是剩下的尾巴，
+            // n 总大于 0
+            TrackBuffer& in_buf = m_buffers[next()];
+            if (start_time < 0) start_time = out_buf.headTime();
+            int n = std::min(chunkSize - produced, m_fade_total - m_fade_pos);
 
-                av_frame_unref(frame.get());
-            } else if (receive_ret == AVERROR_EOF) {
-                int64_t delay = swr_get_delay(swr_ctx.get(), codec_ctx->sample_rate);
-                if (delay > 0) {
-                    int dst_nb_samples = av_rescale_rnd(delay, codec_ctx->sample_rate,
-                                                        codec_ctx->sample_rate, AV_ROUND_UP);
-                    uint8_t** out_data = resample_buffer.grow(output_channels, dst_nb_samples);
+            status = fill(next(), n, chunkSize);
+            if (status.status < 0) break;
 
-                    if (out_data) {
-                        int ret = swr_convert(swr_ctx.get(), out_data, dst_nb_samples, nullptr, 0);
-                        if (ret > 0) {
-                            m_soundTouch.putSamples((const float*)out_data[0], ret);
-                        }
-                    }
-                }
+            // 下一首比淡化长度还短时，它结束后当前曲目继续按淡出曲线输出到尾巴用完
+            mixFade(out_buf, in_buf, n, std::min(n, in_buf.available()));
+            m_fade_pos += n;
+            produced += n;
 
-                m_soundTouch.flush();
-                decode_done = true;
-            } else {
-                if (receive_ret != AVERROR(EAGAIN)) {
-                    consecutive_errors++;
-
-                    double current_time =
-                        (m_next_pts != AV_NOPTS_VALUE) ? m_next_pts * av_q2d(m_time_base) : -1.0;
-                    double total_duration = (format_ctx->duration != AV_NOPTS_VALUE)
-                                                ? (double)format_ctx->duration / AV_TIME_BASE
-                                                : -1.0;
-
-                    fprintf(
-                        stderr,
-                        "[Decoder] Ignored decode error: %d (%s). Time: %.3f / %.3f. Count: %d\n",
-                        receive_ret, get_error_str(receive_ret).c_str(), current_time,
-                        total_duration, consecutive_errors);
-
-                    if (consecutive_errors > 50 || receive_ret == AVERROR(ENOMEM) ||
-                        receive_ret == AVERROR(EINVAL)) {
-                        result.status = {receive_ret,
-                                         "Fatal decode error: " + get_error_str(receive_ret)};
-                        break;
-                    }
-                }
+            if (m_fade_pos >= m_fade_total) switchToNext();
+        }
 
-                int read_ret = av_read_frame(format_ctx.get(), packet.get());
-                if (read_ret < 0) {
-                    if (read_ret == AVERROR_EOF) {
-                        avcodec_send_packet(codec_ctx.get(), nullptr);
-                    } else {
-                        result.status = {read_ret, "Read frame error: " + get_error_str(read_ret)};
-                        break;
-                    }
-                } else {
-                    if (packet->stream_index == audio_stream_index) {
-                        int send_ret = avcodec_send_packet(codec_ctx.get(), packet.get());
-
-                        if (send_ret < 0 && send_ret != AVERROR(EAGAIN) &&
-                            send_ret != AVERROR_EOF) {
-                            double pkt_time = (packet->pts != AV_NOPTS_VALUE)
-                                                  ? packet->pts * av_q2d(m_time_base)
-                                                  : -1.0;
-
-                            fprintf(stderr,
-                                    "[Decoder] Packet send failed: %d (%s). Packet Time: "
-                                    "%.3f\n",
-                                    send_ret, get_error_str(send_ret).c_str(), pkt_time);
-                        }
-                    }
-                    av_packet_unref(packet.get());
-                }
+        m_out.resize((size_t)produced * channels);
+        for (int ch = 0; ch < channels; ch++) {
+            if (produced > 0) {
+                memcpy(m_out.data() + (size_t)ch * produced, m_staging[ch].data(),
+                       produced * sizeof(float));
             }
         }
 
-        if (current_output_samples > 0 && codec_ctx->sample_rate > 0) {
-            double wall_duration = (double)current_output_samples / codec_ctx->sample_rate;
-            double source_duration = wall_duration * m_current_tempo;
-            m_current_output_time += source_duration;
-        }
+        m_error = status.error;
+        m_header.chunk = {status.status,
+                          produced,
+                          channels,
+                          is_eof ? 1 : 0,
+                          start_time,
+                          m_decoders[m_current].getPacketQueueStatus().duration,
+                          m_error.c_str(),
+                          produced > 0 ? m_out.data() : nullptr};
+        m_header.mixed = 1;
+        return true;
+    }
 
-        // Interleaved Int16 格式
-        if (format == SampleFormat::InterleavedS16) {
-            int total_samples = current_output_samples * output_channels;
-            m_s16_output.resize(total_samples);
+   public:
+    CrossfadeMixer() = default;
 
-            int16_t* dst_ptr = m_s16_output.data();
+    CrossfadeMixer(const CrossfadeMixer&) = delete;
+    CrossfadeMixer& operator=(const CrossfadeMixer&) = delete;
 
-            for (int i = 0; i < current_output_samples; i++) {
-                for (int ch = 0; ch < output_channels; ch++) {
-                    float sample = m_staging_buffers[ch][i];
+    void setCrossfade(double seconds, CrossfadeCurve curve) {
+        m_fade_seconds = std::max(0.0, seconds);
+        m_curve = curve;
+    }
 
-                    if (sample < -1.0f)
-                        sample = -1.0f;
-                    else if (sample > 1.0f)
-                        sample = 1.0f;
+    // 打开当前曲目，丢弃已排队的下一首
+    AudioProperties open(std::string path) {
+        close();
+        AudioProperties props = m_decoders[m_current].init(path);
+        applySpeed(m_decoders[m_current]);
+        return props;
+    }
 
-                    *dst_ptr++ = static_cast<int16_t>(sample * 32767.0f);
-                }
-            }
+    AudioProperties openStream(emscripten::val readFn, emscripten::val seekFn) {
+        close();
+        AudioProperties props = m_decoders[m_current].initStream(readFn, seekFn);
+        applySpeed(m_decoders[m_current]);
+        return props;
+    }
 
-            result.samples = emscripten::val(
-                emscripten::memory_view<int16_t>(m_s16_output.size(), m_s16_output.data()));
-        } else {  // LLL... RRR... Planer 格式
-            int total_samples_all_channels = current_output_samples * output_channels;
-            m_pcm_output.resize(total_samples_all_channels);
+    // 在空闲的解码器中打开下一首，过渡开始之前都可以替换
+    AudioProperties queueNext(std::string path) {
+        if (m_fading) return {{-1, "Crossfade already in progress"}};
+        m_buffers[next()].clear();
+        AudioProperties props = m_decoders[next()].init(path);
+        m_has_next = props.status.status >= 0;
+        applySpeed(m_decoders[next()]);
+        return props;
+    }
 
-            float* dst_ptr = m_pcm_output.data();
-            for (int ch = 0; ch < output_channels; ch++) {
-                if (m_staging_buffers[ch].size() > 0) {
-                    memcpy(dst_ptr, m_staging_buffers[ch].data(),
-                           current_output_samples * sizeof(float));
-                }
-                dst_ptr += current_output_samples;
-            }
+    AudioProperties queueNextStream(emscripten::val readFn, emscripten::val seekFn) {
+        if (m_fading) return {{-1, "Crossfade already in progress"}};
+        m_buffers[next()].clear();
+        AudioProperties props = m_decoders[next()].initStream(readFn, seekFn);
+        m_has_next = props.status.status >= 0;
+        applySpeed(m_decoders[next()]);
+        return props;
+    }
 
-            result.samples = emscripten::val(
-                emscripten::memory_view<float>(m_pcm_output.size(), m_pcm_output.data()));
+    bool hasNext() const { return m_has_next; }
+
+    // 正在输出的曲目和排队的下一首，由混音器持有，JS 侧不要 delete；切换曲目后两者互换
+    AudioStreamDecoder* current() { return &m_decoders[m_current]; }
+    AudioStreamDecoder* queued() { return &m_decoders[next()]; }
+
+    /**
+     * 解码一个 chunk，结果写入 m_header。没有排队的下一首、缓冲也已输出完时直接调用
+     * 当前解码器的 readChunkRaw，样本指向解码器的输出缓冲；否则指向混音器的缓冲
+     */
+    const MixChunkHeader* readChunkRaw(int chunkSize, SampleFormat format) {
+        while (true) {
+            m_header.trackIndex = m_track_index;
+            m_header.transitionFrame = -1;
+            if (!m_decoders[m_current].isOpen()) return fail("Mixer has no open track");
+
+            bool buffered = m_fading || m_buffers[m_current].available() > 0;
+            if (format != SampleFormat::PlanarF32 || (!m_has_next && !buffered)) {
+                return passThrough(chunkSize, format);
+            }
+            if (mix(chunkSize)) return &m_header;
         }
+    }
 
+    const MixChunkHeader* chunkHeader() const { return &m_header; }
+
+    MixChunkResult readChunk(int chunkSize) {
+        const ChunkHeader& chunk = readChunkRaw(chunkSize, SampleFormat::PlanarF32)->chunk;
+        MixChunkResult result;
+        result.status = {chunk.status, chunk.status < 0 && chunk.error ? chunk.error : ""};
+        result.samples = emscripten::val(emscripten::memory_view<float>(
+            (size_t)chunk.frames * chunk.channels, static_cast<const float*>(chunk.data)));
+        result.isEOF = chunk.isEOF != 0;
+        result.startTime = chunk.startTime;
+        result.trackIndex = m_header.trackIndex;
+        result.transitionFrame = m_header.transitionFrame;
+        result.sampleRate = m_chunk_rate;
+        result.channels = chunk.channels;
         return result;
     }
 
+    // 放弃正在进行的过渡（下一首回到开头继续排队），丢弃当前曲目已缓冲的样本
+    void flush() {
+        if (m_fading) {
+            m_fading = false;
+            m_buffers[next()].clear();
+            m_decoders[next()].seek(0.0);
+        }
+        m_buffers[m_current].clear();
+    }
+
+    /**
+     * flush 并把当前解码器定位回第一个未输出的样本。倒放、切换音频流等从解码器当前位置
+     * 开始生效的操作之前调用，否则会跳过已缓冲的淡化长度
+     */
+    Status rewind() {
+        double head = m_buffers[m_current].headTime();
+        flush();
+        if (head < 0) return {0, ""};
+        return m_decoders[m_current].seek(head);
+    }
+
+    // 在当前曲目内 seek；正在过渡时放弃过渡
     Status seek(double timestamp) {
-        if (!initialized) return {-1, "Not initialized"};
+        flush();
+        return m_decoders[m_current].seek(timestamp);
+    }
 
-        Status status = {0, ""};
+    void setTempo(double tempo) {
+        m_tempo = tempo;
+        m_decoders[0].setTempo(tempo);
+        m_decoders[1].setTempo(tempo);
+    }
 
-        if (format_ctx->duration > 0) {
-            double file_duration = (double)format_ctx->duration / AV_TIME_BASE;
-            if (timestamp >= file_duration - 0.2) {
-                timestamp = std::max(0.0, file_duration - 0.2);
-            }
+    void setPitch(double pitch) {
+        m_pitch = pitch;
+        m_decoders[0].setPitch(pitch);
+        m_decoders[1].setPitch(pitch);
+    }
+
+    void close() {
+        for (int i = 0; i < 2; i++) {
+            m_decoders[i].close();
+            m_buffers[i].clear();
         }
+        m_current = 0;
+        m_has_next = false;
+        m_fading = false;
+        m_track_index = 0;
+    }
 
-        AVStream* stream = format_ctx->streams[audio_stream_index];
+    // 供 C ABI 使用的对象地址，在对象生命周期内不变
+    uintptr_t nativeHandle() { return reinterpret_cast<uintptr_t>(this); }
+};
 
-        int64_t target_ts =
-            av_rescale_q(timestamp * AV_TIME_BASE, AV_TIME_BASE_Q, stream->time_base);
+enum class SessionPriority { Realtime = 0, Prefetch = 1, Background = 2 };
 
-        if ((status.status = avformat_seek_file(format_ctx.get(), audio_stream_index, INT64_MIN,
-                                                target_ts, target_ts, 0)) < 0) {
-            status.error = "avformat_seek_file error: " + get_error_str(status.status);
-            return status;
-        }
+/**
+ * 在同一个模块实例（同一份堆）里驱动多个解码会话：正在播放的会话先于预加载，
+ * 预加载先于后台分析；同一优先级内轮转，每步有解码时间预算。
+ * 每个会话是一个 CrossfadeMixer，单曲播放时直通当前解码器，排队下一首后在会话内交叉淡化。
+ * 每步中每个会话最多解码一个 chunk，调用方按 step 返回的会话 id 读取各自混音器的
+ * MixChunkHeader，直到该会话下一次被调度前有效。
+ */
+class DecoderScheduler {
+   private:
+    struct Session {
+        std::unique_ptr<CrossfadeMixer> mixer;
+        SessionPriority priority;
+        int chunk_size;
+        SampleFormat format;
+        // 由调用方暂停或恢复；EOF、出错和直播流缺数据时自动停止调度
+        bool active = false;
+    };
+
+    static constexpr int kPriorityCount = 3;
+
+    // 按 id 有序，同一优先级内的轮转顺序即 id 顺序
+    std::map<int, Session> m_sessions;
+    int m_next_id = 1;
+    // 各优先级上一个被调度的会话，下一轮从它之后开始
+    int m_cursor[kPriorityCount] = {0, 0, 0};
+    // step 的结果：[产生了 chunk 的数量, 缺数据的数量, 前者的 id..., 后者的 id...]
+    std::vector<int32_t> m_ready = {0, 0};
+    std::vector<int32_t> m_starved;
+
+    Session* find(int id) {
+        auto it = m_sessions.find(id);
+        return it == m_sessions.end() ? nullptr : &it->second;
+    }
 
-        avcodec_flush_buffers(codec_ctx.get());
+    const int32_t* finishStep() {
+        m_ready[1] = (int32_t)m_starved.size();
+        m_ready.insert(m_ready.end(), m_starved.begin(), m_starved.end());
+        return m_ready.data();
+    }
 
-        m_soundTouch.clear();
+   public:
+    // 创建会话并返回其 id，混音器由调度器持有，通过 mixer(id) 访问
+    int create(SessionPriority priority, int chunkSize, SampleFormat format) {
+        int id = m_next_id++;
+        Session& session = m_sessions[id];
+        session.mixer = std::make_unique<CrossfadeMixer>();
+        session.priority = priority;
+        session.chunk_size = chunkSize;
+        session.format = format;
+        return id;
+    }
 
-        // Seek 后重置预测时钟为 NOPTS，强制让下一帧的真实 PTS 来校准
-        m_next_pts = AV_NOPTS_VALUE;
+    void remove(int id) { m_sessions.erase(id); }
 
-        m_current_output_time = timestamp;
+    // 会话的混音器，生命周期由调度器管理，JS 侧不要 delete
+    CrossfadeMixer* mixer(int id) {
+        Session* session = find(id);
+        return session ? session->mixer.get() : nullptr;
+    }
 
-        return status;
+    // 预加载的下一首开始播放时提升为 Realtime
+    void setPriority(int id, SessionPriority priority) {
+        if (Session* session = find(id)) session->priority = priority;
     }
 
-    void close() {
-        packet.reset();
-        frame.reset();
-        swr_ctx.reset();
-        codec_ctx.reset();
-        format_ctx.reset();
-        resample_buffer.reset();
+    void setActive(int id, bool active) {
+        if (Session* session = find(id)) session->active = active;
+    }
 
-        if (avio_ctx) {
-            av_freep(&avio_ctx->buffer);
-            avio_context_free(&avio_ctx);
-            avio_ctx = nullptr;
-            avio_buffer = nullptr;
+    bool hasActiveSessions() const {
+        for (const auto& [id, session] : m_sessions) {
+            if (session.active) return true;
         }
-        stream_ctx.reset();
+        return false;
+    }
 
-        initialized = false;
-        m_next_pts = AV_NOPTS_VALUE;
-        m_current_output_time = 0.0;
+    /**
+     * 按优先级依次给每个活动会话解码一个 chunk，用完 budgetMs 后停止（每步至少产出一个）。
+     * 预算耗尽时没轮到的会话在下一步优先。只有产出了样本、到达 EOF 或出错的会话算作就绪；
+     * 直播流没有数据可解码时停止调度并单独列出，由调用方稍后重新激活。返回 m_ready 的地址。
+     */
+    const int32_t* step(double budgetMs) {
+        auto started = std::chrono::steady_clock::now();
+        m_ready.assign(2, 0);
+        m_starved.clear();
+
+        std::vector<int> order;
+        for (int p = 0; p < kPriorityCount; p++) {
+            // 从游标之后开始轮转：先取 id 更大的，再回绕到开头
+            order.clear();
+            for (const auto& [id, session] : m_sessions) {
+                if (session.active && (int)session.priority == p && id > m_cursor[p]) {
+                    order.push_back(id);
+                }
+            }
+            for (const auto& [id, session] : m_sessions) {
+                if (session.active && (int)session.priority == p && id <= m_cursor[p]) {
+                    order.push_back(id);
+                }
+            }
 
-        for (auto& buf : m_staging_buffers) {
-            std::vector<float>().swap(buf);
+            for (int id : order) {
+                double elapsed = std::chrono::duration<double, std::milli>(
+                                     std::chrono::steady_clock::now() - started)
+                                     .count();
+                if (m_ready[0] > 0 && elapsed >= budgetMs) return finishStep();
+
+                Session& session = m_sessions[id];
+                const ChunkHeader* header =
+                    &session.mixer->readChunkRaw(session.chunk_size, session.format)->chunk;
+                m_cursor[p] = id;
+
+                bool failed = header->status < 0 && header->status != AVERROR_EOF;
+                if (header->isEOF || failed) session.active = false;
+                if (header->frames == 0 && !header->isEOF && !failed) {
+                    // 空 chunk 不通知调用方；直播流在等网络数据，继续调度只会空转
+                    if (session.mixer->current()->isLive()) {
+                        session.active = false;
+                        m_starved.push_back(id);
+                    }
+                    continue;
+                }
+
+                m_ready.push_back(id);
+                m_ready[0]++;
+            }
         }
-        m_staging_buffers.clear();
-        std::vector<float>().swap(m_pcm_output);
-        std::vector<int16_t>().swap(m_s16_output);
+        return finishStep();
     }
+
+    uintptr_t nativeHandle() { return reinterpret_cast<uintptr_t>(this); }
 };
 
+// 当前模块是否为 -msimd128 构建，供加载器和基准测试确认实际加载的版本
+bool isSimdBuild() {
+#ifdef __wasm_simd128__
+    return true;
+#else
+    return false;
+#endif
+}
+
+// 逐 chunk 的热路径：handle 取自 AudioStreamDecoder.nativeHandle()
+extern "C" {
+
+EMSCRIPTEN_KEEPALIVE const void* decoder_read_chunk(uintptr_t handle, int chunk_size, int format) {
+    auto* decoder = reinterpret_cast<AudioStreamDecoder*>(handle);
+    return decoder->readChunkRaw(chunk_size, static_cast<SampleFormat>(format));
+}
+
+EMSCRIPTEN_KEEPALIVE const ChunkHeader* decoder_chunk_header(uintptr_t handle) {
+    return reinterpret_cast<AudioStreamDecoder*>(handle)->chunkHeader();
+}
+
+// handle 取自 CrossfadeMixer.nativeHandle()，返回样本指针，结果头见 mixer_chunk_header
+EMSCRIPTEN_KEEPALIVE const void* mixer_read_chunk(uintptr_t handle, int chunk_size, int format) {
+    auto* mixer = reinterpret_cast<CrossfadeMixer*>(handle);
+    return mixer->readChunkRaw(chunk_size, static_cast<SampleFormat>(format))->chunk.data;
+}
+
+EMSCRIPTEN_KEEPALIVE const MixChunkHeader* mixer_chunk_header(uintptr_t handle) {
+    return reinterpret_cast<CrossfadeMixer*>(handle)->chunkHeader();
+}
+
+// handle 取自 DecoderScheduler.nativeHandle()，返回 [就绪数, 缺数据数, 就绪 id..., 缺数据 id...]
+EMSCRIPTEN_KEEPALIVE const int32_t* scheduler_step(uintptr_t handle, double budget_ms) {
+    return reinterpret_cast<DecoderScheduler*>(handle)->step(budget_ms);
+}
+
+}  // extern "C"
+
 EMSCRIPTEN_BINDINGS(my_module) {
     value_object<Status>("Status").field("status", &Status::status).field("error", &Status::error);
 
     register_map<std::string, std::string>("StringMap");
     register_vector<std::string>("StringList");
     register_vector<uint8_t>("Uint8List");
+    register_vector<double>("DoubleList");
+
+    function("isSimdBuild", &isSimdBuild);
+
+    value_object<AudioStreamInfo>("AudioStreamInfo")
+        .field("index", &AudioStreamInfo::index)
+        .field("codec", &AudioStreamInfo::codec)
+        .field("channels", &AudioStreamInfo::channels)
+        .field("sampleRate", &AudioStreamInfo::sample_rate)
+        .field("language", &AudioStreamInfo::language)
+        .field("title", &AudioStreamInfo::title)
+        .field("isDefault", &AudioStreamInfo::is_default);
+    register_vector<AudioStreamInfo>("AudioStreamList");
+
+    value_object<ChapterInfo>("ChapterInfo")
+        .field("start", &ChapterInfo::start)
+        .field("end", &ChapterInfo::end)
+        .field("title", &ChapterInfo::title);
+    register_vector<ChapterInfo>("ChapterList");
+
+    value_object<CueTrack>("CueTrack")
+        .field("number", &CueTrack::number)
+        .field("start", &CueTrack::start)
+        .field("end", &CueTrack::end)
+        .field("title", &CueTrack::title)
+        .field("performer", &CueTrack::performer);
+    register_vector<CueTrack>("CueTrackList");
+
+    value_object<StreamMetadataEvent>("StreamMetadataEvent")
+        .field("time", &StreamMetadataEvent::time)
+        .field("title", &StreamMetadataEvent::title)
+        .field("raw", &StreamMetadataEvent::raw);
+    register_vector<StreamMetadataEvent>("StreamMetadataList");
 
     value_object<AudioProperties>("AudioProperties")
         .field("status", &AudioProperties::status)
@@ -664,11 +5264,17 @@ EMSCRIPTEN_BINDINGS(my_module) {
         .field("duration", &AudioProperties::duration)
         .field("metadata", &AudioProperties::metadata)
         .field("coverArt", &AudioProperties::cover_art)
-        .field("bitsPerSample", &AudioProperties::bits_per_sample);
+        .field("bitsPerSample", &AudioProperties::bits_per_sample)
+        .field("streams", &AudioProperties::streams)
+        .field("streamIndex", &AudioProperties::stream_index)
+        .field("chapters", &AudioProperties::chapters);
 
     enum_<SampleFormat>("SampleFormat")
         .value("PlanarF32", SampleFormat::PlanarF32)
-        .value("InterleavedS16", SampleFormat::InterleavedS16);
+        .value("InterleavedS16", SampleFormat::InterleavedS16)
+        .value("InterleavedS32", SampleFormat::InterleavedS32)
+        .value("InterleavedS24", SampleFormat::InterleavedS24)
+        .value("InterleavedF32", SampleFormat::InterleavedF32);
 
     value_object<ChunkResult>("ChunkResult")
         .field("status", &ChunkResult::status)
@@ -676,13 +5282,149 @@ EMSCRIPTEN_BINDINGS(my_module) {
         .field("isEOF", &ChunkResult::isEOF)
         .field("startTime", &ChunkResult::startTime);
 
+    value_object<PacketQueueStatus>("PacketQueueStatus")
+        .field("packets", &PacketQueueStatus::packets)
+        .field("bytes", &PacketQueueStatus::bytes)
+        .field("duration", &PacketQueueStatus::duration)
+        .field("isFull", &PacketQueueStatus::isFull)
+        .field("demuxEOF", &PacketQueueStatus::demuxEOF);
+
+    value_object<IOCacheStats>("IOCacheStats")
+        .field("hits", &IOCacheStats::hits)
+        .field("misses", &IOCacheStats::misses)
+        .field("hitBytes", &IOCacheStats::hitBytes)
+        .field("missBytes", &IOCacheStats::missBytes)
+        .field("netSeeks", &IOCacheStats::netSeeks)
+        .field("cachedBytes", &IOCacheStats::cachedBytes);
+
+    enum_<NormalizationMode>("NormalizationMode")
+        .value("Off", NormalizationMode::Off)
+        .value("Track", NormalizationMode::Track)
+        .value("Album", NormalizationMode::Album);
+
+    enum_<EqFilterType>("EqFilterType")
+        .value("Peaking", EqFilterType::Peaking)
+        .value("LowShelf", EqFilterType::LowShelf)
+        .value("HighShelf", EqFilterType::HighShelf)
+        .value("LowPass", EqFilterType::LowPass)
+        .value("HighPass", EqFilterType::HighPass);
+
+    value_object<SpectrumFrames>("SpectrumFrames")
+        .field("data", &SpectrumFrames::data)
+        .field("offsets", &SpectrumFrames::offsets)
+        .field("frames", &SpectrumFrames::frames)
+        .field("bands", &SpectrumFrames::bands);
+
+    value_object<DspStats>("DspStats")
+        .field("lastChunkMs", &DspStats::lastChunkMs)
+        .field("averageChunkMs", &DspStats::averageChunkMs)
+        .field("chunks", &DspStats::chunks)
+        .field("latencyFrames", &DspStats::latencyFrames);
+
+    enum_<CrossfadeCurve>("CrossfadeCurve")
+        .value("Linear", CrossfadeCurve::Linear)
+        .value("EqualPower", CrossfadeCurve::EqualPower)
+        .value("SCurve", CrossfadeCurve::SCurve);
+
+    value_object<MixChunkResult>("MixChunkResult")
+        .field("status", &MixChunkResult::status)
+        .field("samples", &MixChunkResult::samples)
+        .field("isEOF", &MixChunkResult::isEOF)
+        .field("startTime", &MixChunkResult::startTime)
+        .field("trackIndex", &MixChunkResult::trackIndex)
+        .field("transitionFrame", &MixChunkResult::transitionFrame)
+        .field("sampleRate", &MixChunkResult::sampleRate)
+        .field("channels", &MixChunkResult::channels);
+
+    value_object<PcmCacheStats>("PcmCacheStats")
+        .field("seekHits", &PcmCacheStats::seekHits)
+        .field("seekMisses", &PcmCacheStats::seekMisses)
+        .field("resyncs", &PcmCacheStats::resyncs)
+        .field("cachedBytes", &PcmCacheStats::cachedBytes);
+
     class_<AudioStreamDecoder>("AudioStreamDecoder")
         .constructor<>()
         .function("init", &AudioStreamDecoder::init)
         .function("initStream", &AudioStreamDecoder::initStream)
+        .function("initLive", &AudioStreamDecoder::initLive)
+        .function("setLiveLatency", &AudioStreamDecoder::setLiveLatency)
+        .function("takeStreamMetadata", &AudioStreamDecoder::takeStreamMetadata)
         .function("readChunk", &AudioStreamDecoder::readChunk)
+        .function("segmentBoundaries", &AudioStreamDecoder::segmentBoundaries)
+        .function("beginSegment", &AudioStreamDecoder::beginSegment)
+        .function("readSegment", &AudioStreamDecoder::readSegment)
+        .function("nativeSampleFormat", &AudioStreamDecoder::nativeSampleFormat)
+        .function("channelMask", &AudioStreamDecoder::channelMask)
         .function("seek", &AudioStreamDecoder::seek)
+        .function("selectStream", &AudioStreamDecoder::selectStream)
         .function("close", &AudioStreamDecoder::close)
         .function("setTempo", &AudioStreamDecoder::setTempo)
-        .function("setPitch", &AudioStreamDecoder::setPitch);
-}
+        .function("setPitch", &AudioStreamDecoder::setPitch)
+        .function("setVarispeed", &AudioStreamDecoder::setVarispeed)
+        .function("isVarispeed", &AudioStreamDecoder::isVarispeed)
+        .function("getStretchLatency", &AudioStreamDecoder::getStretchLatency)
+        .function("setIOCache", &AudioStreamDecoder::setIOCache)
+        .function("getIOCacheStats", &AudioStreamDecoder::getIOCacheStats)
+        .function("setPcmCache", &AudioStreamDecoder::setPcmCache)
+        .function("scrubPreview", &AudioStreamDecoder::scrubPreview)
+        .function("cachedPreview", &AudioStreamDecoder::cachedPreview)
+        .function("sampleRate", &AudioStreamDecoder::sampleRate)
+        .function("seekChapter", &AudioStreamDecoder::seekChapter)
+        .function("loadCueSheet", &AudioStreamDecoder::loadCueSheet)
+        .function("playCueTrack", &AudioStreamDecoder::playCueTrack)
+        .function("setReverse", &AudioStreamDecoder::setReverse)
+        .function("nativeHandle", &AudioStreamDecoder::nativeHandle)
+        .function("setLoop", &AudioStreamDecoder::setLoop)
+        .function("clearLoop", &AudioStreamDecoder::clearLoop)
+        .function("getPcmCacheStats", &AudioStreamDecoder::getPcmCacheStats)
+        .function("setSkipSilence", &AudioStreamDecoder::setSkipSilence)
+        .function("getSkippedDuration", &AudioStreamDecoder::getSkippedDuration)
+        .function("setNormalization", &AudioStreamDecoder::setNormalization)
+        .function("setEqBand", &AudioStreamDecoder::setEqBand)
+        .function("disableEqBand", &AudioStreamDecoder::disableEqBand)
+        .function("clearEq", &AudioStreamDecoder::clearEq)
+        .function("setLimiter", &AudioStreamDecoder::setLimiter)
+        .function("getDspStats", &AudioStreamDecoder::getDspStats)
+        .function("setSpectrum", &AudioStreamDecoder::setSpectrum)
+        .function("getSpectrum", &AudioStreamDecoder::getSpectrum)
+        .function("setPacketQueueLimits", &AudioStreamDecoder::setPacketQueueLimits)
+        .function("fillPacketQueue", &AudioStreamDecoder::fillPacketQueue)
+        .function("getPacketQueueStatus", &AudioStreamDecoder::getPacketQueueStatus);
+
+    enum_<SessionPriority>("SessionPriority")
+        .value("Realtime", SessionPriority::Realtime)
+        .value("Prefetch", SessionPriority::Prefetch)
+        .value("Background", SessionPriority::Background);
+
+    class_<DecoderScheduler>("DecoderScheduler")
+        .constructor<>()
+        .function("create", &DecoderScheduler::create)
+        .function("remove", &DecoderScheduler::remove)
+        .function("mixer", &DecoderScheduler::mixer, allow_raw_pointers(),
+                  return_value_policy::reference())
+        .function("setPriority", &DecoderScheduler::setPriority)
+        .function("setActive", &DecoderScheduler::setActive)
+        .function("hasActiveSessions", &DecoderScheduler::hasActiveSessions)
+        .function("nativeHandle", &DecoderScheduler::nativeHandle);
+
+    class_<CrossfadeMixer>("CrossfadeMixer")
+        .constructor<>()
+        .function("open", &CrossfadeMixer::open)
+        .function("openStream", &CrossfadeMixer::openStream)
+        .function("queueNext", &CrossfadeMixer::queueNext)
+        .function("queueNextStream", &CrossfadeMixer::queueNextStream)
+        .function("setCrossfade", &CrossfadeMixer::setCrossfade)
+        .function("readChunk", &CrossfadeMixer::readChunk)
+        .function("hasNext", &CrossfadeMixer::hasNext)
+        .function("current", &CrossfadeMixer::current, allow_raw_pointers(),
+                  return_value_policy::reference())
+        .function("queued", &CrossfadeMixer::queued, allow_raw_pointers(),
+                  return_value_policy::reference())
+        .function("flush", &CrossfadeMixer::flush)
+        .function("rewind", &CrossfadeMixer::rewind)
+        .function("seek", &CrossfadeMixer::seek)
+        .function("setTempo", &CrossfadeMixer::setTempo)
+        .function("setPitch", &CrossfadeMixer::setPitch)
+        .function("close", &CrossfadeMixer::close)
+        .function("nativeHandle", &CrossfadeMixer::nativeHandle);
+}
\ No newline at end of file
@@ -0,0 +1,169 @@
+/**
+ * @fileoverview 基准测试片段的生成，bench.ts 运行前也会按需调用
+ *
+ * 用法：
+ *   bun scripts/bench-clips.ts               生成全部缺失的片段并列出各片段状态
+ *   bun scripts/bench-clips.ts --force       删除已生成的片段后重新生成
+ *
+ * 片段用本机的 ffmpeg 命令行从固定的合成信号（random 使用固定种子）生成到
+ * bench/clips/generated，内容只取决于 ffmpeg 版本和编码器；基线应与片段在同一台机器上记录。
+ * 没有对应编码器的格式（APE、TAK、DSD 等）需要自备文件放在 bench/clips，缺失时跳过。
+ */
+
+import { existsSync, mkdirSync, rmSync, statSync } from "node:fs";
+import { join, resolve } from "node:path";
+import { $ } from "bun";
+
+export const CLIP_DIR = resolve("bench", "clips");
+const GENERATED_DIR = join(CLIP_DIR, "generated");
+
+export const CLIP_SECONDS = 30;
+
+// 带噪声的双声道信号，避免无损编码器把纯正弦压得过小
+const SOURCE_SIGNAL =
+	"aevalsrc=0.4*sin(2*PI*440*t)+0.1*(random(0)-0.5)|0.4*sin(2*PI*554*t)+0.1*(random(1)-0.5)";
+
+export interface ClipSpec {
+	name: string;
+	/** 由 ffmpeg 生成时使用的编码器 */
+	encoder?: string;
+	/** 生成参数，放在 -c:a 之后 */
+	args?: string[];
+	ext?: string;
+	sampleRate?: number;
+	channels?: number;
+	/** 自备片段，相对 bench/clips */
+	bundled?: string;
+}
+
+export const CLIPS: ClipSpec[] = [
+	{ name: "pcm_s16le", encoder: "pcm_s16le", ext: "wav" },
+	{ name: "pcm_s24le", encoder: "pcm_s24le", ext: "wav" },
+	{ name: "pcm_f32le", encoder: "pcm_f32le", ext: "wav" },
+	{ name: "pcm_s16be", encoder: "pcm_s16be", ext: "aiff" },
+	{ name: "pcm_mulaw", encoder: "pcm_mulaw", ext: "au", sampleRate: 8000 },
+	{ name: "flac", encoder: "flac", ext: "flac" },
+	{
+		name: "flac_24_96",
+		encoder: "flac",
+		args: ["-sample_fmt", "s32"],
+		ext: "flac",
+		sampleRate: 96000,
+	},
+	{ name: "alac", encoder: "alac", ext: "m4a" },
+	{ name: "wavpack", encoder: "wavpack", ext: "wv" },
+	{ name: "tta", encoder: "tta", ext: "tta" },
+	{ name: "mp3", encoder: "libmp3lame", args: ["-b:a", "192k"], ext: "mp3" },
+	{ name: "aac", encoder: "aac", args: ["-b:a", "192k"], ext: "m4a" },
+	{
+		name: "opus",
+		encoder: "libopus",
+		args: ["-b:a", "128k"],
+		ext: "opus",
+		sampleRate: 48000,
+	},
+	{ name: "vorbis", encoder: "libvorbis", args: ["-q:a", "5"], ext: "ogg" },
+	{
+		name: "ac3",
+		encoder: "ac3",
+		args: ["-b:a", "448k"],
+		ext: "ac3",
+		sampleRate: 48000,
+	},
+	{
+		name: "eac3",
+		encoder: "eac3",
+		args: ["-b:a", "640k"],
+		ext: "mka",
+		sampleRate: 48000,
+	},
+	{ name: "wmav2", encoder: "wmav2", args: ["-b:a", "192k"], ext: "wma" },
+	{
+		name: "dca",
+		encoder: "dca",
+		args: ["-strict", "-2"],
+		ext: "dts",
+		sampleRate: 48000,
+	},
+	{
+		name: "truehd",
+		encoder: "truehd",
+		args: ["-strict", "-2"],
+		ext: "thd",
+		sampleRate: 48000,
+	},
+	{
+		name: "amrnb",
+		encoder: "libopencore_amrnb",
+		ext: "amr",
+		sampleRate: 8000,
+		channels: 1,
+	},
+	{ name: "ape", bundled: "ape.ape" },
+	{ name: "tak", bundled: "tak.tak" },
+	{ name: "dsd", bundled: "dsd.dsf" },
+	{ name: "mpc8", bundled: "mpc8.mpc" },
+	{ name: "wmalossless", bundled: "wmalossless.wma" },
+	{ name: "wmapro", bundled: "wmapro.wma" },
+	{ name: "shorten", bundled: "shorten.shn" },
+	{ name: "cook", bundled: "cook.rm" },
+];
+
+export async function availableEncoders(): Promise<Set<string>> {
+	const out = await $`ffmpeg -hide_banner -encoders`.quiet().nothrow();
+	if (out.exitCode !== 0) {
+		console.warn("⚠️ 未找到 ffmpeg 命令行，只能使用已生成或自备的片段");
+		return new Set();
+	}
+	const encoders = new Set<string>();
+	for (const line of out.stdout.toString().split("\n")) {
+		const match = line.match(/^\s*A\S*\s+(\S+)/);
+		if (match?.[1]) encoders.add(match[1]);
+	}
+	return encoders;
+}
+
+export async function prepareClip(
+	spec: ClipSpec,
+	encoders: Set<string>,
+): Promise<string | null> {
+	if (spec.bundled) {
+		const path = join(CLIP_DIR, spec.bundled);
+		return existsSync(path) ? path : null;
+	}
+
+	const path = join(GENERATED_DIR, `${spec.name}.${spec.ext}`);
+	if (existsSync(path)) return path;
+	if (!spec.encoder || !encoders.has(spec.encoder)) return null;
+
+	mkdirSync(GENERATED_DIR, { recursive: true });
+	const rate = spec.sampleRate ?? 44100;
+	const source = `${SOURCE_SIGNAL}:s=${rate}:d=${CLIP_SECONDS}`;
+	const channels = String(spec.channels ?? 2);
+	const result =
+		await $`ffmpeg -hide_banner -loglevel error -y -f lavfi -i ${source} -ac ${channels} -c:a ${spec.encoder} ${spec.args ?? []} ${path}`.nothrow();
+	return result.exitCode === 0 ? path : null;
+}
+
+if (import.meta.main) {
+	if (process.argv.includes("--force")) {
+		rmSync(GENERATED_DIR, { recursive: true, force: true });
+	}
+	const encoders = await availableEncoders();
+	let missing = 0;
+	for (const spec of CLIPS) {
+		const path = await prepareClip(spec, encoders);
+		if (path) {
+			const kb = (statSync(path).size / 1024).toFixed(0);
+			const size = `${kb}KB`.padStart(10);
+			console.log(`${spec.name.padEnd(18)}${size}  ${path}`);
+			continue;
+		}
+		missing++;
+		const note = spec.bundled
+			? `missing bench/clips/${spec.bundled}`
+			: `no encoder ${spec.encoder}`;
+		console.log(`${spec.name.padEnd(18)}${"-".padStart(10)}  ${note}`);
+	}
+	console.log(`\n${CLIPS.length - missing}/${CLIPS.length} clips ready`);
+}
@@ -0,0 +1,731 @@
+/**
+ * @fileoverview 各编解码器在 AudioStreamDecoder 中的解码基准测试
+ *
+ * 用法：
+ *   bun scripts/bench.ts                     运行全部并与基线对比，超出阈值或没有基线时退出码为 1
+ *   bun scripts/bench.ts --update-baseline   运行并把结果写为新的基线（bench/baseline.json）
+ *   bun scripts/bench.ts --filter=flac,mp3   只运行名称包含关键字的条目
+ *   bun scripts/bench.ts --threshold=0.2     回归阈值（相对值，默认 0.15）
+ *   bun scripts/bench.ts --rebuild           重新构建 Node 版 WASM
+ *   bun scripts/bench.ts --variant=simd      只测某个构建（scalar / simd，默认两者都测）
+ *   bun scripts/bench.ts --no-abi            不比较 Embind 与 C ABI 的逐 chunk 开销
+ *   bun scripts/bench.ts --no-speed          不比较 tempo 与 varispeed 两种变速的开销
+ *   bun scripts/bench.ts --no-dsp            不比较开关均衡器/限制器时每个 chunk 的开销
+ *   bun scripts/bench.ts --no-segments       不检查分段解码与顺序解码是否逐样本一致
+ *
+ * 测试片段由 bench-clips.ts 生成（也可以用 bun run bench:clips 单独生成），缺失的片段跳过。
+ * 第一次运行需要 Docker 构建 Node 版 WASM，之后完全离线。
+ */
+
+import {
+	existsSync,
+	mkdirSync,
+	readFileSync,
+	statSync,
+	writeFileSync,
+} from "node:fs";
+import { join, resolve } from "node:path";
+import { $ } from "bun";
+import type {
+	AudioDecoderModule,
+	AudioStreamDecoder,
+	SampleFormat,
+} from "../src/types/wasm";
+import { RawChunkReader } from "../src/utils/RawChunkReader";
+import {
+	availableEncoders,
+	CLIP_SECONDS,
+	CLIPS,
+	prepareClip,
+} from "./bench-clips";
+
+const BENCH_DIR = resolve("bench");
+const BUILD_DIR = join(BENCH_DIR, ".build");
+const BASELINE_PATH = join(BENCH_DIR, "baseline.json");
+// 标量构建与 -msimd128 构建，SIMD 版本的结果以 "<名称>@simd" 记入基线
+const VARIANTS = {
+	scalar: join(BUILD_DIR, "ffmpeg-node.mjs"),
+	simd: join(BUILD_DIR, "ffmpeg-node-simd.mjs"),
+};
+type Variant = keyof typeof VARIANTS;
+
+const CHUNK_SIZE = 4096;
+const SEEK_POINTS = [0.25, 0.5, 0.75, 0.1, 0.9];
+// 每项重复次数，取最好成绩以压低噪声
+const REPEATS = 3;
+// 比较 readChunk（Embind）与 decoder_read_chunk（C ABI）时使用的 chunk 大小和片段
+const ABI_CHUNK_SIZES = [128, 256, 1024, 4096];
+const ABI_CLIP = "pcm_s16le";
+// 比较 SoundTouch 变速与 varispeed 重采样时的速度，片段与 ABI 比较相同
+const SPEED_FACTORS = [0.8, 1.25, 1.5];
+// 比较 DSP 开关时的均衡器配置：频段数与是否开启限制器，片段与 ABI 比较相同
+const DSP_CONFIGS = [
+	{ name: "eq x4", bands: 4, limiter: false },
+	{ name: "eq x8", bands: 8, limiter: false },
+	{ name: "limiter", bands: 0, limiter: true },
+	{ name: "eq x8 + limiter", bands: 8, limiter: true },
+];
+// 分段导出与顺序解码对比时的分段数
+const SEGMENT_COUNT = 4;
+
+interface BenchResult {
+	/** 解码速度（音频时长 / 墙钟时间） */
+	xRealtime: number;
+	/** 在新的模块实例中打开文件到拿到第一个 chunk 的时间 */
+	firstChunkMs: number;
+	/** seek 并拿到第一个 chunk 的平均时间 */
+	seekMs: number;
+	/** 解码过程中 WASM 线性内存的增长量 */
+	peakMemoryMB: number;
+}
+
+type Baseline = Record<string, BenchResult>;
+
+// 各指标的方向：higher 表示越大越好
+const METRICS: { key: keyof BenchResult; higher: boolean }[] = [
+	{ key: "xRealtime", higher: true },
+	{ key: "firstChunkMs", higher: false },
+	{ key: "seekMs", higher: false },
+	{ key: "peakMemoryMB", higher: false },
+];
+
+// 毫秒级指标低于该值时只看绝对差，避免亚毫秒抖动被放大成百分比回归
+const MS_NOISE_FLOOR = 2;
+
+const argv = process.argv.slice(2);
+const flag = (name: string) => argv.includes(`--${name}`);
+const option = (name: string) =>
+	argv.find((a) => a.startsWith(`--${name}=`))?.slice(name.length + 3);
+
+const updateBaseline = flag("update-baseline");
+const threshold = Number(option("threshold") ?? 0.15);
+const filters = option("filter")?.split(",").filter(Boolean) ?? [];
+const variants = (Object.keys(VARIANTS) as Variant[]).filter(
+	(v) => !option("variant") || option("variant") === v,
+);
+
+async function ensureModule() {
+	const built = Object.values(VARIANTS).every((path) => existsSync(path));
+	if (built && !flag("rebuild")) return;
+
+	console.log("🐳 构建 Node 版 WASM (bench-exportor)...");
+	mkdirSync(BUILD_DIR, { recursive: true });
+	const env = { ...process.env, DOCKER_BUILDKIT: "1" };
+	try {
+		await $`docker build --platform linux/amd64 --target bench-exportor --output type=local,dest=${BUILD_DIR} .`.env(
+			env,
+		);
+	} catch {
+		console.error("❌ Docker 构建失败，请检查上方错误日志。");
+		process.exit(1);
+	}
+}
+
+async function loadModule(variant: Variant): Promise<AudioDecoderModule> {
+	const { default: create } = await import(VARIANTS[variant]);
+	const module = (await create()) as AudioDecoderModule;
+	if (module.isSimdBuild() !== (variant === "simd")) {
+		throw new Error(`${VARIANTS[variant]} is not a ${variant} build`);
+	}
+	return module;
+}
+
+function heapBytes(module: AudioDecoderModule) {
+	return module.HEAPU8.buffer.byteLength;
+}
+
+function decodeAll(module: AudioDecoderModule, decoder: AudioStreamDecoder) {
+	let samples = 0;
+	while (true) {
+		const chunk = decoder.readChunk(
+			CHUNK_SIZE,
+			module.SampleFormat.PlanarF32,
+		);
+		if (chunk.status.status < 0) {
+			throw new Error(`decode error: ${chunk.status.error}`);
+		}
+		samples += chunk.samples.length;
+		if (chunk.isEOF) return samples;
+	}
+}
+
+/**
+ * 在新的模块实例和解码器上跑一轮：首次打开（冷启动，与播放器加载新文件相同）、
+ * 全文件解码和若干次 seek。线性内存只增不减，实例内的增长量就是峰值
+ */
+async function benchClipOnce(
+	path: string,
+	variant: Variant,
+): Promise<BenchResult> {
+	const module = await loadModule(variant);
+	const baseHeap = heapBytes(module);
+	const decoder = new module.AudioStreamDecoder();
+
+	try {
+		const openStart = performance.now();
+		const props = decoder.init(path);
+		if (props.status.status < 0) {
+			throw new Error(`init failed: ${props.status.error}`);
+		}
+		decoder.readChunk(CHUNK_SIZE, module.SampleFormat.PlanarF32);
+		const firstChunkMs = performance.now() - openStart;
+
+		const duration = props.duration;
+		const channels = props.channelCount;
+		props.metadata.delete();
+		props.coverArt.delete();
+		props.streams.delete();
+		props.chapters.delete();
+
+		decoder.seek(0);
+		const decodeStart = performance.now();
+		const samples = decodeAll(module, decoder);
+		const decodeSeconds = (performance.now() - decodeStart) / 1000;
+		const audioSeconds = samples / channels / props.sampleRate;
+
+		let seekTotal = 0;
+		for (const point of SEEK_POINTS) {
+			const seekStart = performance.now();
+			decoder.seek(duration * point);
+			decoder.readChunk(CHUNK_SIZE, module.SampleFormat.PlanarF32);
+			seekTotal += performance.now() - seekStart;
+		}
+
+		return {
+			xRealtime: audioSeconds / Math.max(decodeSeconds, 1e-6),
+			firstChunkMs,
+			seekMs: seekTotal / SEEK_POINTS.length,
+			peakMemoryMB: (heapBytes(module) - baseHeap) / (1024 * 1024),
+		};
+	} finally {
+		decoder.close();
+		decoder.delete();
+	}
+}
+
+// 每轮都是冷启动，各指标取最好成绩以压低噪声
+async function benchClip(
+	path: string,
+	variant: Variant,
+): Promise<BenchResult> {
+	let best: BenchResult | null = null;
+	for (let run = 0; run < REPEATS; run++) {
+		const result = await benchClipOnce(path, variant);
+		best = best
+			? {
+					xRealtime: Math.max(best.xRealtime, result.xRealtime),
+					firstChunkMs: Math.min(best.firstChunkMs, result.firstChunkMs),
+					seekMs: Math.min(best.seekMs, result.seekMs),
+					peakMemoryMB: Math.max(best.peakMemoryMB, result.peakMemoryMB),
+				}
+			: result;
+	}
+	return best as BenchResult;
+}
+
+interface AbiResult {
+	chunkSize: number;
+	/** 每个 chunk 的平均耗时（微秒） */
+	embindUs: number;
+	rawUs: number;
+}
+
+/**
+ * 同一片段、同一 chunk 大小下分别用两条路径解码全文件，比较每个 chunk 的平均耗时。
+ * 选用解码最便宜的 PCM，差值基本就是绑定开销。
+ */
+async function benchAbi(path: string): Promise<AbiResult[]> {
+	const module = await loadModule(variants[0] ?? "scalar");
+	const decoder = new module.AudioStreamDecoder();
+	const format = module.SampleFormat.PlanarF32;
+	const results: AbiResult[] = [];
+
+	const perChunkUs = (read: () => boolean) => {
+		let best = Number.POSITIVE_INFINITY;
+		for (let run = 0; run < REPEATS; run++) {
+			decoder.seek(0);
+			let chunks = 1;
+			const start = performance.now();
+			while (!read()) chunks++;
+			best = Math.min(best, ((performance.now() - start) * 1000) / chunks);
+		}
+		return best;
+	};
+
+	try {
+		const props = decoder.init(path);
+		if (props.status.status < 0) {
+			throw new Error(`init failed: ${props.status.error}`);
+		}
+		props.metadata.delete();
+		props.coverArt.delete();
+		props.streams.delete();
+		props.chapters.delete();
+
+		const reader = new RawChunkReader(module, decoder);
+		for (const size of ABI_CHUNK_SIZES) {
+			const embindUs = perChunkUs(() => {
+				const chunk = decoder.readChunk(size, format);
+				if (chunk.status.status < 0) throw new Error(chunk.status.error);
+				return chunk.isEOF;
+			});
+			const rawUs = perChunkUs(() => {
+				const chunk = reader.read(size, format);
+				if (chunk.status < 0) throw new Error(chunk.error);
+				return chunk.isEOF;
+			});
+			results.push({ chunkSize: size, embindUs, rawUs });
+		}
+	} finally {
+		decoder.close();
+		decoder.delete();
+	}
+	return results;
+}
+
+interface SpeedResult {
+	speed: number;
+	/** 处理速度（源音频时长 / 墙钟时间） */
+	tempoX: number;
+	varispeedX: number;
+}
+
+/**
+ * 同一片段分别用 SoundTouch（setTempo，保持音调）和 varispeed（只重采样）变速解码全文件。
+ * PCM 的解码开销可以忽略，两者的差基本就是变速级本身的开销。
+ */
+async function benchSpeed(path: string): Promise<SpeedResult[]> {
+	const module = await loadModule(variants[0] ?? "scalar");
+	const decoder = new module.AudioStreamDecoder();
+	const format = module.SampleFormat.PlanarF32;
+	const results: SpeedResult[] = [];
+
+	try {
+		const props = decoder.init(path);
+		if (props.status.status < 0) {
+			throw new Error(`init failed: ${props.status.error}`);
+		}
+		props.metadata.delete();
+		props.coverArt.delete();
+		props.streams.delete();
+		props.chapters.delete();
+
+		const reader = new RawChunkReader(module, decoder);
+		const xRealtime = (varispeed: boolean, speed: number) => {
+			const status = decoder.setVarispeed(varispeed);
+			if (status.status < 0) throw new Error(status.error);
+			decoder.setTempo(speed);
+
+			let best = 0;
+			for (let run = 0; run < REPEATS; run++) {
+				decoder.seek(0);
+				const start = performance.now();
+				while (true) {
+					const chunk = reader.read(CHUNK_SIZE, format);
+					if (chunk.status < 0) throw new Error(chunk.error);
+					if (chunk.isEOF) break;
+				}
+				const seconds = (performance.now() - start) / 1000;
+				best = Math.max(best, CLIP_SECONDS / seconds);
+			}
+			return best;
+		};
+
+		for (const speed of SPEED_FACTORS) {
+			results.push({
+				speed,
+				tempoX: xRealtime(false, speed),
+				varispeedX: xRealtime(true, speed),
+			});
+		}
+	} finally {
+		decoder.close();
+		decoder.delete();
+	}
+	return results;
+}
+
+interface DspResult {
+	name: string;
+	variant: Variant;
+	/** 关闭 / 开启 DSP 时每个 chunk 的平均耗时（微秒） */
+	offUs: number;
+	onUs: number;
+	/** getDspStats 统计的 DSP 级本身每个 chunk 的耗时（微秒） */
+	dspUs: number;
+}
+
+/**
+ * 同一片段分别关闭和开启均衡器/限制器解码全文件，比较每个 chunk 的耗时，
+ * 并用 getDspStats 单独给出 DSP 级的开销。
+ */
+async function benchDsp(path: string, variant: Variant): Promise<DspResult[]> {
+	const module = await loadModule(variant);
+	const decoder = new module.AudioStreamDecoder();
+	const format = module.SampleFormat.PlanarF32;
+	const results: DspResult[] = [];
+
+	try {
+		const props = decoder.init(path);
+		if (props.status.status < 0) {
+			throw new Error(`init failed: ${props.status.error}`);
+		}
+		props.metadata.delete();
+		props.coverArt.delete();
+		props.streams.delete();
+		props.chapters.delete();
+
+		const reader = new RawChunkReader(module, decoder);
+		// 返回 [每个 chunk 的总耗时, 其中 DSP 级的耗时]，单位微秒，取最好的一次
+		const perChunkUs = () => {
+			let best = Number.POSITIVE_INFINITY;
+			let bestDsp = 0;
+			for (let run = 0; run < REPEATS; run++) {
+				decoder.seek(0);
+				const before = decoder.getDspStats();
+				let chunks = 0;
+				const start = performance.now();
+				while (true) {
+					const chunk = reader.read(CHUNK_SIZE, format);
+					if (chunk.status < 0) throw new Error(chunk.error);
+					chunks++;
+					if (chunk.isEOF) break;
+				}
+				const us = ((performance.now() - start) * 1000) / chunks;
+				const after = decoder.getDspStats();
+				if (us < best) {
+					best = us;
+					const dspMs =
+						after.averageChunkMs * after.chunks -
+						before.averageChunkMs * before.chunks;
+					bestDsp = (dspMs * 1000) / chunks;
+				}
+			}
+			return [best, bestDsp] as const;
+		};
+
+		for (const config of DSP_CONFIGS) {
+			decoder.clearEq();
+			decoder.setLimiter(false, -1, 5, 50);
+			const [offUs] = perChunkUs();
+
+			for (let i = 0; i < config.bands; i++) {
+				// 频点按倍频程分布，增益正负交替
+				const freq = 60 * 2 ** i;
+				const gain = i % 2 === 0 ? 4 : -3;
+				decoder.setEqBand(i, module.EqFilterType.Peaking, freq, gain, 1);
+			}
+			decoder.setLimiter(config.limiter, -1, 5, 50);
+			const [onUs, dspUs] = perChunkUs();
+
+			results.push({ name: config.name, variant, offUs, onUs, dspUs });
+		}
+		decoder.clearEq();
+		decoder.setLimiter(false, -1, 5, 50);
+	} finally {
+		decoder.close();
+		decoder.delete();
+	}
+	return results;
+}
+
+interface SegmentCheck {
+	/** 实际切成的段数，1 表示该格式不分段 */
+	segments: number;
+	bytes: number;
+	/** 第一个不一致的字节偏移，一致时为 -1 */
+	mismatchAt: number;
+}
+
+function openDecoder(module: AudioDecoderModule, path: string) {
+	const decoder = new module.AudioStreamDecoder();
+	const props = decoder.init(path);
+	props.metadata.delete();
+	props.coverArt.delete();
+	props.streams.delete();
+	props.chapters.delete();
+	if (props.status.status < 0) {
+		decoder.delete();
+		throw new Error(`init failed: ${props.status.error}`);
+	}
+	return decoder;
+}
+
+// 解码源样本区间 [start, end)，返回拼接后的字节（拷贝出 WASM 堆）
+function decodeSegment(
+	decoder: AudioStreamDecoder,
+	start: number,
+	end: number,
+	format: SampleFormat,
+) {
+	const status = decoder.beginSegment(start, end, format);
+	if (status.status < 0) throw new Error(status.error);
+	const parts: Uint8Array[] = [];
+	while (true) {
+		const chunk = decoder.readSegment(CHUNK_SIZE);
+		if (chunk.status.status < 0) throw new Error(chunk.status.error);
+		const s = chunk.samples;
+		parts.push(new Uint8Array(s.buffer, s.byteOffset, s.byteLength).slice());
+		if (chunk.isEOF) return Buffer.concat(parts);
+	}
+}
+
+/**
+ * 与 exportAsWav 相同：按 segmentBoundaries 切段，每段在独立的解码器上解码后拼接，
+ * 与同一文件从 0 顺序解码的结果逐字节比较
+ */
+async function checkSegments(path: string): Promise<SegmentCheck> {
+	const module = await loadModule(variants[0] ?? "scalar");
+	const planner = openDecoder(module, path);
+	const format = planner.nativeSampleFormat();
+	const list = planner.segmentBoundaries(SEGMENT_COUNT);
+	const bounds: number[] = [];
+	for (let i = 0; i < list.size(); i++) bounds.push(list.get(i));
+	list.delete();
+
+	try {
+		const sequential = decodeSegment(planner, 0, -1, format);
+		const parts: Buffer[] = [];
+		for (let i = 0; i + 1 < bounds.length; i++) {
+			const decoder = openDecoder(module, path);
+			try {
+				parts.push(
+					decodeSegment(decoder, bounds[i] ?? 0, bounds[i + 1] ?? -1, format),
+				);
+			} finally {
+				decoder.close();
+				decoder.delete();
+			}
+		}
+		const segmented = Buffer.concat(parts);
+
+		let mismatchAt = -1;
+		const length = Math.max(sequential.length, segmented.length);
+		for (let i = 0; i < length; i++) {
+			if (sequential[i] !== segmented[i]) {
+				mismatchAt = i;
+				break;
+			}
+		}
+		return {
+			segments: bounds.length - 1,
+			bytes: sequential.length,
+			mismatchAt,
+		};
+	} finally {
+		planner.close();
+		planner.delete();
+	}
+}
+
+function compare(name: string, current: BenchResult, base: BenchResult) {
+	const regressions: string[] = [];
+	for (const { key, higher } of METRICS) {
+		const now = current[key];
+		const before = base[key];
+		if (!(before > 0)) continue;
+
+		const change = higher ? (before - now) / before : (now - before) / before;
+		const isMs = key.endsWith("Ms");
+		if (isMs && Math.abs(now - before) < MS_NOISE_FLOOR) continue;
+
+		if (change > threshold) {
+			regressions.push(
+				`${name}.${key}: ${before.toFixed(2)} -> ${now.toFixed(2)} (${(change * 100).toFixed(1)}%)`,
+			);
+		}
+	}
+	return regressions;
+}
+
+function formatRow(name: string, r: BenchResult | null, note = "") {
+	const cell = (v: string, w: number) => v.padStart(w);
+	if (!r) return `${name.padEnd(18)}${cell(note, 48)}`;
+	return (
+		name.padEnd(18) +
+		cell(`${r.xRealtime.toFixed(1)}x`, 10) +
+		cell(`${r.firstChunkMs.toFixed(1)}ms`, 12) +
+		cell(`${r.seekMs.toFixed(1)}ms`, 12) +
+		cell(`${r.peakMemoryMB.toFixed(1)}MB`, 12)
+	);
+}
+
+await ensureModule();
+const encoders = await availableEncoders();
+const baseline: Baseline = existsSync(BASELINE_PATH)
+	? JSON.parse(readFileSync(BASELINE_PATH, "utf8"))
+	: {};
+
+const selected = CLIPS.filter(
+	(c) => filters.length === 0 || filters.some((f) => c.name.includes(f)),
+);
+
+console.log(
+	`${"codec".padEnd(18)}${"speed".padStart(10)}${"first".padStart(12)}${"seek".padStart(12)}${"memory".padStart(12)}`,
+);
+
+const results: Baseline = {};
+const regressions: string[] = [];
+let failures = 0;
+
+for (const spec of selected) {
+	const path = await prepareClip(spec, encoders);
+	if (!path) {
+		const note = spec.bundled ? "skipped (no clip)" : "skipped (no encoder)";
+		console.log(formatRow(spec.name, null, note));
+		continue;
+	}
+
+	for (const variant of variants) {
+		const name = variant === "scalar" ? spec.name : `${spec.name}@${variant}`;
+		try {
+			const result = await benchClip(path, variant);
+			results[name] = result;
+			console.log(formatRow(name, result));
+
+			const base = baseline[name];
+			if (base) regressions.push(...compare(name, result, base));
+		} catch (e) {
+			failures++;
+			const size = statSync(path).size;
+			const note = `failed: ${(e as Error).message} (${size} bytes)`;
+			console.log(formatRow(name, null, note));
+		}
+	}
+}
+
+// SIMD 相对标量的解码速度（各片段几何平均）
+const speedups: number[] = [];
+for (const spec of selected) {
+	const scalar = results[spec.name];
+	const simd = results[`${spec.name}@simd`];
+	if (scalar && simd) speedups.push(simd.xRealtime / scalar.xRealtime);
+}
+if (speedups.length > 0) {
+	const mean = Math.exp(
+		speedups.reduce((sum, x) => sum + Math.log(x), 0) / speedups.length,
+	);
+	console.log(`\nSIMD speedup: ${mean.toFixed(2)}x (${speedups.length} clips)`);
+}
+
+const abiSpec = CLIPS.find((c) => c.name === ABI_CLIP);
+const abiPath =
+	!flag("no-abi") && abiSpec ? await prepareClip(abiSpec, encoders) : null;
+if (abiPath) {
+	console.log(
+		`\n${"chunk".padEnd(18)}${"embind".padStart(12)}${"c-abi".padStart(12)}${"saved".padStart(10)}`,
+	);
+	for (const r of await benchAbi(abiPath)) {
+		const saved = (1 - r.rawUs / r.embindUs) * 100;
+		console.log(
+			String(r.chunkSize).padEnd(18) +
+				`${r.embindUs.toFixed(1)}us`.padStart(12) +
+				`${r.rawUs.toFixed(1)}us`.padStart(12) +
+				`${saved.toFixed(1)}%`.padStart(10),
+		);
+	}
+}
+
+const speedPath =
+	!flag("no-speed") && abiSpec ? await prepareClip(abiSpec, encoders) : null;
+if (speedPath) {
+	console.log(
+		`\n${"speed".padEnd(18)}${"tempo".padStart(12)}${"varispeed".padStart(12)}${"gain".padStart(10)}`,
+	);
+	for (const r of await benchSpeed(speedPath)) {
+		console.log(
+			`${r.speed}x`.padEnd(18) +
+				`${r.tempoX.toFixed(1)}x`.padStart(12) +
+				`${r.varispeedX.toFixed(1)}x`.padStart(12) +
+				`${(r.varispeedX / r.tempoX).toFixed(2)}x`.padStart(10),
+		);
+	}
+}
+
+const dspPath =
+	!flag("no-dsp") && abiSpec ? await prepareClip(abiSpec, encoders) : null;
+if (dspPath) {
+	console.log(
+		`\n${"dsp".padEnd(24)}${"off".padStart(12)}${"on".padStart(12)}${"dsp".padStart(12)}${"cost".padStart(10)}`,
+	);
+	for (const variant of variants) {
+		for (const r of await benchDsp(dspPath, variant)) {
+			const name = variant === "scalar" ? r.name : `${r.name}@${variant}`;
+			const cost = (r.onUs / r.offUs - 1) * 100;
+			console.log(
+				name.padEnd(24) +
+					`${r.offUs.toFixed(1)}us`.padStart(12) +
+					`${r.onUs.toFixed(1)}us`.padStart(12) +
+					`${r.dspUs.toFixed(1)}us`.padStart(12) +
+					`${cost.toFixed(1)}%`.padStart(10),
+			);
+		}
+	}
+}
+
+if (!flag("no-segments")) {
+	console.log(
+		`\n${"segments".padEnd(18)}${"count".padStart(8)}${"bytes".padStart(12)}  result`,
+	);
+	for (const spec of selected) {
+		const path = await prepareClip(spec, encoders);
+		if (!path) continue;
+		let note: string;
+		let check: SegmentCheck | null = null;
+		try {
+			check = await checkSegments(path);
+			note =
+				check.mismatchAt < 0
+					? "identical"
+					: `mismatch at byte ${check.mismatchAt}`;
+			if (check.mismatchAt >= 0) failures++;
+		} catch (e) {
+			failures++;
+			note = `failed: ${(e as Error).message}`;
+		}
+		console.log(
+			spec.name.padEnd(18) +
+				String(check?.segments ?? "-").padStart(8) +
+				String(check?.bytes ?? "-").padStart(12) +
+				`  ${note}`,
+		);
+	}
+}
+
+const hasBaseline = Object.keys(baseline).length > 0;
+if (updateBaseline) {
+	writeFileSync(
+		BASELINE_PATH,
+		`${JSON.stringify({ ...baseline, ...results }, null, "\t")}\n`,
+	);
+	console.log(`\n📄 基线已写入 ${BASELINE_PATH}`);
+} else if (!hasBaseline) {
+	console.error(
+		`\n❌ 没有基线 ${BASELINE_PATH}，先用 --update-baseline 在本机记录`,
+	);
+} else {
+	// 基线中有、这次没有测到的条目（片段或编码器缺失），不能算作通过
+	const expected = selected.flatMap((c) =>
+		variants.map((v) => (v === "scalar" ? c.name : `${c.name}@${v}`)),
+	);
+	const unmeasured = expected.filter(
+		(name) => baseline[name] && !results[name],
+	);
+	if (unmeasured.length > 0) {
+		console.warn(`\n⚠️ 基线中的条目没有测到：${unmeasured.join(", ")}`);
+	}
+}
+
+if (regressions.length > 0) {
+	console.error(`\n❌ 超出 ${(threshold * 100).toFixed(0)}% 阈值的回归：`);
+	for (const r of regressions) console.error(`  ${r}`);
+}
+
+if (
+	failures > 0 ||
+	(!updateBaseline && (!hasBaseline || regressions.length > 0))
+) {
+	process.exit(1);
+}
+
+console.log("\n✅ 基准测试完成");
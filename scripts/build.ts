@@ -26,15 +26,18 @@ try {
 	process.exit(1);
 }
 
-const wasmSource = join(JS_OUTPUT_DIR, "ffmpeg.wasm");
-const wasmDest = join(WASM_OUTPUT_DIR, "ffmpeg.wasm");
-
-if (existsSync(wasmSource)) {
-	console.log(`📂 正在移动 WASM 文件到 ${WASM_OUTPUT_DIR} ...`);
-	renameSync(wasmSource, wasmDest);
-} else {
-	console.error("❌ 错误：构建产物中未找到 ffmpeg.wasm");
-	process.exit(1);
+// 标量版本与 SIMD 版本，运行时由 worker 按环境选择
+for (const name of ["ffmpeg.wasm", "ffmpeg-simd.wasm"]) {
+	const wasmSource = join(JS_OUTPUT_DIR, name);
+	const wasmDest = join(WASM_OUTPUT_DIR, name);
+
+	if (existsSync(wasmSource)) {
+		console.log(`📂 正在移动 ${name} 到 ${WASM_OUTPUT_DIR} ...`);
+		renameSync(wasmSource, wasmDest);
+	} else {
+		console.error(`❌ 错误：构建产物中未找到 ${name}`);
+		process.exit(1);
+	}
 }
 
 console.log("✅ 构建完成！");
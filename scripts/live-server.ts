@@ -0,0 +1,168 @@
+/**
+ * @fileoverview 把本地文件按实时速率循环输出为直播流，用于测试 FFmpegAudioPlayer.loadLive
+ *
+ * 用法：
+ *   bun scripts/live-server.ts <file>                在 http://localhost:8000/ 提供直播流
+ *   bun scripts/live-server.ts <file> --port=9000
+ *   bun scripts/live-server.ts <file> --bitrate=320  发送码率（kbps），默认用 ffprobe 读取，失败时为 128
+ *   bun scripts/live-server.ts <file> --burst=10     连接时先突发发送的秒数，模拟电台的预缓冲
+ *
+ * 请求头带 Icy-MetaData: 1 时每 ICY_METAINT 字节插入一个 ICY 元数据块，
+ * StreamTitle 在文件每循环一次时变化。文件按字节拼接循环，只适合可以从任意位置
+ * 重新同步的格式（MP3、ADTS AAC 等）。
+ */
+
+import { readFileSync } from "node:fs";
+import { basename, extname } from "node:path";
+import { $ } from "bun";
+
+const ICY_METAINT = 16000;
+const TICK_MS = 100;
+
+const CONTENT_TYPES: Record<string, string> = {
+	".mp3": "audio/mpeg",
+	".aac": "audio/aac",
+	".ogg": "audio/ogg",
+	".opus": "audio/ogg",
+};
+
+const argv = process.argv.slice(2);
+const file = argv.find((arg) => !arg.startsWith("--"));
+if (!file) {
+	console.error(
+		"用法：bun scripts/live-server.ts <file> [--port=8000] [--bitrate=kbps] [--burst=秒]",
+	);
+	process.exit(1);
+}
+
+function option(name: string) {
+	return argv.find((arg) => arg.startsWith(`--${name}=`))?.split("=")[1];
+}
+
+async function probeBitrate(path: string) {
+	const out =
+		await $`ffprobe -v error -show_entries format=bit_rate -of csv=p=0 ${path}`
+			.nothrow()
+			.quiet()
+			.text();
+	const bps = Number.parseInt(out.trim(), 10);
+	return Number.isFinite(bps) && bps > 0 ? bps : 128_000;
+}
+
+const data = readFileSync(file);
+const port = Number(option("port") ?? 8000);
+const burstSeconds = Number(option("burst") ?? 0);
+const bitrateOption = option("bitrate");
+const bitrate = bitrateOption
+	? Number(bitrateOption) * 1000
+	: await probeBitrate(file);
+const bytesPerSecond = bitrate / 8;
+const name = basename(file);
+
+function icyBlock(title: string) {
+	const text = new TextEncoder().encode(`StreamTitle='${title}';`);
+	const blocks = Math.ceil(text.length / 16);
+	const out = new Uint8Array(1 + blocks * 16);
+	out[0] = blocks;
+	out.set(text, 1);
+	return out;
+}
+
+function liveStream(withIcy: boolean) {
+	let offset = 0;
+	let loop = 0;
+	let untilMeta = ICY_METAINT;
+	// 第一个元数据块和每次回绕后的下一个块带上新标题，其余为长度 0 的空块
+	let titleChanged = true;
+	let timer: ReturnType<typeof setInterval> | undefined;
+
+	const take = (n: number) => {
+		const out = new Uint8Array(n);
+		for (let filled = 0; filled < n; ) {
+			const k = Math.min(n - filled, data.length - offset);
+			out.set(data.subarray(offset, offset + k), filled);
+			filled += k;
+			offset += k;
+			if (offset === data.length) {
+				offset = 0;
+				loop++;
+				titleChanged = true;
+			}
+		}
+		return out;
+	};
+
+	const emit = (
+		controller: ReadableStreamDefaultController<Uint8Array>,
+		bytes: number,
+	) => {
+		let left = bytes;
+		while (left > 0) {
+			if (!withIcy) {
+				controller.enqueue(take(left));
+				return;
+			}
+			const n = Math.min(left, untilMeta);
+			controller.enqueue(take(n));
+			left -= n;
+			untilMeta -= n;
+			if (untilMeta === 0) {
+				controller.enqueue(
+					titleChanged ? icyBlock(`${name} #${loop + 1}`) : new Uint8Array(1),
+				);
+				titleChanged = false;
+				untilMeta = ICY_METAINT;
+			}
+		}
+	};
+
+	return new ReadableStream<Uint8Array>({
+		start(controller) {
+			emit(controller, Math.round(burstSeconds * bytesPerSecond));
+
+			const started = performance.now();
+			let sent = 0;
+			timer = setInterval(() => {
+				const elapsed = (performance.now() - started) / 1000;
+				const due = Math.round(elapsed * bytesPerSecond);
+				emit(controller, due - sent);
+				sent = due;
+			}, TICK_MS);
+		},
+		cancel() {
+			clearInterval(timer);
+		},
+	});
+}
+
+const CORS_HEADERS = {
+	"Access-Control-Allow-Origin": "*",
+	"Access-Control-Allow-Headers": "Icy-MetaData",
+	"Access-Control-Expose-Headers": "icy-metaint, icy-name",
+};
+
+Bun.serve({
+	port,
+	fetch(req) {
+		if (req.method === "OPTIONS") {
+			return new Response(null, { headers: CORS_HEADERS });
+		}
+
+		const withIcy = req.headers.get("icy-metadata") === "1";
+		const headers: Record<string, string> = {
+			...CORS_HEADERS,
+			"Content-Type":
+				CONTENT_TYPES[extname(name).toLowerCase()] ??
+				"application/octet-stream",
+			"Cache-Control": "no-cache",
+			"icy-name": name,
+		};
+		if (withIcy) headers["icy-metaint"] = String(ICY_METAINT);
+
+		return new Response(liveStream(withIcy), { headers });
+	},
+});
+
+console.log(
+	`Live: http://localhost:${port}/  (${name} @ ${Math.round(bitrate / 1000)} kbps)`,
+);
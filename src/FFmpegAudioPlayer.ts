@@ -1,30 +1,51 @@
 import type {
+	AudioCueTrack,
 	AudioMetadata,
+	CrossfadeCurveName,
+	DecoderWorker,
+	DistributiveOmit,
+	EqBandOptions,
+	LimiterOptions,
+	LiveOptions,
+	NormalizationOptions,
 	PlayerEventMap,
 	PlayerState,
+	SessionPriorityName,
+	SkipSilenceOptions,
+	SpectrumChunk,
+	SpectrumOptions,
+	StreamMetadata,
 	WorkerRequest,
 	WorkerResponse,
 } from "./types";
 import { toError } from "./utils/errorUtils";
 import { SharedRingBuffer } from "./utils/SharedRingBuffer";
 import { type GetDetail, TypedEventTarget } from "./utils/TypedEventTarget";
-
-type DistributiveOmit<T, K extends PropertyKey> = T extends unknown
-	? Omit<T, K>
-	: never;
+import { createWavHeader } from "./utils/wav";
+import { WorkerPool } from "./utils/WorkerPool";
 
 const HIGH_WATER_MARK = 30;
 const LOW_WATER_MARK = 10;
+// 直播流的延迟主要由解码器的抖动缓冲控制，已排程的音频只保留很少
+const LIVE_HIGH_WATER_MARK = 1.5;
+const LIVE_LOW_WATER_MARK = 0.75;
+const LIVE_CHUNK_SIZE = 4096;
+const LIVE_TARGET_LATENCY = 2;
+const LIVE_MAX_LATENCY = 8;
 const FADE_DURATION = 0.15;
 const SEEK_FADE_DURATION = 0.05;
 const IDX_SEEK_GEN = 4;
+/** 拖动预览片段的默认时长（毫秒） */
+const SCRUB_PREVIEW_MS = 80;
+/** 预览片段首尾的淡入淡出，避免咔哒声 */
+const SCRUB_FADE = 0.005;
 
 type FFmpegPlayerEventMap = {
 	[K in keyof PlayerEventMap]: CustomEvent<PlayerEventMap[K]>;
 };
 
 export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
-	private worker: Worker | null = null;
+	private worker: DecoderWorker | null = null;
 	private audioCtx: AudioContext | null = null;
 	private masterGain: GainNode | null = null;
 	public analyser: AnalyserNode | null = null;
@@ -37,6 +58,34 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 	private isDecodingFinished = false;
 	private targetVolume = 1.0;
 	private currentTempo = 1.0;
+	/** 1 正向，-1 倒放 */
+	private playbackDirection = 1;
+	/** 当前 A-B 循环区间（秒） */
+	private loopRegion: { start: number; end: number } | null = null;
+	/** 已加载的 CUE 音轨 */
+	private cueTracks: AudioCueTrack[] = [];
+
+	/** queueNext 使用的交叉淡化设置，每次排队时发给 worker */
+	private crossfade: { seconds: number; curve: CrossfadeCurveName } = {
+		seconds: 5,
+		curve: "equalPower",
+	};
+	/** queueNext 排队的下一首，worker 切换过去后移入 pendingTrackChange */
+	private queuedMetadata: AudioMetadata | null = null;
+	/** 最近一个 chunk 所属的曲目序号 */
+	private chunkTrackIndex = 0;
+	/** 切换曲目后 chunk 的样本格式，metadata 还是上一首时使用 */
+	private chunkFormat: { sampleRate: number; channels: number } | null = null;
+	/**
+	 * 已排程、尚未播放到的曲目切换：at 之前 currentTime 仍按上一首的锚点计算，
+	 * 播放到 at 时才切换 metadata 并派发 trackchange
+	 */
+	private pendingTrackChange: {
+		at: number;
+		wallTime: number;
+		sourceTime: number;
+		metadata: AudioMetadata;
+	} | null = null;
 
 	/** 锚点时刻的 AudioContext 时间 */
 	private anchorWallTime = 0;
@@ -48,15 +97,28 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 
 	private timeUpdateFrameId: number = 0;
 
+	/** 已排程的频谱帧，time 为该帧对应的 AudioContext 时间 */
+	private spectrumFrames: { time: number; bands: Float32Array }[] = [];
+
 	private ringBuffer: SharedRingBuffer | null = null;
 	private sabHeader: Int32Array | null = null;
 	private fetchController: AbortController | null = null;
 	private isStreaming = false;
+	/** 直播流：不可 seek，时长为 Infinity */
+	private isLive = false;
+	/** 直播元数据，播放到 time 时才派发 streammetadata */
+	private pendingStreamMetadata: StreamMetadata[] = [];
 	private currentUrl: string | null = null;
 	private fileSize = 0;
 
 	private playSessionId = 0;
 
+	/** 解码器预读队列中的压缩数据时长（秒） */
+	private queuedDuration = 0;
+
+	/** 正在播放的拖动预览片段 */
+	private scrubSource: AudioBufferSourceNode | null = null;
+
 	private msgIdCounter = 0;
 
 	private pendingRequests = new Map<
@@ -68,7 +130,11 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 		}
 	>();
 
-	constructor(private workerFactory: () => Worker) {
+	/**
+	 * workerFactory 可以每次创建独立的 Worker，也可以返回 SharedDecoderWorker 的端口，
+	 * 让多个播放器共用一个 worker 和 wasm 实例
+	 */
+	constructor(private workerFactory: () => DecoderWorker) {
 		super();
 	}
 
@@ -76,13 +142,31 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 		return this.playerState;
 	}
 	public get duration() {
+		if (this.isLive) return Infinity;
 		return this.metadata?.duration || 0;
 	}
 	public get currentTime() {
 		if (!this.audioCtx) return 0;
-		const wallDelta = this.audioCtx.currentTime - this.anchorWallTime;
-		const currentPosition =
-			this.anchorSourceTime + wallDelta * this.currentTempo;
+		const now = this.audioCtx.currentTime;
+		// 下一首的 chunk 已排程，但上一首还没播完
+		const pending = this.pendingTrackChange;
+		if (pending && now < pending.at) {
+			const delta = (now - pending.wallTime) * this.currentTempo;
+			return Math.max(0, pending.sourceTime + delta * this.playbackDirection);
+		}
+		const wallDelta = now - this.anchorWallTime;
+		let currentPosition =
+			this.anchorSourceTime +
+			wallDelta * this.currentTempo * this.playbackDirection;
+		// 锚点已是回绕后的 chunk、但它还没开始播放
+		const loop = this.loopRegion;
+		if (
+			loop &&
+			currentPosition < loop.start &&
+			this.anchorSourceTime >= loop.start
+		) {
+			currentPosition += loop.end - loop.start;
+		}
 		return Math.max(0, currentPosition);
 	}
 	public get volume() {
@@ -91,6 +175,10 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 	public get audioInfo() {
 		return this.metadata;
 	}
+	/** 解码器中已解复用、尚未解码的数据时长（秒），可用于控制网络拉取节奏 */
+	public get bufferedPacketDuration() {
+		return this.queuedDuration;
+	}
 
 	private bumpSession(): number {
 		this.playSessionId++;
@@ -139,8 +227,7 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 		try {
 			await this.initAudioContext();
 
-			this.worker = this.workerFactory();
-			this.setupWorkerListeners();
+			this.spawnWorker();
 
 			this.isStreaming = false;
 
@@ -183,8 +270,7 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 			const sab = this.ringBuffer.sharedArrayBuffer;
 			this.sabHeader = new Int32Array(sab, 0, IDX_SEEK_GEN + 1);
 
-			this.worker = this.workerFactory();
-			this.setupWorkerListeners();
+			this.spawnWorker();
 			this.isStreaming = true;
 
 			const initWorkerPromise = this.requestWorker({
@@ -204,6 +290,83 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 		}
 	}
 
+	/**
+	 * 播放直播流（网络电台等）。不需要 Content-Length，也不支持 seek；
+	 * 服务器返回 icy-metaint 时，流中的曲目标题通过 streammetadata 事件按播放时间派发
+	 */
+	public async loadLive(url: string, options: LiveOptions = {}) {
+		this.reset();
+		const sessionId = this.bumpSession();
+		this.dispatch("loadstart");
+
+		try {
+			await this.initAudioContext();
+
+			this.fetchController = new AbortController();
+			const signal = this.fetchController.signal;
+			const response = await fetch(url, {
+				headers: { "Icy-MetaData": "1" },
+				signal,
+			});
+			if (!response.ok) {
+				throw new Error(
+					`Fetch failed: ${response.status} ${response.statusText}`,
+				);
+			}
+
+			const BUFFER_SIZE = 512 * 1024;
+			this.ringBuffer = SharedRingBuffer.create(BUFFER_SIZE);
+			this.currentUrl = url;
+			this.isLive = true;
+
+			this.spawnWorker();
+
+			const initWorkerPromise = this.requestWorker({
+				type: "INIT_LIVE",
+				sab: this.ringBuffer.sharedArrayBuffer,
+				icyMetaint: Number(response.headers.get("icy-metaint") ?? 0) || 0,
+				targetLatency: options.targetLatency ?? LIVE_TARGET_LATENCY,
+				maxLatency: options.maxLatency ?? LIVE_MAX_LATENCY,
+				chunkSize: LIVE_CHUNK_SIZE,
+				sessionId,
+			});
+
+			this.pumpResponse(response, signal).catch((e) => {
+				const err = toError(e);
+				if (err.name === "AbortError") return;
+				console.error("[Player] Live stream error:", err);
+				this.dispatch("error", `Network error: ${err.message}`);
+			});
+			await initWorkerPromise;
+		} catch (e) {
+			const err = toError(e);
+			console.error("[Player] LoadLive error:", err);
+			this.dispatch("error", err.message);
+		}
+	}
+
+	/** 把响应体写入环形缓冲区，直到结束或被中止 */
+	private async pumpResponse(response: Response, signal: AbortSignal) {
+		if (!response.body) throw new Error("Response body is null");
+
+		const reader = response.body.getReader();
+
+		while (true) {
+			const { done, value } = await reader.read();
+
+			if (done) {
+				this.ringBuffer?.setEOF();
+				break;
+			}
+
+			if (value && this.ringBuffer) {
+				await this.ringBuffer.write(value);
+			}
+
+			if (signal.aborted) break;
+		}
+	}
+
 	private async runFetchLoop(
 		url: string,
 		startOffset: number,
@@ -244,24 +407,9 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 
 			if (!response.body) throw new Error("Response body is null");
 
-			const reader = response.body.getReader();
-
 			this.notifyWorkerSeek();
 
-			while (true) {
-				const { done, value } = await reader.read();
-
-				if (done) {
-					this.ringBuffer?.setEOF();
-					break;
-				}
-
-				if (value && this.ringBuffer) {
-					await this.ringBuffer.write(value);
-				}
-
-				if (signal.aborted) break;
-			}
+			await this.pumpResponse(response, signal);
 		} catch (e) {
 			const err = toError(e);
 			if (err.name === "AbortError") {
@@ -320,9 +468,70 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 	 * @returns 如果跳转操作完成，包括淡入淡出完成，则 resolve
 	 */
 	public async seek(time: number, immediate = false) {
+		await this.seekTo(time, immediate);
+	}
+
+	/**
+	 * 跳到第 index 个章节的开头，按容器中的章节时间精确定位
+	 */
+	public async seekChapter(index: number) {
+		const chapter = this.metadata?.chapters[index];
+		if (!chapter) return;
+		await this.seekTo(chapter.start, false, { chapter: index });
+	}
+
+	/** 当前播放位置所在的章节序号，没有章节时为 -1 */
+	public get currentChapter() {
+		const chapters = this.metadata?.chapters ?? [];
+		const time = this.currentTime;
+		return chapters.findLastIndex((c) => c.start <= time);
+	}
+
+	/**
+	 * 加载整轨镜像的 CUE 表，不传 text 时使用文件内嵌的 CUESHEET 标签。
+	 * 音轨只是镜像中的区间，之后用 playCueTrack 切换，不会重新打开文件
+	 */
+	public async loadCueSheet(text = "") {
+		if (!this.worker) return [];
+		this.cueTracks = await this.requestWorker<AudioCueTrack[]>({
+			type: "LOAD_CUE",
+			text,
+		});
+		return this.cueTracks;
+	}
+
+	/**
+	 * 从第 index 条 CUE 音轨的 INDEX 01 样本开始播放。
+	 * continuous 时后续音轨无缝接着播放，否则在音轨结束处触发 ended
+	 */
+	public async playCueTrack(index: number, continuous = true) {
+		const track = this.cueTracks[index];
+		if (!track) return;
+		await this.seekTo(track.start, false, {
+			cueTrack: { index, continuous },
+		});
+	}
+
+	/** 当前播放位置所在的 CUE 音轨序号，没有加载 CUE 时为 -1 */
+	public get currentCueTrack() {
+		const time = this.currentTime;
+		return this.cueTracks.findLastIndex((t) => t.start <= time);
+	}
+
+	private async seekTo(
+		time: number,
+		immediate: boolean,
+		target: Pick<
+			Extract<WorkerRequest, { type: "SEEK" }>,
+			"chapter" | "cueTrack"
+		> = {},
+	) {
 		if (!this.worker || !this.audioCtx || !this.metadata || !this.masterGain)
 			return;
+		if (this.isLive) return;
 
+		// worker 已切换到下一首，seek 在新曲目内进行
+		this.applyTrackChange();
 		const sessionId = this.bumpSession();
 
 		this.dispatch("seeking");
@@ -347,6 +556,7 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 			type: "SEEK",
 			seekTime: time,
 			sessionId,
+			...target,
 		});
 
 		this.dispatch("timeupdate", time);
@@ -377,6 +587,60 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 		await this.seek(trueTime, true);
 	}
 
+	/**
+	 * varispeed 模式：setTempo 只做重采样，音调随速度变化（磁带/唱盘效果），
+	 * CPU 开销远低于保持音调的变速；该模式下 setPitch 不生效。不需要保持音调时可以默认开启。
+	 * 直播流不支持：追赶积压时的加速需要保持音调
+	 */
+	public async setVarispeed(enabled: boolean) {
+		if (!this.worker) return;
+		const trueTime = this.currentTime;
+		await this.requestWorker({ type: "SET_VARISPEED", enabled });
+		await this.seek(trueTime, true);
+	}
+
+	/**
+	 * 调整解码会话在共享 worker 中的调度优先级，例如预加载的下一首开始播放时
+	 * 从 "prefetch" 提升为 "realtime"。独占 worker 时没有效果
+	 */
+	public async setDecodePriority(priority: SessionPriorityName) {
+		if (!this.worker) return;
+		await this.requestWorker({ type: "SET_PRIORITY", value: priority });
+	}
+
+	/** 从当前位置开始倒放或恢复正向播放 */
+	public async setReverse(enabled: boolean) {
+		if (!this.worker) return;
+		const trueTime = this.currentTime;
+		await this.requestWorker({ type: "SET_REVERSE", enabled });
+		this.playbackDirection = enabled ? -1 : 1;
+		await this.seek(trueTime, true);
+	}
+
+	/**
+	 * 无缝循环 [start, end)，回绕处做 crossfadeMs 的交叉淡化。
+	 * 当前位置在区间外时播放到 start 才开始循环
+	 */
+	public async setLoop(start: number, end: number, crossfadeMs = 10) {
+		if (!this.worker) return;
+		const trueTime = this.currentTime;
+		// 区间需要先完整解码，较长的区间比普通请求耗时
+		await this.requestWorker(
+			{ type: "SET_LOOP", region: { start, end, crossfadeMs } },
+			[],
+			30000,
+		);
+		this.loopRegion = { start, end };
+		await this.seek(trueTime, true);
+	}
+
+	/** 取消循环，从循环内的当前位置继续往后播放 */
+	public async clearLoop() {
+		if (!this.worker) return;
+		await this.requestWorker({ type: "SET_LOOP", region: null });
+		this.loopRegion = null;
+	}
+
 	public async resetTempoAndPitch() {
 		if (!this.worker) return;
 		const trueTime = this.currentTime;
@@ -388,11 +652,209 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 		await this.seek(trueTime, true);
 	}
 
-	public async exportAsWav(file: File): Promise<Blob> {
-		return this.requestWorker<Blob>({
-			type: "EXPORT_WAV",
-			file: file,
+	/**
+	 * 设置 queueNext 的交叉淡化时长（秒）和增益曲线，0 为无缝衔接。
+	 * 已排队的下一首在过渡开始前调整也会生效
+	 */
+	public async setCrossfade(
+		seconds: number,
+		curve: CrossfadeCurveName = "equalPower",
+	) {
+		this.crossfade = { seconds, curve };
+		if (!this.worker) return;
+		await this.requestWorker({ type: "SET_CROSSFADE", seconds, curve });
+	}
+
+	/**
+	 * 排队下一首本地文件，当前曲目结束时在同一个解码会话里交叉淡化过去，不经过 load 的停顿。
+	 * 播放到新曲目时 audioInfo、duration 随之切换并派发 trackchange。
+	 * 过渡开始前再次调用会替换排队的曲目；直播流不支持
+	 */
+	public async queueNext(file: File): Promise<AudioMetadata> {
+		if (!this.worker || !this.metadata) {
+			throw new Error("No track is loaded");
+		}
+		const { seconds, curve } = this.crossfade;
+		await this.requestWorker({ type: "SET_CROSSFADE", seconds, curve });
+		const metadata = await this.requestWorker<AudioMetadata>({
+			type: "QUEUE_NEXT",
+			file,
+		});
+		this.queuedMetadata = metadata;
+		return metadata;
+	}
+
+	/**
+	 * 切换到容器中的另一条音频流（多语言有声书、多音轨等），保持当前播放位置
+	 * @param streamIndex `audioInfo.streams` 中的 `index`
+	 */
+	public async selectStream(streamIndex: number) {
+		if (!this.worker) return;
+		const trueTime = this.currentTime;
+		await this.requestWorker({ type: "SELECT_STREAM", streamIndex });
+		await this.seek(trueTime, true);
+	}
+
+	/**
+	 * 在 Worker 内的解码器中设置均衡频段，作用于之后解码的 chunk
+	 * @param index 频段序号 0-15
+	 * @param band 传 null 关闭该频段
+	 */
+	public async setEqBand(index: number, band: EqBandOptions | null) {
+		if (!this.worker) return;
+		await this.requestWorker({ type: "SET_EQ_BAND", index, band });
+	}
+
+	/**
+	 * 在 worker 中随解码计算频谱（null 关闭），结果用 getSpectrum 读取，
+	 * 不再需要渲染线程上的 AnalyserNode FFT
+	 */
+	public async setSpectrum(options: SpectrumOptions | null) {
+		if (!this.worker) return;
+		await this.requestWorker({ type: "SET_SPECTRUM", options });
+		if (!options) this.spectrumFrames = [];
+	}
+
+	/** 当前正在播放的频谱帧（各频带 dB），没有时返回 null */
+	public getSpectrum(): Float32Array | null {
+		if (!this.audioCtx) return null;
+		const now = this.audioCtx.currentTime;
+		let latest: Float32Array | null = null;
+		let played = 0;
+		for (const frame of this.spectrumFrames) {
+			if (frame.time > now) break;
+			latest = frame.bands;
+			played++;
+		}
+		// 保留当前帧，之前的已经不会再用到
+		if (played > 1) this.spectrumFrames.splice(0, played - 1);
+		return latest;
+	}
+
+	public async setLimiter(options: LimiterOptions) {
+		if (!this.worker) return;
+		await this.requestWorker({ type: "SET_LIMITER", options });
+	}
+
+	/**
+	 * 跳过静音（播客、有声书），静音在解码器内被缩短，不会再传到主线程
+	 */
+	public async setSkipSilence(options: SkipSilenceOptions) {
+		if (!this.worker) return;
+		await this.requestWorker({ type: "SET_SKIP_SILENCE", options });
+	}
+
+	/**
+	 * 在解码器中按 ReplayGain/R128 标签做响度归一化，没有标签时使用运行响度估计
+	 */
+	public async setNormalization(options: NormalizationOptions) {
+		if (!this.worker) return;
+		await this.requestWorker({ type: "SET_NORMALIZATION", options });
+	}
+
+	/**
+	 * 拖动进度条时播放 time 附近的一小段预览。已播放过的位置直接取自解码缓存，
+	 * 其余位置由单独的解码器只定位到最近的关键帧（仅本地文件）；预览不经过变速处理。
+	 * 来不及处理的旧请求会被丢弃，此时 resolve 为 false。AudioContext 暂停（播放器暂停）时不出声。拖动结束后仍应调用 seek。
+	 */
+	public async scrub(
+		time: number,
+		durationMs = SCRUB_PREVIEW_MS,
+	): Promise<boolean> {
+		if (!this.worker || !this.audioCtx || !this.metadata) return false;
+
+		const data = await this.requestWorker<Float32Array | null>({
+			type: "SCRUB",
+			position: Math.max(0, time),
+			durationMs,
 		});
+		if (!data || data.length === 0 || !this.audioCtx || !this.metadata) {
+			return false;
+		}
+		if (this.audioCtx.state !== "running") return false;
+
+		const { sampleRate, channels } = this.metadata;
+		const frames = data.length / channels;
+		const buffer = this.audioCtx.createBuffer(channels, frames, sampleRate);
+		for (let ch = 0; ch < channels; ch++) {
+			const plane = data.subarray(ch * frames, (ch + 1) * frames);
+			buffer.copyToChannel(plane, ch);
+		}
+
+		this.scrubSource?.stop();
+
+		const now = this.audioCtx.currentTime;
+		const end = now + buffer.duration;
+		const gain = this.audioCtx.createGain();
+		gain.gain.setValueAtTime(0, now);
+		gain.gain.linearRampToValueAtTime(this.targetVolume, now + SCRUB_FADE);
+		gain.gain.setValueAtTime(this.targetVolume, end - SCRUB_FADE);
+		gain.gain.linearRampToValueAtTime(0, end);
+		gain.connect(this.audioCtx.destination);
+
+		const source = this.audioCtx.createBufferSource();
+		source.buffer = buffer;
+		source.connect(gain);
+		source.onended = () => {
+			gain.disconnect();
+			if (this.scrubSource === source) this.scrubSource = null;
+		};
+		source.start(now);
+		this.scrubSource = source;
+		return true;
+	}
+
+	/**
+	 * 导出为 WAV（原始解码结果，不含变速和音效），位深与源一致：整数源 16/24/32 位逐位一致，
+	 * 浮点源（有损编码）为 32 位浮点。容器内的无损/PCM、MP3、AAC-LC、Vorbis、AC-3 等
+	 * 按关键帧分段，在 parallelism 个独立的 worker 上并行解码，拼接结果与顺序解码逐样本一致；
+	 * HE-AAC、Opus 与裸流等不能可靠分段的格式只有一段，在单个 worker 上顺序解码
+	 */
+	public async exportAsWav(
+		file: File,
+		parallelism = navigator.hardwareConcurrency || 4,
+	): Promise<Blob> {
+		const pool = new WorkerPool(this.workerFactory, Math.max(1, parallelism));
+		try {
+			const plan = await pool.request(
+				0,
+				{ type: "EXPORT_PLAN", file, segments: pool.size },
+				"EXPORT_PLAN_DONE",
+			);
+			const segments = plan.boundaries
+				.slice(1)
+				.map((end, i) => ({ start: plan.boundaries[i] ?? 0, end }));
+
+			const blobs = await pool.map(segments, async ({ start, end }, w) => {
+				const resp = await pool.request(
+					w,
+					{
+						type: "EXPORT_SEGMENT",
+						file,
+						start,
+						end,
+						bitsPerSample: plan.bitsPerSample,
+						isFloat: plan.isFloat,
+					},
+					"EXPORT_SEGMENT_DONE",
+				);
+				return resp.blob;
+			});
+
+			const dataLength = blobs.reduce((acc, blob) => acc + blob.size, 0);
+			const wavHeader = createWavHeader(
+				plan.sampleRate,
+				plan.channels,
+				dataLength,
+				plan.bitsPerSample,
+				{ isFloat: plan.isFloat, channelMask: plan.channelMask },
+			);
+			return new Blob([wavHeader, ...blobs] as BlobPart[], {
+				type: "audio/wav",
+			});
+		} finally {
+			pool.terminate();
+		}
 	}
 
 	private async initAudioContext() {
@@ -416,6 +878,13 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 		}
 	}
 
+	// 重新加载时关闭上一个 worker；共享 worker 的端口只关闭自己的会话
+	private spawnWorker() {
+		this.worker?.terminate();
+		this.worker = this.workerFactory();
+		this.setupWorkerListeners();
+	}
+
 	private setupWorkerListeners() {
 		if (!this.worker) return;
 
@@ -441,14 +910,28 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 				} else if (resp.type === "SEEK_DONE") {
 					req.resolve();
 					isHandled = true;
-				} else if (resp.type === "EXPORT_WAV_DONE") {
-					req.resolve(resp.blob);
+				} else if (resp.type === "STREAM_CHANGED") {
+					req.resolve();
+					isHandled = true;
+				} else if (resp.type === "SCRUB_PREVIEW") {
+					req.resolve(resp.data);
+					isHandled = true;
+				} else if (resp.type === "CUE_TRACKS") {
+					req.resolve(resp.tracks);
+					isHandled = true;
+				} else if (resp.type === "NEXT_QUEUED") {
+					req.resolve(resp.metadata);
 					isHandled = true;
 				}
 
 				if (isHandled) {
 					this.pendingRequests.delete(msgId);
-					if (resp.type === "ACK" || resp.type === "EXPORT_WAV_DONE") {
+					if (
+						resp.type === "ACK" ||
+						resp.type === "SCRUB_PREVIEW" ||
+						resp.type === "CUE_TRACKS" ||
+						resp.type === "NEXT_QUEUED"
+					) {
 						return;
 					}
 				}
@@ -478,6 +961,9 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 						encoding: resp.encoding,
 						coverUrl: resp.coverUrl,
 						bitsPerSample: resp.bitsPerSample,
+						streams: resp.streams,
+						streamIndex: resp.streamIndex,
+						chapters: resp.chapters,
 					};
 					if (this.audioCtx) {
 						const now = this.audioCtx.currentTime;
@@ -488,23 +974,50 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 					this.dispatch("loadedmetadata");
 					this.dispatch("canplay");
 					break;
+				case "STREAM_CHANGED":
+					this.applyTrackChange();
+					if (this.metadata) {
+						this.metadata = {
+							...this.metadata,
+							sampleRate: resp.sampleRate,
+							channels: resp.channels,
+							encoding: resp.encoding,
+							bitsPerSample: resp.bitsPerSample,
+							streamIndex: resp.streamIndex,
+						};
+					}
+					break;
 				case "CHUNK":
 					if (resp.sessionId !== this.playSessionId) {
 						return;
 					}
 
+					this.queuedDuration = resp.queuedDuration;
+					if (resp.streamMetadata) {
+						this.pendingStreamMetadata.push(...resp.streamMetadata);
+					}
+
+					if (resp.trackIndex !== this.chunkTrackIndex) {
+						this.beginTrackChange(resp.trackIndex);
+					}
+
 					if (this.metadata) {
+						const format = this.chunkFormat ?? this.metadata;
 						this.scheduleChunk(
 							resp.data,
-							this.metadata.sampleRate,
-							this.metadata.channels,
+							format.sampleRate,
+							format.channels,
 							resp.startTime,
+							resp.spectrum,
 						);
 
 						if (this.audioCtx) {
 							const bufferedDuration =
 								this.nextStartTime - this.audioCtx.currentTime;
-							if (bufferedDuration > HIGH_WATER_MARK && !this.isWorkerPaused) {
+							const highWater = this.isLive
+								? LIVE_HIGH_WATER_MARK
+								: HIGH_WATER_MARK;
+							if (bufferedDuration > highWater && !this.isWorkerPaused) {
 								this.isWorkerPaused = true;
 								this.requestWorker({
 									type: "PAUSE",
@@ -562,6 +1075,7 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 		sampleRate: number,
 		channels: number,
 		chunkStartTime: number,
+		spectrum?: SpectrumChunk,
 	) {
 		if (!this.audioCtx || !this.masterGain || !this.analyser) return;
 		const ctx = this.audioCtx;
@@ -593,6 +1107,16 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 
 		source.start(this.nextStartTime);
 
+		if (spectrum) {
+			for (let i = 0; i < spectrum.offsets.length; i++) {
+				const start = i * spectrum.bands;
+				this.spectrumFrames.push({
+					time: this.nextStartTime + (spectrum.offsets[i] ?? 0),
+					bands: spectrum.data.subarray(start, start + spectrum.bands),
+				});
+			}
+		}
+
 		this.nextStartTime += audioBuffer.duration;
 
 		this.activeSources.push(source);
@@ -605,7 +1129,8 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 
 			if (this.audioCtx && !this.isDecodingFinished) {
 				const bufferedDuration = this.nextStartTime - this.audioCtx.currentTime;
-				if (bufferedDuration < LOW_WATER_MARK && this.isWorkerPaused) {
+				const lowWater = this.isLive ? LIVE_LOW_WATER_MARK : LOW_WATER_MARK;
+				if (bufferedDuration < lowWater && this.isWorkerPaused) {
 					this.isWorkerPaused = false;
 					this.requestWorker({ type: "RESUME" }).catch((err) => {
 						console.error(
@@ -629,6 +1154,49 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 		};
 	}
 
+	/** 收到下一首的第一个 chunk：从它开始按新曲目的格式排程，播放到它时再切换 metadata */
+	private beginTrackChange(trackIndex: number) {
+		this.applyTrackChange();
+		this.chunkTrackIndex = trackIndex;
+		const metadata = this.queuedMetadata;
+		this.queuedMetadata = null;
+		if (!metadata || !this.audioCtx) return;
+
+		this.chunkFormat = {
+			sampleRate: metadata.sampleRate,
+			channels: metadata.channels,
+		};
+		// 下一首总是本地文件，上一首的网络拉取可以停止
+		if (this.fetchController) {
+			this.fetchController.abort();
+			this.fetchController = null;
+		}
+		this.isStreaming = false;
+		this.ringBuffer = null;
+		this.sabHeader = null;
+
+		this.pendingTrackChange = {
+			at: Math.max(this.nextStartTime, this.audioCtx.currentTime),
+			wallTime: this.anchorWallTime,
+			sourceTime: this.anchorSourceTime,
+			metadata,
+		};
+	}
+
+	private applyTrackChange() {
+		const change = this.pendingTrackChange;
+		if (!change) return;
+		this.pendingTrackChange = null;
+		this.metadata = change.metadata;
+		this.chunkFormat = null;
+		// 循环区间、CUE 音轨和倒放都属于上一首，新曲目的解码器从正向开始
+		this.loopRegion = null;
+		this.cueTracks = [];
+		this.playbackDirection = 1;
+		this.dispatch("durationchange", change.metadata.duration);
+		this.dispatch("trackchange", change.metadata);
+	}
+
 	private checkIfEnded() {
 		if (this.state !== "playing") return;
 		if (this.activeSources.length > 0) return;
@@ -651,6 +1219,7 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 	}
 
 	private stopActiveSources() {
+		this.spectrumFrames = [];
 		this.activeSources.forEach((source) => {
 			try {
 				source.stop();
@@ -665,13 +1234,27 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 		this.stopTimeUpdate();
 		const tick = () => {
 			if (this.state === "playing") {
-				this.dispatch("timeupdate", this.currentTime);
+				const change = this.pendingTrackChange;
+				if (change && this.audioCtx && this.audioCtx.currentTime >= change.at) {
+					this.applyTrackChange();
+				}
+				const time = this.currentTime;
+				this.dispatchStreamMetadata(time);
+				this.dispatch("timeupdate", time);
 				this.timeUpdateFrameId = requestAnimationFrame(tick);
 			}
 		};
 		this.timeUpdateFrameId = requestAnimationFrame(tick);
 	}
 
+	private dispatchStreamMetadata(time: number) {
+		const pending = this.pendingStreamMetadata;
+		while (pending.length > 0 && (pending[0]?.time ?? 0) <= time) {
+			const event = pending.shift();
+			if (event) this.dispatch("streammetadata", event);
+		}
+	}
+
 	private stopTimeUpdate() {
 		if (this.timeUpdateFrameId) {
 			cancelAnimationFrame(this.timeUpdateFrameId);
@@ -730,6 +1313,14 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 		this.metadata = null;
 		this.isWorkerPaused = false;
 		this.isDecodingFinished = false;
+		// 新文件的解码器总是从正向开始
+		this.playbackDirection = 1;
+		this.loopRegion = null;
+		this.cueTracks = [];
+		this.queuedMetadata = null;
+		this.chunkTrackIndex = 0;
+		this.chunkFormat = null;
+		this.pendingTrackChange = null;
 		this.nextStartTime = this.audioCtx ? this.audioCtx.currentTime : 0;
 
 		if (this.masterGain) {
@@ -742,6 +1333,8 @@ export class FFmpegAudioPlayer extends TypedEventTarget<FFmpegPlayerEventMap> {
 			this.fetchController = null;
 		}
 		this.isStreaming = false;
+		this.isLive = false;
+		this.pendingStreamMetadata = [];
 		this.ringBuffer = null;
 		this.sabHeader = null;
 
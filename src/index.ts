@@ -1,2 +1,6 @@
 export { FFmpegAudioPlayer } from "./FFmpegAudioPlayer";
+export {
+	SharedDecoderPort,
+	SharedDecoderWorker,
+} from "./utils/SharedDecoderWorker";
 export type * from "./types";
@@ -6,6 +6,35 @@ export type PlayerState =
 	| "paused"
 	| "error";
 
+export interface AudioStreamDescription {
+	index: number;
+	codec: string;
+	channels: number;
+	sampleRate: number;
+	language: string;
+	title: string;
+	isDefault: boolean;
+}
+
+export interface AudioChapter {
+	/** 开始时间（秒） */
+	start: number;
+	/** 结束时间（秒） */
+	end: number;
+	title: string;
+}
+
+export interface AudioCueTrack {
+	/** CUE 表中的 TRACK 编号 */
+	number: number;
+	/** INDEX 01 在整轨镜像中的时间（秒） */
+	start: number;
+	/** 下一轨 INDEX 01 的时间，最后一轨为文件时长 */
+	end: number;
+	title: string;
+	performer: string;
+}
+
 export interface AudioMetadata {
 	sampleRate: number;
 	channels: number;
@@ -14,6 +43,77 @@ export interface AudioMetadata {
 	encoding: string;
 	coverUrl?: string | undefined;
 	bitsPerSample: number;
+	streams: AudioStreamDescription[];
+	streamIndex: number;
+	chapters: AudioChapter[];
+}
+
+export interface EqBandOptions {
+	/** 对应 EqFilterType：0 峰值 1 低架 2 高架 3 低通 4 高通 */
+	type: number;
+	freq: number;
+	gainDb: number;
+	q: number;
+}
+
+export interface LimiterOptions {
+	enabled: boolean;
+	thresholdDb: number;
+	lookaheadMs: number;
+	releaseMs: number;
+}
+
+export interface NormalizationOptions {
+	/** 对应 NormalizationMode：0 关闭 1 音轨增益 2 专辑增益 */
+	mode: number;
+	preampDb: number;
+	preventClipping: boolean;
+}
+
+export interface SkipSilenceOptions {
+	enabled: boolean;
+	/** 低于该电平视为静音 */
+	thresholdDb: number;
+	/** 静音持续超过该时长才会被缩短 */
+	minSilenceMs: number;
+	/** 缩短后保留的静音时长 */
+	keepMs: number;
+	crossfadeMs: number;
+}
+
+export interface SpectrumOptions {
+	/** FFT 长度，64-16384 的 2 的幂 */
+	fftSize: number;
+	/** 帧移（样本），决定每秒的频谱帧数 */
+	hop: number;
+	/** 20 Hz 到 20 kHz 之间的对数频带数 */
+	bands: number;
+}
+
+export interface SpectrumChunk {
+	/** frames × bands 个 dB 值（满幅正弦为 0 dB） */
+	data: Float32Array;
+	/** 每帧相对 chunk 起点的播放时长（秒） */
+	offsets: Float32Array;
+	bands: number;
+}
+
+/** 交叉淡化的增益曲线，对应 CrossfadeCurve */
+export type CrossfadeCurveName = "linear" | "equalPower" | "sCurve";
+
+export interface LiveOptions {
+	/** 抖动缓冲的目标延迟（秒），起播和断流后先缓冲到该时长 */
+	targetLatency?: number;
+	/** 积压超过该时长时丢弃最旧的数据，直接回到目标延迟 */
+	maxLatency?: number;
+}
+
+export interface StreamMetadata {
+	/** 开始生效的播放时间（秒） */
+	time: number;
+	title: string;
+	/** 原始的 ICY 元数据文本 */
+	raw: string;
 }
 
 export interface PlayerEventMap {
@@ -32,9 +132,38 @@ export interface PlayerEventMap {
 	ended: undefined;
 	error: string;
 	emptied: undefined;
+	/** 直播流的元数据（曲目标题等）在播放到对应位置时变化 */
+	streammetadata: StreamMetadata;
+	/** 播放进入 queueNext 排队的曲目，duration 和元数据已切换为新曲目 */
+	trackchange: AudioMetadata;
+}
+
+export type DistributiveOmit<T, K extends PropertyKey> = T extends unknown
+	? Omit<T, K>
+	: never;
+
+/** 解码会话的调度优先级：播放中 > 预加载 > 后台分析 */
+export type SessionPriorityName = "realtime" | "prefetch" | "background";
+
+/** 多个播放器共用一个 worker 时，端口给每个请求附加的路由信息 */
+export interface SessionRouting {
+	/** 会话槽位，独占 worker 时为 0 */
+	slot?: number | undefined;
+	/** 创建会话（INIT*）时的调度优先级，默认 realtime */
+	priority?: SessionPriorityName | undefined;
+}
+
+/** 播放器与解码 worker 通信所需的最小接口，Worker 与 SharedDecoderWorker 的端口都满足 */
+export interface DecoderWorker {
+	postMessage(message: WorkerRequest, transfer?: Transferable[]): void;
+	onmessage: ((event: MessageEvent<WorkerResponse>) => void) | null;
+	onerror?: ((event: ErrorEvent) => void) | null;
+	terminate(): void;
 }
 
-export type WorkerRequest =
+export type WorkerRequest = WorkerRequestBody & SessionRouting;
+
+type WorkerRequestBody =
 	| {
 			type: "INIT";
 			id: number;
@@ -50,6 +179,17 @@ export type WorkerRequest =
 			chunkSize: number;
 			sessionId: number;
 	  }
+	| {
+			type: "INIT_LIVE";
+			id: number;
+			sab: SharedArrayBuffer;
+			/** 响应头 icy-metaint，0 表示流中没有 ICY 元数据 */
+			icyMetaint: number;
+			targetLatency: number;
+			maxLatency: number;
+			chunkSize: number;
+			sessionId: number;
+	  }
 	| { type: "PAUSE"; id: number }
 	| { type: "RESUME"; id: number }
 	| {
@@ -57,12 +197,76 @@ export type WorkerRequest =
 			id: number;
 			seekTime: number;
 			sessionId: number;
+			/** 按章节定位时的章节序号，此时 seekTime 为该章节的开始时间 */
+			chapter?: number | undefined;
+			/** 播放 CUE 音轨时的音轨序号，此时 seekTime 为该音轨的开始时间 */
+			cueTrack?: { index: number; continuous: boolean } | undefined;
+	  }
+	| {
+			type: "LOAD_CUE";
+			id: number;
+			/** 空字符串表示使用文件内嵌的 CUESHEET 标签 */
+			text: string;
 	  }
 	| { type: "SET_TEMPO"; id: number; value: number }
 	| { type: "SET_PITCH"; id: number; value: number }
-	| { type: "EXPORT_WAV"; id: number; file: File };
+	| { type: "SET_REVERSE"; id: number; enabled: boolean }
+	| { type: "SET_VARISPEED"; id: number; enabled: boolean }
+	| {
+			type: "SET_LOOP";
+			id: number;
+			/** null 表示取消循环 */
+			region: { start: number; end: number; crossfadeMs: number } | null;
+	  }
+	| { type: "SELECT_STREAM"; id: number; streamIndex: number }
+	| { type: "QUEUE_NEXT"; id: number; file: File }
+	| {
+			type: "SET_CROSSFADE";
+			id: number;
+			/** 0 表示无缝衔接 */
+			seconds: number;
+			curve: CrossfadeCurveName;
+	  }
+	| {
+			type: "SET_EQ_BAND";
+			id: number;
+			index: number;
+			band: EqBandOptions | null;
+	  }
+	| { type: "SET_LIMITER"; id: number; options: LimiterOptions }
+	| { type: "SET_SPECTRUM"; id: number; options: SpectrumOptions | null }
+	| { type: "SET_SKIP_SILENCE"; id: number; options: SkipSilenceOptions }
+	| {
+			type: "SET_NORMALIZATION";
+			id: number;
+			options: NormalizationOptions;
+	  }
+	| { type: "SCRUB"; id: number; position: number; durationMs: number }
+	| { type: "SET_PRIORITY"; id: number; value: SessionPriorityName }
+	/** 关闭槽位上的会话（共享 worker 的端口 terminate 时发送），没有响应 */
+	| { type: "CLOSE"; id: number }
+	| {
+			type: "EXPORT_PLAN";
+			id: number;
+			file: File;
+			/** 期望的分段数，通常为并行解码的 worker 数 */
+			segments: number;
+	  }
+	| {
+			type: "EXPORT_SEGMENT";
+			id: number;
+			file: File;
+			/** 源样本区间 [start, end)，end 为 -1 表示到文件结尾 */
+			start: number;
+			end: number;
+			bitsPerSample: number;
+			isFloat: boolean;
+	  };
+
+/** 共享 worker 中的会话在响应里带上槽位，独占 worker 时省略 */
+export type WorkerResponse = WorkerResponseBody & Pick<SessionRouting, "slot">;
 
-export type WorkerResponse =
+type WorkerResponseBody =
 	| { type: "ERROR"; id: number; error: string }
 	| { type: "ACK"; id: number }
 	| {
@@ -75,6 +279,18 @@ export type WorkerResponse =
 			encoding: string;
 			coverUrl?: string | undefined;
 			bitsPerSample: number;
+			streams: AudioStreamDescription[];
+			streamIndex: number;
+			chapters: AudioChapter[];
+	  }
+	| {
+			type: "STREAM_CHANGED";
+			id: number;
+			sampleRate: number;
+			channels: number;
+			encoding: string;
+			bitsPerSample: number;
+			streamIndex: number;
 	  }
 	| {
 			type: "CHUNK";
@@ -82,8 +298,37 @@ export type WorkerResponse =
 			data: Float32Array;
 			startTime: number;
 			sessionId: number;
+			/** 第一个样本所属曲目的序号，每切换到排队的下一首加 1 */
+			trackIndex: number;
+			/** 解码器预读队列中尚未解码的压缩数据时长（秒） */
+			queuedDuration: number;
+			/** 开启频谱分析时本 chunk 的频谱帧 */
+			spectrum?: SpectrumChunk | undefined;
+			/** 直播流中新出现的元数据 */
+			streamMetadata?: StreamMetadata[] | undefined;
 	  }
+	| { type: "CUE_TRACKS"; id: number; tracks: AudioCueTrack[] }
+	| { type: "NEXT_QUEUED"; id: number; metadata: AudioMetadata }
 	| { type: "EOF"; id: number }
 	| { type: "SEEK_DONE"; id: number; time: number }
 	| { type: "SEEK_NET"; id: number; seekOffset: number }
-	| { type: "EXPORT_WAV_DONE"; id: number; blob: Blob };
+	| {
+			type: "SCRUB_PREVIEW";
+			id: number;
+			/** 被更新的预览请求取代时为 null */
+			data: Float32Array | null;
+			startTime: number;
+	  }
+	| {
+			type: "EXPORT_PLAN_DONE";
+			id: number;
+			sampleRate: number;
+			channels: number;
+			/** 能无损容纳源样本的位深：16/24/32 位整数或 32 位浮点 */
+			bitsPerSample: number;
+			isFloat: boolean;
+			channelMask: number;
+			/** 各段的分界点（源样本序号），比段数多一个 */
+			boundaries: number[];
+	  }
+	| { type: "EXPORT_SEGMENT_DONE"; id: number; blob: Blob };
@@ -20,6 +20,63 @@ export interface Uint8List extends EmbindObject {
 	get(index: number): number;
 }
 
+export interface DoubleList extends EmbindObject {
+	size(): number;
+	get(index: number): number;
+}
+
+export interface AudioStreamInfo {
+	index: number;
+	codec: string;
+	channels: number;
+	sampleRate: number;
+	language: string;
+	title: string;
+	isDefault: boolean;
+}
+
+export interface AudioStreamList extends EmbindObject {
+	size(): number;
+	get(index: number): AudioStreamInfo;
+}
+
+export interface ChapterInfo {
+	start: number;
+	end: number;
+	title: string;
+}
+
+export interface ChapterList extends EmbindObject {
+	size(): number;
+	get(index: number): ChapterInfo;
+}
+
+export interface CueTrack {
+	number: number;
+	start: number;
+	end: number;
+	title: string;
+	performer: string;
+}
+
+export interface CueTrackList extends EmbindObject {
+	size(): number;
+	get(index: number): CueTrack;
+}
+
+export interface StreamMetadataEvent {
+	/** 开始生效的源时间（秒） */
+	time: number;
+	/** ICY StreamTitle，没有时为空字符串 */
+	title: string;
+	raw: string;
+}
+
+export interface StreamMetadataList extends EmbindObject {
+	size(): number;
+	get(index: number): StreamMetadataEvent;
+}
+
 export interface DecoderStatus {
 	status: number;
 	error: string;
@@ -34,31 +91,298 @@ export interface AudioProperties {
 	metadata: StringMap;
 	coverArt: Uint8List;
 	bitsPerSample: number;
+	streams: AudioStreamList;
+	streamIndex: number;
+	/** 容器自带的章节，打开文件时即可得到 */
+	chapters: ChapterList;
 }
 
 export enum SampleFormat {
 	PlanarF32 = 0,
 	InterleavedS16 = 1,
+	InterleavedS32 = 2,
+	/** 小端 packed 3 字节，samples 为 Uint8Array */
+	InterleavedS24 = 3,
+	/** 交错 float，不限幅 */
+	InterleavedF32 = 4,
+}
+
+export enum NormalizationMode {
+	Off = 0,
+	Track = 1,
+	Album = 2,
+}
+
+export enum EqFilterType {
+	Peaking = 0,
+	LowShelf = 1,
+	HighShelf = 2,
+	LowPass = 3,
+	HighPass = 4,
+}
+
+export interface SpectrumFrames {
+	/** frames × bands 个 dB 值，按帧排列，指向 WASM 堆 */
+	data: Float32Array;
+	/** 每帧分析窗末尾相对 chunk 起点的输出时长（秒） */
+	offsets: Float32Array;
+	frames: number;
+	bands: number;
+}
+
+export interface DspStats {
+	lastChunkMs: number;
+	averageChunkMs: number;
+	chunks: number;
+	/** 限制器前瞻引入的输出延迟（帧） */
+	latencyFrames: number;
 }
 
 export interface ChunkResult {
 	status: DecoderStatus;
-	samples: Float32Array | Int16Array;
+	samples: Float32Array | Int16Array | Int32Array | Uint8Array;
 	isEOF: boolean;
 	startTime: number;
 }
 
+export enum CrossfadeCurve {
+	Linear = 0,
+	EqualPower = 1,
+	SCurve = 2,
+}
+
+export interface MixChunkResult {
+	status: DecoderStatus;
+	samples: Float32Array;
+	isEOF: boolean;
+	startTime: number;
+	/** 第一个样本所属曲目的序号 */
+	trackIndex: number;
+	/** 本 chunk 中开始过渡的帧，-1 表示没有 */
+	transitionFrame: number;
+	sampleRate: number;
+	channels: number;
+}
+
+export interface PacketQueueStatus {
+	packets: number;
+	bytes: number;
+	/** 队列中压缩包的总时长（秒） */
+	duration: number;
+	isFull: boolean;
+	demuxEOF: boolean;
+}
+
+export interface IOCacheStats {
+	hits: number;
+	misses: number;
+	hitBytes: number;
+	missBytes: number;
+	/** 实际发给宿主的网络 seek 次数 */
+	netSeeks: number;
+	cachedBytes: number;
+}
+
+export interface PcmCacheStats {
+	seekHits: number;
+	seekMisses: number;
+	/** 缓存读完后重新定位解码器的次数 */
+	resyncs: number;
+	cachedBytes: number;
+}
+
 export interface AudioStreamDecoder extends EmbindObject {
 	init(path: string): AudioProperties;
 	initStream(
 		readCallback: (ptr: number, size: number) => number,
 		seekCallback: (offset: number, whence: number) => number,
 	): AudioProperties;
+	/**
+	 * 打开直播流：不可 seek、duration 为 0。icyMetaint 为响应头 icy-metaint，
+	 * 非 0 时从字节流中剥离 ICY 元数据
+	 */
+	initLive(
+		readCallback: (ptr: number, size: number) => number,
+		icyMetaint: number,
+	): AudioProperties;
+	/** 直播流抖动缓冲的目标延迟与最大延迟（秒） */
+	setLiveLatency(targetSeconds: number, maxSeconds: number): void;
+	/** 取出新确定了播放时间的直播元数据 */
+	takeStreamMetadata(): StreamMetadataList;
 	readChunk(chunkSize: number, format?: SampleFormat): ChunkResult;
+	/**
+	 * 离线任务的分段计划：按关键帧切成最多 count 段，返回 count + 1 个分界点
+	 * （源样本序号），最后一个为 -1 表示文件结尾。不能可靠分段的格式（HE-AAC、Opus、
+	 * 裸流等）只有一段
+	 */
+	segmentBoundaries(count: number): DoubleList;
+	/** 能无损容纳源样本的交错格式：整数源按有效位数取 S16/S24/S32，浮点源取 F32 */
+	nativeSampleFormat(): SampleFormat;
+	/** WAVE_FORMAT_EXTENSIBLE 的声道位掩码，未知布局为 0 */
+	channelMask(): number;
+	/**
+	 * 开始解码源样本区间 [start, end)，只输出交错格式，不经过变速和音效。
+	 * 各段在独立的解码器上解码后按顺序拼接，与从 0 顺序解码逐样本一致。
+	 * seek 越过分段起点时自动加长预滚，最坏退回从文件开头解码
+	 */
+	beginSegment(start: number, end: number, format: SampleFormat): DecoderStatus;
+	/** 读取当前分段的下一批样本，分段结束时 isEOF */
+	readSegment(maxFrames: number): ChunkResult;
 	seek(timestamp: number): DecoderStatus;
+	/** 跳到第 index 个章节，第一个 chunk 的 startTime 精确等于章节开始时间 */
+	seekChapter(index: number): DecoderStatus;
+	/** 加载 CUE 表，text 为空字符串时使用文件内嵌的 CUESHEET 标签 */
+	loadCueSheet(text: string): CueTrackList;
+	/**
+	 * 从 CUE 音轨的 INDEX 01 精确开始播放。continuous 为 false 时在下一轨起点 isEOF，
+	 * 否则无缝播放后续音轨
+	 */
+	playCueTrack(index: number, continuous: boolean): DecoderStatus;
+	/**
+	 * 拖动预览：定位到最近的关键帧，解码 frames 帧直接返回 PlanarF32（不经过 SoundTouch）。
+	 * 会打断正常解码的位置，继续 readChunk 前需要 seek
+	 */
+	scrubPreview(position: number, frames: number): ChunkResult;
+	/**
+	 * 从 PCM 缓存取 position 开始的预览（PlanarF32），不影响解码位置，可在播放中调用。
+	 * 缓存未命中时 samples 为空
+	 */
+	cachedPreview(position: number, frames: number): ChunkResult;
+	/** 当前音频流的采样率，未打开时为 0 */
+	sampleRate(): number;
+	/** 在当前位置切换音频流，index 为容器内的流序号 */
+	selectStream(index: number): AudioProperties;
 	close(): void;
 	setTempo(tempo: number): void;
 	setPitch(pitch: number): void;
+	/**
+	 * varispeed：只重采样，音调随 setTempo 的速度变化，开销远低于 SoundTouch 变速；
+	 * 该模式下 setPitch 不生效。切换时从当前位置重新定位，模式内的速度变化平滑过渡
+	 */
+	setVarispeed(enabled: boolean): DecoderStatus;
+	isVarispeed(): boolean;
+	/** 从当前位置开始倒放（或恢复正向），倒放时 startTime 递减 */
+	setReverse(enabled: boolean): DecoderStatus;
+	/** 供 C ABI 热路径使用的对象地址 */
+	nativeHandle(): number;
+	/**
+	 * A-B 循环：区间解码一次常驻内存，回绕处 crossfadeMs 交叉淡化。
+	 * 调用后需要 seek 到当前位置
+	 */
+	setLoop(start: number, end: number, crossfadeMs: number): DecoderStatus;
+	/** 取消循环，从区间内的当前位置无缝继续 */
+	clearLoop(): void;
+	/** 变速/变调参数生效前仍按旧参数输出的时长（秒） */
+	getStretchLatency(): number;
+	/** 流模式字节块缓存，maxBytes 小于 blockSize 时关闭 */
+	setIOCache(blockSize: number, maxBytes: number): void;
+	getIOCacheStats(): IOCacheStats;
+	/** 已解码 PCM 缓存，落在缓存内的 seek 不重新解码；maxBytes 过小时关闭 */
+	setPcmCache(maxBytes: number): void;
+	getPcmCacheStats(): PcmCacheStats;
+	setSkipSilence(
+		enabled: boolean,
+		thresholdDb: number,
+		minSilenceMs: number,
+		keepMs: number,
+		crossfadeMs: number,
+	): void;
+	/** 跳过静音累计省掉的源时长（秒） */
+	getSkippedDuration(): number;
+	setNormalization(
+		mode: NormalizationMode,
+		preampDb: number,
+		preventClipping: boolean,
+	): void;
+	setEqBand(
+		index: number,
+		type: EqFilterType,
+		freq: number,
+		gainDb: number,
+		q: number,
+	): boolean;
+	disableEqBand(index: number): void;
+	clearEq(): void;
+	setLimiter(
+		enabled: boolean,
+		thresholdDb: number,
+		lookaheadMs: number,
+		releaseMs: number,
+	): void;
+	getDspStats(): DspStats;
+	/**
+	 * 解码端频谱分析：fftSize 为 64-16384 的 2 的幂（0 关闭），hop 为帧移（样本），
+	 * bands 为对数频带数（1-256）。参数无效时返回 false
+	 */
+	setSpectrum(fftSize: number, hop: number, bands: number): boolean;
+	/** 最近一次 readChunk 产生的频谱帧 */
+	getSpectrum(): SpectrumFrames;
+	setPacketQueueLimits(maxBytes: number, maxSeconds: number): void;
+	fillPacketQueue(maxPackets: number): DecoderStatus;
+	getPacketQueueStatus(): PacketQueueStatus;
+	delete(): void;
+}
+
+export enum SessionPriority {
+	Realtime = 0,
+	Prefetch = 1,
+	Background = 2,
+}
+
+/**
+ * 在同一个模块实例里驱动多个解码会话：Realtime 先于 Prefetch 先于 Background，
+ * 同一优先级内轮转。每个会话是一个 CrossfadeMixer，每步由 _scheduler_step 执行
+ */
+export interface DecoderScheduler extends EmbindObject {
+	create(
+		priority: SessionPriority,
+		chunkSize: number,
+		format: SampleFormat,
+	): number;
+	/** 销毁会话及其解码器 */
+	remove(id: number): void;
+	/** 会话的混音器，由调度器持有，不要 delete */
+	mixer(id: number): CrossfadeMixer | null;
+	setPriority(id: number, priority: SessionPriority): void;
+	/** EOF、出错或直播流缺数据时调度器自动停用会话 */
+	setActive(id: number, active: boolean): void;
+	hasActiveSessions(): boolean;
+	nativeHandle(): number;
+}
+
+/**
+ * 双解码器交叉淡化混音器。没有排队的下一首时直通当前解码器；
+ * 淡化只用于 PlanarF32，其他格式在曲目边界无缝硬切换
+ */
+export interface CrossfadeMixer extends EmbindObject {
+	open(path: string): AudioProperties;
+	openStream(
+		readCallback: (ptr: number, size: number) => number,
+		seekCallback: (offset: number, whence: number) => number,
+	): AudioProperties;
+	/** 在空闲解码器中打开下一首，过渡开始前可替换 */
+	queueNext(path: string): AudioProperties;
+	queueNextStream(
+		readCallback: (ptr: number, size: number) => number,
+		seekCallback: (offset: number, whence: number) => number,
+	): AudioProperties;
+	setCrossfade(seconds: number, curve: CrossfadeCurve): void;
+	readChunk(chunkSize: number): MixChunkResult;
+	hasNext(): boolean;
+	/** 正在输出的曲目，由混音器持有，不要 delete；切换曲目后与 queued 互换 */
+	current(): AudioStreamDecoder;
+	/** 排队的下一首（没有时为未打开的解码器） */
+	queued(): AudioStreamDecoder;
+	/** 放弃进行中的过渡，丢弃已缓冲的样本 */
+	flush(): void;
+	/** flush 并把当前解码器定位回第一个未输出的样本 */
+	rewind(): DecoderStatus;
+	seek(timestamp: number): DecoderStatus;
+	setTempo(tempo: number): void;
+	setPitch(pitch: number): void;
+	close(): void;
+	/** 供 C ABI 热路径使用的对象地址 */
+	nativeHandle(): number;
 	delete(): void;
 }
 
@@ -71,5 +395,35 @@ export interface AudioDecoderModule extends EmscriptenModule {
 	AudioStreamDecoder: {
 		new (): AudioStreamDecoder;
 	};
+	CrossfadeMixer: {
+		new (): CrossfadeMixer;
+	};
+	DecoderScheduler: {
+		new (): DecoderScheduler;
+	};
 	SampleFormat: typeof SampleFormat;
+	SessionPriority: typeof SessionPriority;
+	CrossfadeCurve: typeof CrossfadeCurve;
+	EqFilterType: typeof EqFilterType;
+	NormalizationMode: typeof NormalizationMode;
+	/** 是否为 -msimd128 构建 */
+	isSimdBuild(): boolean;
+	/** readChunk 的 C ABI 版本，返回样本指针，结果头见 _decoder_chunk_header */
+	_decoder_read_chunk(
+		handle: number,
+		chunkSize: number,
+		format: number,
+	): number;
+	/** 解码器结果头 ChunkHeader 的地址，在解码器生命周期内不变 */
+	_decoder_chunk_header(handle: number): number;
+	/** 混音器的 readChunk C ABI，结果头见 _mixer_chunk_header */
+	_mixer_read_chunk(handle: number, chunkSize: number, format: number): number;
+	/** 混音器结果头 MixChunkHeader（ChunkHeader 之后是曲目序号等）的地址 */
+	_mixer_chunk_header(handle: number): number;
+	/**
+	 * 调度器执行一步，返回 int32 数组的地址：
+	 * [就绪数, 缺数据数, 就绪的会话 id..., 缺数据的会话 id...]。
+	 * 就绪会话的结果在各自的 ChunkHeader 中；缺数据的直播会话已被停用，需稍后重新激活
+	 */
+	_scheduler_step(handle: number, budgetMs: number): number;
 }
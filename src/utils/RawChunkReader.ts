@@ -0,0 +1,151 @@
+import type {
+	AudioDecoderModule,
+	AudioStreamDecoder,
+	CrossfadeMixer,
+	SampleFormat,
+} from "@/types";
+
+// ChunkHeader 的字节偏移，与 audio-decode.cpp 保持一致
+const OFF_STATUS = 0;
+const OFF_FRAMES = 4;
+const OFF_CHANNELS = 8;
+const OFF_IS_EOF = 12;
+const OFF_START_TIME = 16;
+const OFF_QUEUED_DURATION = 24;
+const OFF_ERROR = 32;
+const OFF_DATA = 36;
+// MixChunkHeader 在 ChunkHeader 之后的字段
+const OFF_TRACK_INDEX = 40;
+const OFF_TRANSITION_FRAME = 44;
+const OFF_MIXED = 48;
+
+// Embind 枚举在运行时是 { value } 对象，C ABI 需要的是整数
+function enumValue(format: SampleFormat): number {
+	return typeof format === "number"
+		? format
+		: (format as unknown as { value: number }).value;
+}
+
+export interface RawChunk {
+	status: number;
+	/** status < 0 时的错误信息 */
+	error: string;
+	frames: number;
+	channels: number;
+	isEOF: boolean;
+	startTime: number;
+	/** 解码器预读队列中尚未解码的压缩数据时长（秒） */
+	queuedDuration: number;
+	/** 直接指向 WASM 堆，下次 read 之前有效；没有样本时为 null */
+	samples: Float32Array | Int16Array | Int32Array | Uint8Array | null;
+}
+
+export interface RawMixInfo {
+	/** 第一个样本所属曲目的序号，每切换一次加 1 */
+	trackIndex: number;
+	/** 本 chunk 中下一首开始淡入的帧，-1 表示没有 */
+	transitionFrame: number;
+	/** 样本经过混音器缓冲，解码器的频谱等逐 chunk 数据与之不对齐 */
+	mixed: boolean;
+}
+
+/**
+ * readChunk 的低开销版本：通过 decoder_read_chunk C ABI 每个 chunk 只调用一次 wasm，
+ * 结果头按固定偏移从线性内存读取，不构造 Embind 的 ChunkResult / Status / memory_view。
+ * 小 chunk（低延迟）时绑定开销在每次调用中占比明显，解码循环应使用它。
+ * 也可以读取 CrossfadeMixer，此时 peekMix 给出曲目切换信息。
+ */
+export class RawChunkReader {
+	private readonly handle: number;
+	private readonly headerPtr: number;
+	private readonly isMixer: boolean;
+	private view: DataView | null = null;
+	private readonly textDecoder = new TextDecoder();
+
+	constructor(
+		private module: AudioDecoderModule,
+		source: AudioStreamDecoder | CrossfadeMixer,
+	) {
+		this.handle = source.nativeHandle();
+		this.isMixer = source instanceof module.CrossfadeMixer;
+		this.headerPtr = this.isMixer
+			? module._mixer_chunk_header(this.handle)
+			: module._decoder_chunk_header(this.handle);
+	}
+
+	public read(chunkSize: number, format: SampleFormat): RawChunk {
+		const readChunk = this.isMixer
+			? this.module._mixer_read_chunk
+			: this.module._decoder_read_chunk;
+		readChunk(this.handle, chunkSize, enumValue(format));
+		return this.peek(format);
+	}
+
+	/** 读取最近一次解码的结果（例如由 DecoderScheduler 解码），不再调用解码 */
+	public peek(format: SampleFormat): RawChunk {
+		const heap = this.module.HEAPU8;
+		const view = this.heapView();
+		const base = this.headerPtr;
+
+		const status = view.getInt32(base + OFF_STATUS, true);
+		const dataPtr = view.getUint32(base + OFF_DATA, true);
+		const frames = view.getInt32(base + OFF_FRAMES, true);
+		const channels = view.getInt32(base + OFF_CHANNELS, true);
+		const count = frames * channels;
+
+		let samples: RawChunk["samples"] = null;
+		if (dataPtr !== 0 && count > 0) {
+			if (format === this.module.SampleFormat.InterleavedS16) {
+				samples = new Int16Array(heap.buffer, dataPtr, count);
+			} else if (format === this.module.SampleFormat.InterleavedS32) {
+				samples = new Int32Array(heap.buffer, dataPtr, count);
+			} else if (format === this.module.SampleFormat.InterleavedS24) {
+				samples = new Uint8Array(heap.buffer, dataPtr, count * 3);
+			} else {
+				samples = new Float32Array(heap.buffer, dataPtr, count);
+			}
+		}
+
+		return {
+			status,
+			error: status < 0 ? this.readError(view, base) : "",
+			frames,
+			channels,
+			isEOF: view.getInt32(base + OFF_IS_EOF, true) !== 0,
+			startTime: view.getFloat64(base + OFF_START_TIME, true),
+			queuedDuration: view.getFloat64(base + OFF_QUEUED_DURATION, true),
+			samples,
+		};
+	}
+
+	/** 最近一次混音器 chunk 的曲目信息，只对 CrossfadeMixer 有效 */
+	public peekMix(): RawMixInfo {
+		if (!this.isMixer) {
+			return { trackIndex: 0, transitionFrame: -1, mixed: false };
+		}
+		const view = this.heapView();
+		const base = this.headerPtr;
+		return {
+			trackIndex: view.getInt32(base + OFF_TRACK_INDEX, true),
+			transitionFrame: view.getInt32(base + OFF_TRANSITION_FRAME, true),
+			mixed: view.getInt32(base + OFF_MIXED, true) !== 0,
+		};
+	}
+
+	// 内存增长后旧的 buffer 会失效
+	private heapView() {
+		const buffer = this.module.HEAPU8.buffer;
+		if (this.view?.buffer !== buffer) {
+			this.view = new DataView(buffer);
+		}
+		return this.view;
+	}
+
+	private readError(view: DataView, base: number) {
+		const ptr = view.getUint32(base + OFF_ERROR, true);
+		if (ptr === 0) return "";
+		const heap = this.module.HEAPU8;
+		const end = heap.indexOf(0, ptr);
+		return this.textDecoder.decode(heap.subarray(ptr, end < 0 ? ptr : end));
+	}
+}
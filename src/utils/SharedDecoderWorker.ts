@@ -0,0 +1,86 @@
+import type {
+	DecoderWorker,
+	SessionPriorityName,
+	WorkerRequest,
+	WorkerResponse,
+} from "../types";
+
+/**
+ * 让多个播放器（拖动预览、下一首预加载、后台分析等）共用一个解码 worker。
+ * worker 内的 DecoderScheduler 在同一个 wasm 实例里按优先级轮转解码所有会话，
+ * N 个会话只需一份模块和堆。connect() 返回的端口可直接作为播放器 workerFactory 的结果：
+ *
+ *   const shared = new SharedDecoderWorker(() => new AudioWorker());
+ *   const player = new FFmpegAudioPlayer(() => shared.connect());
+ *   const next = new FFmpegAudioPlayer(() => shared.connect("prefetch"));
+ *
+ * 所有会话共用一个线程，流式会话在网络数据不足时的阻塞读会拖住其他会话
+ */
+export class SharedDecoderWorker {
+	private readonly worker: Worker;
+	private ports = new Map<number, SharedDecoderPort>();
+	// 槽位 0 留给独占 worker
+	private nextSlot = 1;
+
+	constructor(workerFactory: () => Worker) {
+		this.worker = workerFactory();
+		this.worker.onmessage = (event: MessageEvent<WorkerResponse>) => {
+			this.ports.get(event.data.slot ?? 0)?.onmessage?.(event);
+		};
+		this.worker.onerror = (event) => {
+			for (const port of this.ports.values()) {
+				port.onerror?.(event);
+			}
+		};
+	}
+
+	/** 分配一个会话槽位，priority 为端口上会话的调度优先级 */
+	public connect(priority: SessionPriorityName = "realtime") {
+		const slot = this.nextSlot++;
+		const port = new SharedDecoderPort(this.worker, slot, priority, () =>
+			this.ports.delete(slot),
+		);
+		this.ports.set(slot, port);
+		return port;
+	}
+
+	public terminate() {
+		this.worker.terminate();
+		this.ports.clear();
+	}
+}
+
+/** 共享 worker 上的一个会话槽位，请求都带上槽位和优先级，只收到本槽位的响应 */
+export class SharedDecoderPort implements DecoderWorker {
+	public onmessage: ((event: MessageEvent<WorkerResponse>) => void) | null =
+		null;
+	public onerror: ((event: ErrorEvent) => void) | null = null;
+	private closed = false;
+
+	constructor(
+		private worker: Worker,
+		public readonly slot: number,
+		private priority: SessionPriorityName,
+		private onClose: () => void,
+	) {}
+
+	public postMessage(message: WorkerRequest, transfer: Transferable[] = []) {
+		if (this.closed) return;
+		// 记住调整后的优先级，重新加载时新会话沿用
+		if (message.type === "SET_PRIORITY") this.priority = message.value;
+		this.worker.postMessage(
+			{ ...message, slot: this.slot, priority: this.priority },
+			transfer,
+		);
+	}
+
+	/** 只关闭本槽位的会话，共享的 worker 继续运行 */
+	public terminate() {
+		if (this.closed) return;
+		this.closed = true;
+		this.worker.postMessage({ type: "CLOSE", id: 0, slot: this.slot });
+		this.onmessage = null;
+		this.onerror = null;
+		this.onClose();
+	}
+}
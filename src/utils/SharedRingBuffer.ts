@@ -102,14 +102,35 @@ export class SharedRingBuffer {
 		Atomics.store(this.header, IDX_NOTIFY_COUNT, 0);
 	}
 
+	/**
+	 * 当前可以无阻塞读取的字节数
+	 */
+	availableBytes(): number {
+		const writePos = Atomics.load(this.header, IDX_WRITE);
+		const readPos = Atomics.load(this.header, IDX_READ);
+		return writePos >= readPos
+			? writePos - readPos
+			: this.capacity - readPos + writePos;
+	}
+
+	isEOF(): boolean {
+		return Atomics.load(this.header, IDX_EOF) === 1;
+	}
+
 	/**
 	 * 阻塞式读取，直接写入 WASM 内存
 	 * @param wasmHeapU8 WASM 的 HEAPU8 视图
 	 * @param destPtr WASM 内存目标地址
 	 * @param size 请求读取的字节数
+	 * @param partial 为 true 时读到任意数据即返回，只在缓冲区为空时阻塞（直播流）
 	 * @returns 实际读取的字节数 (0 表示 EOF)
 	 */
-	blockingRead(wasmHeapU8: Uint8Array, destPtr: number, size: number): number {
+	blockingRead(
+		wasmHeapU8: Uint8Array,
+		destPtr: number,
+		size: number,
+		partial = false,
+	): number {
 		if (size === 0) return 0;
 
 		let totalRead = 0;
@@ -121,7 +142,7 @@ export class SharedRingBuffer {
 			const isEOF = Atomics.load(this.header, IDX_EOF);
 
 			if (readPos === writePos) {
-				if (isEOF) {
+				if (isEOF || (partial && totalRead > 0)) {
 					return totalRead;
 				}
 
@@ -0,0 +1,109 @@
+import type {
+	DecoderWorker,
+	DistributiveOmit,
+	WorkerRequest,
+	WorkerResponse,
+} from "../types";
+
+type ResponseOf<T extends WorkerResponse["type"]> = Extract<
+	WorkerResponse,
+	{ type: T }
+>;
+
+interface PoolWorker {
+	worker: DecoderWorker;
+	pending: Map<number, (resp: WorkerResponse) => void>;
+}
+
+/**
+ * 离线任务（导出等）用的 worker 池。wasm 构建不含线程，每个 worker 加载独立的
+ * wasm 实例和解码器，并行度来自 worker 数。worker 在第一次使用时才创建
+ */
+export class WorkerPool {
+	private workers: PoolWorker[] = [];
+	private msgIdCounter = 0;
+
+	constructor(
+		private workerFactory: () => DecoderWorker,
+		public readonly size: number,
+	) {}
+
+	/** 向第 index 个 worker 发送请求，等待类型为 expect 的响应，ERROR 时 reject */
+	public request<T extends WorkerResponse["type"]>(
+		index: number,
+		msg: DistributiveOmit<WorkerRequest, "id">,
+		expect: T,
+	): Promise<ResponseOf<T>> {
+		const entry = this.getWorker(index);
+		const id = ++this.msgIdCounter;
+
+		return new Promise<ResponseOf<T>>((resolve, reject) => {
+			entry.pending.set(id, (resp) => {
+				if (resp.type === "ERROR") {
+					reject(new Error(resp.error));
+				} else if (resp.type === expect) {
+					resolve(resp as ResponseOf<T>);
+				} else {
+					reject(new Error(`Unexpected worker response: ${resp.type}`));
+				}
+			});
+			entry.worker.postMessage({ ...msg, id } as WorkerRequest);
+		});
+	}
+
+	/** 每个 worker 依次领取下一个任务，结果按任务顺序返回 */
+	public async map<T, R>(
+		tasks: T[],
+		run: (task: T, worker: number) => Promise<R>,
+	): Promise<R[]> {
+		const results = new Array<R>(tasks.length);
+		let next = 0;
+
+		const lane = async (worker: number) => {
+			while (next < tasks.length) {
+				const i = next++;
+				results[i] = await run(tasks[i] as T, worker);
+			}
+		};
+
+		const lanes = Math.min(this.size, tasks.length);
+		await Promise.all(Array.from({ length: lanes }, (_, w) => lane(w)));
+		return results;
+	}
+
+	public terminate() {
+		for (const entry of this.workers) {
+			entry.worker.terminate();
+			this.failPending(entry, "Worker pool terminated");
+		}
+		this.workers = [];
+	}
+
+	private getWorker(index: number) {
+		let entry = this.workers[index];
+		if (!entry) {
+			const worker = this.workerFactory();
+			const created: PoolWorker = { worker, pending: new Map() };
+			worker.onmessage = (event: MessageEvent<WorkerResponse>) => {
+				const handler = created.pending.get(event.data.id);
+				if (handler) {
+					created.pending.delete(event.data.id);
+					handler(event.data);
+				}
+			};
+			worker.onerror = (event) => {
+				this.failPending(created, event.message || "Worker error");
+			};
+			this.workers[index] = created;
+			entry = created;
+		}
+		return entry;
+	}
+
+	private failPending(entry: PoolWorker, error: string) {
+		for (const [id, handler] of entry.pending) {
+			handler({ type: "ERROR", id, error });
+		}
+		entry.pending.clear();
+	}
+}
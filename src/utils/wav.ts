@@ -0,0 +1,89 @@
+export interface WavFormatOptions {
+	/** 32 位 IEEE 浮点样本 */
+	isFloat?: boolean;
+	/** 声道位掩码（dwChannelMask），0 表示不指定扬声器位置 */
+	channelMask?: number;
+}
+
+const WAVE_FORMAT_PCM = 1;
+const WAVE_FORMAT_IEEE_FLOAT = 3;
+const WAVE_FORMAT_EXTENSIBLE = 0xfffe;
+// KSDATAFORMAT_SUBTYPE_* 的 GUID 除前 4 字节（格式代码）外的部分
+const SUBFORMAT_GUID_TAIL = [
+	0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71,
+];
+
+/**
+ * 16 位以内、不超过双声道的整数 PCM 写经典的 44 字节头；24/32 位、浮点或多声道写
+ * WAVE_FORMAT_EXTENSIBLE 头，浮点时附带 fact 块
+ */
+export function createWavHeader(
+	sampleRate: number,
+	channels: number,
+	dataLength: number,
+	bitsPerSample = 16,
+	{ isFloat = false, channelMask = 0 }: WavFormatOptions = {},
+): Uint8Array {
+	const extensible = isFloat || bitsPerSample > 16 || channels > 2;
+	const fmtSize = extensible ? 40 : 16;
+	const factSize = isFloat ? 12 : 0;
+	const headerSize = 12 + 8 + fmtSize + factSize + 8;
+	const blockAlign = channels * (bitsPerSample / 8);
+	const buffer = new ArrayBuffer(headerSize);
+	const view = new DataView(buffer);
+
+	// RIFF chunk descriptor
+	writeString(view, 0, "RIFF");
+	view.setUint32(4, headerSize - 8 + dataLength, true); // File size - 8
+	writeString(view, 8, "WAVE");
+
+	// fmt sub-chunk
+	writeString(view, 12, "fmt ");
+	view.setUint32(16, fmtSize, true);
+	view.setUint16(
+		20,
+		extensible ? WAVE_FORMAT_EXTENSIBLE : WAVE_FORMAT_PCM,
+		true,
+	);
+	view.setUint16(22, channels, true);
+	view.setUint32(24, sampleRate, true);
+	view.setUint32(28, sampleRate * blockAlign, true); // ByteRate
+	view.setUint16(32, blockAlign, true);
+	view.setUint16(34, bitsPerSample, true); // 容器位深
+
+	let offset = 36;
+	if (extensible) {
+		view.setUint16(36, 22, true); // cbSize
+		view.setUint16(38, bitsPerSample, true); // 有效位深
+		view.setUint32(40, channelMask >>> 0, true);
+		view.setUint32(
+			44,
+			isFloat ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM,
+			true,
+		);
+		for (let i = 0; i < SUBFORMAT_GUID_TAIL.length; i++) {
+			view.setUint8(48 + i, SUBFORMAT_GUID_TAIL[i] ?? 0);
+		}
+		offset = 60;
+	}
+
+	// 非 PCM 格式需要 fact 块记录总帧数
+	if (isFloat) {
+		writeString(view, offset, "fact");
+		view.setUint32(offset + 4, 4, true);
+		view.setUint32(offset + 8, Math.floor(dataLength / blockAlign), true);
+		offset += 12;
+	}
+
+	// data sub-chunk
+	writeString(view, offset, "data");
+	view.setUint32(offset + 4, dataLength, true);
+
+	return new Uint8Array(buffer);
+}
+
+function writeString(view: DataView, offset: number, string: string) {
+	for (let i = 0; i < string.length; i++) {
+		view.setUint8(offset + i, string.charCodeAt(i));
+	}
+}
@@ -1,80 +1,285 @@
 import type {
+	AudioChapter,
+	AudioCueTrack,
 	AudioDecoderModule,
+	AudioMetadata,
 	AudioProperties,
 	AudioStreamDecoder,
+	AudioStreamDescription,
+	AudioStreamList,
+	ChapterList,
+	CrossfadeCurveName,
+	CrossfadeMixer,
+	DecoderScheduler,
+	DecoderStatus,
+	EqBandOptions,
+	LimiterOptions,
+	NormalizationOptions,
+	SampleFormat,
+	SessionPriorityName,
+	SkipSilenceOptions,
+	SpectrumChunk,
+	SpectrumOptions,
+	StreamMetadata,
 	WorkerRequest,
 	WorkerResponse,
 } from "@/types";
 import { toError } from "@/utils/errorUtils.js";
+import { RawChunkReader } from "@/utils/RawChunkReader.js";
 import { SharedRingBuffer } from "@/utils/SharedRingBuffer.js";
-import createAudioDecoderCore from "../assets/ffmpeg.js";
 
 const IDX_SEEK_GEN = 4; // Header(16 bytes) + 4 bytes offset
 
+// 环形缓冲区中至少有这么多字节时才预读，保证 av_read_frame 不会阻塞在网络读取上
+const PREFETCH_MIN_BYTES = 64 * 1024;
+// 每个调度步骤中每个会话最多预读的包数
+const PREFETCH_MAX_PACKETS = 64;
+// 直播流按实时速率到达，预读门槛低得多
+const LIVE_PREFETCH_MIN_BYTES = 4 * 1024;
+// 直播流抖动缓冲尚未攒够时的重试间隔，以及暂停期间继续读取网络数据的间隔
+const LIVE_POLL_MS = 20;
+const LIVE_DRAIN_MS = 100;
+// 每个调度步骤的解码时间预算，用完后让出事件循环处理消息
+const SCHEDULER_BUDGET_MS = 8;
+// 已解码 PCM 缓存上限，44.1 kHz 立体声约 90 秒，往回 seek 时不必重新解码
+const PCM_CACHE_BYTES = 32 * 1024 * 1024;
+
+// 只含一条 SIMD 指令（i8x16.splat + i8x16.popcnt）的最小模块，能通过校验即支持 WASM SIMD
+const SIMD_PROBE = new Uint8Array([
+	0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10, 10, 1, 8,
+	0, 65, 0, 253, 15, 253, 98, 11,
+]);
+
+function supportsSimd() {
+	try {
+		return WebAssembly.validate(SIMD_PROBE);
+	} catch {
+		return false;
+	}
+}
+
 let ffmpegModulePromise: Promise<AudioDecoderModule> | null = null;
 
 function getModule(): Promise<AudioDecoderModule> {
 	if (!ffmpegModulePromise) {
-		ffmpegModulePromise = createAudioDecoderCore({
-			locateFile: (path: string) =>
-				path.endsWith(".wasm") ? "/ffmpeg.wasm" : path,
-			print: (text: string) => console.log("[WASM]", text),
-			printErr: (text: string) => console.error("[WASM Error]", text),
-		}) as Promise<AudioDecoderModule>;
+		ffmpegModulePromise = loadModule();
 	}
 	return ffmpegModulePromise;
 }
 
+// 支持 WASM SIMD 时加载 -msimd128 构建，否则回退到标量版本
+async function loadModule(): Promise<AudioDecoderModule> {
+	const simd = supportsSimd();
+	const { default: createAudioDecoderCore } = simd
+		? await import("../assets/ffmpeg-simd.js")
+		: await import("../assets/ffmpeg.js");
+	const wasmFile = simd ? "/ffmpeg-simd.wasm" : "/ffmpeg.wasm";
+
+	return (await createAudioDecoderCore({
+		locateFile: (path: string) => (path.endsWith(".wasm") ? wasmFile : path),
+		print: (text: string) => console.log("[WASM]", text),
+		printErr: (text: string) => console.error("[WASM Error]", text),
+	})) as AudioDecoderModule;
+}
+
+// 所有会话的解码器都由同一个调度器持有，共用一个模块实例和 wasm 堆
+let scheduler: {
+	module: AudioDecoderModule;
+	instance: DecoderScheduler;
+} | null = null;
+// 调度器会话 id -> 会话
+const scheduled = new Map<number, DecoderSession>();
+let pumpPending = false;
+
+function getScheduler(module: AudioDecoderModule): DecoderScheduler {
+	scheduler ??= { module, instance: new module.DecoderScheduler() };
+	return scheduler.instance;
+}
+
+function toSessionPriority(
+	module: AudioDecoderModule,
+	name: SessionPriorityName | undefined,
+) {
+	const { SessionPriority } = module;
+	if (name === "prefetch") return SessionPriority.Prefetch;
+	if (name === "background") return SessionPriority.Background;
+	return SessionPriority.Realtime;
+}
+
+function toCrossfadeCurve(
+	module: AudioDecoderModule,
+	name: CrossfadeCurveName,
+) {
+	const { CrossfadeCurve } = module;
+	if (name === "linear") return CrossfadeCurve.Linear;
+	if (name === "sCurve") return CrossfadeCurve.SCurve;
+	return CrossfadeCurve.EqualPower;
+}
+
+function schedulePump() {
+	if (pumpPending) return;
+	pumpPending = true;
+	setTimeout(pump, 0);
+}
+
+/** 执行一个调度步骤并把各会话解码出的 chunk 发出，还有活动会话时让出事件循环后继续 */
+function pump() {
+	pumpPending = false;
+	if (!scheduler) return;
+	const { module, instance } = scheduler;
+
+	for (const session of scheduled.values()) {
+		session.prefetch();
+	}
+
+	const ptr = module._scheduler_step(
+		instance.nativeHandle(),
+		SCHEDULER_BUDGET_MS,
+	);
+	// 发送 chunk 时可能触发内存增长，先把 id 拷出
+	const counts = new Int32Array(module.HEAPU8.buffer, ptr, 2);
+	const ready = counts[0] ?? 0;
+	const starved = counts[1] ?? 0;
+	const ids = new Int32Array(module.HEAPU8.buffer, ptr + 8, ready + starved);
+	const readyIds = ids.slice(0, ready);
+	const starvedIds = ids.slice(ready);
+	for (const id of readyIds) {
+		scheduled.get(id)?.deliver();
+	}
+	for (const id of starvedIds) {
+		scheduled.get(id)?.retryLater();
+	}
+
+	if (instance.hasActiveSessions()) schedulePump();
+}
+
+/** 回复带上会话槽位，共享 worker 据此把响应分发给对应的端口 */
+function postTo(
+	slot: number | undefined,
+	msg: WorkerResponse,
+	transfer: Transferable[] = [],
+) {
+	self.postMessage(slot ? { ...msg, slot } : msg, transfer);
+}
+
 class DecoderSession {
 	private sessionId: number = 0;
-	private decoder: AudioStreamDecoder | null = null;
+	// 调度器中的会话 id，销毁后为 0
+	private schedId: number;
+	// 由调度器持有，销毁会话时随之释放；排队下一首后在混音器内交叉淡化
+	private mixer: CrossfadeMixer | null = null;
+	// 逐 chunk 的解码走 C ABI，绕开 Embind 值对象
+	private chunkReader: RawChunkReader | null = null;
+	private spectrumEnabled = false;
+	private varispeed = false;
 	private mountDir: string | null = null;
+	private filePath: string | null = null;
+	// 排队的下一首的挂载目录和路径，切换过去后成为当前曲目
+	private queuedMount: { dir: string; path: string } | null = null;
+	// 已发给主线程的最后一个 chunk 所属的曲目序号
+	private trackIndex = 0;
+	// 拖动预览专用的解码器，不打断正常播放的解码位置
+	private previewDecoder: AudioStreamDecoder | null = null;
+	private previewSampleRate = 0;
 	private isRunning = true;
 	private isPaused = false;
+	private isLive = false;
+	private liveDrainTimer: ReturnType<typeof setInterval> | null = null;
+	private liveRetryTimer: ReturnType<typeof setTimeout> | null = null;
+	// 尚未处理的拖动预览请求，只保留最新的一个
+	private pendingScrub: (WorkerRequest & { type: "SCRUB" }) | null = null;
 
 	private ringBuffer: SharedRingBuffer | null = null;
 	private sabHeader: Int32Array | null = null;
 
 	constructor(
 		private module: AudioDecoderModule,
-		public req: WorkerRequest & { type: "INIT" | "INIT_STREAM" },
+		private scheduler: DecoderScheduler,
+		public req: WorkerRequest & { type: "INIT" | "INIT_STREAM" | "INIT_LIVE" },
 	) {
 		this.sessionId = req.sessionId;
+		this.schedId = scheduler.create(
+			toSessionPriority(module, req.priority),
+			req.chunkSize,
+			module.SampleFormat.PlanarF32,
+		);
+		scheduled.set(this.schedId, this);
 
-		if (req.type === "INIT") {
-			this.mountDir = `/session_${req.id}`;
-			this.initFile(req.file);
-		} else {
-			this.initStream(req.sab, req.fileSize);
+		try {
+			const mixer = scheduler.mixer(this.schedId);
+			if (!mixer) throw new Error("Scheduler session not found");
+			this.mixer = mixer;
+			const decoder = mixer.current();
+
+			if (req.type === "INIT") {
+				this.mountDir = `/session_${req.slot ?? 0}_${req.id}`;
+				this.initFile(decoder, req.file);
+			} else if (req.type === "INIT_STREAM") {
+				this.initStream(decoder, req.sab, req.fileSize);
+			} else {
+				this.initLive(decoder, req);
+			}
+		} catch (e) {
+			this.destroy();
+			throw e;
 		}
 	}
 
-	private initFile(file: File) {
-		if (!this.mountDir) return;
+	/** 正在输出的曲目的解码器，混音器切换曲目后随之改变 */
+	private get decoder(): AudioStreamDecoder | null {
+		return this.mixer?.current() ?? null;
+	}
+
+	/** 输出参数同时作用于当前曲目和排队的下一首 */
+	private forEachDecoder(fn: (decoder: AudioStreamDecoder) => void) {
+		if (!this.mixer) return;
+		fn(this.mixer.current());
+		fn(this.mixer.queued());
+	}
+
+	private mountFile(dir: string, file: File) {
 		try {
-			this.module.FS.mkdir(this.mountDir);
+			this.module.FS.mkdir(dir);
 			this.module.FS.mount(
 				this.module.FS.filesystems.WORKERFS,
 				{ files: [file] },
-				this.mountDir,
+				dir,
 			);
 		} catch (e) {
 			console.warn(`[DecoderSession] Mount error: ${e}`);
 		}
+		return `${dir}/${file.name}`;
+	}
+
+	private unmountDir(dir: string) {
+		try {
+			this.module.FS.unmount(dir);
+			this.module.FS.rmdir(dir);
+		} catch {
+			// ignore
+		}
+	}
 
-		const filePath = `${this.mountDir}/${file.name}`;
-		this.decoder = new this.module.AudioStreamDecoder();
-		const props = this.decoder.init(filePath);
+	private initFile(decoder: AudioStreamDecoder, file: File) {
+		if (!this.mountDir) return;
+		const filePath = this.mountFile(this.mountDir, file);
+		this.filePath = filePath;
+		this.forEachDecoder((d) => d.setPcmCache(PCM_CACHE_BYTES));
+		const props = decoder.init(filePath);
 
 		this.handleInitResult(props);
-		this.decodeLoop();
+		this.activate();
 	}
 
-	private initStream(sab: SharedArrayBuffer, fileSize: number) {
+	private initStream(
+		decoder: AudioStreamDecoder,
+		sab: SharedArrayBuffer,
+		fileSize: number,
+	) {
 		this.ringBuffer = new SharedRingBuffer(sab);
 		this.sabHeader = new Int32Array(sab, 0, IDX_SEEK_GEN + 1);
 
-		this.decoder = new this.module.AudioStreamDecoder();
+		this.forEachDecoder((d) => d.setPcmCache(PCM_CACHE_BYTES));
 
 		const readCallback = (ptr: number, size: number): number => {
 			if (!this.ringBuffer) return -1;
@@ -119,14 +324,51 @@ class DecoderSession {
 			return targetPos;
 		};
 
-		const props = this.decoder.initStream(readCallback, seekCallback);
+		const props = decoder.initStream(readCallback, seekCallback);
 		this.handleInitResult(props);
-		this.decodeLoop();
+		this.activate();
+	}
+
+	private initLive(
+		decoder: AudioStreamDecoder,
+		req: WorkerRequest & { type: "INIT_LIVE" },
+	) {
+		this.isLive = true;
+		this.ringBuffer = new SharedRingBuffer(req.sab);
+
+		decoder.setLiveLatency(req.targetLatency, req.maxLatency);
+
+		// 有多少读多少，只在环形缓冲区为空时等待网络
+		const readCallback = (ptr: number, size: number): number => {
+			if (!this.ringBuffer) return -1;
+			return this.ringBuffer.blockingRead(this.module.HEAPU8, ptr, size, true);
+		};
+
+		const props = decoder.initLive(readCallback, req.icyMetaint);
+		this.handleInitResult(props);
+		this.activate();
 	}
 
 	private handleInitResult(props: AudioProperties) {
+		this.post({
+			type: "METADATA",
+			id: this.req.id,
+			...this.describeTrack(props, "Decoder init failed"),
+		});
+	}
+
+	/** 把打开曲目的结果转换为 AudioMetadata 并释放 props，打开失败时抛出 */
+	private describeTrack(
+		props: AudioProperties,
+		failure: string,
+	): AudioMetadata {
 		if (props.status.status < 0) {
-			throw new Error(`Decoder init failed: ${props.status.error}`);
+			const error = props.status.error;
+			props.metadata.delete();
+			props.coverArt.delete();
+			props.streams.delete();
+			props.chapters.delete();
+			throw new Error(`${failure}: ${error}`);
 		}
 
 		const metadataObj: Record<string, string> = {};
@@ -147,9 +389,15 @@ class DecoderSession {
 			coverUrl = URL.createObjectURL(new Blob([cover]));
 		}
 
-		this.post({
-			type: "METADATA",
-			id: this.req.id,
+		const streams = readStreamList(props.streams);
+		const chapters = readChapterList(props.chapters);
+
+		props.metadata.delete();
+		props.coverArt.delete();
+		props.streams.delete();
+		props.chapters.delete();
+
+		return {
 			sampleRate: props.sampleRate,
 			channels: props.channelCount,
 			duration: props.duration,
@@ -157,29 +405,153 @@ class DecoderSession {
 			encoding: props.encoding,
 			coverUrl,
 			bitsPerSample: props.bitsPerSample,
-		});
+			streams,
+			streamIndex: props.streamIndex,
+			chapters,
+		};
+	}
 
-		props.metadata.delete();
-		props.coverArt.delete();
+	/**
+	 * 在混音器的空闲解码器中打开下一首，当前曲目结束时按 setCrossfade 的设置交叉淡化过去。
+	 * 过渡开始前可以再次调用替换；直播流没有结尾，不支持
+	 */
+	public queueNext(file: File, reqId: number): AudioMetadata {
+		if (!this.mixer) throw new Error("Decoder session closed");
+		if (this.isLive) {
+			throw new Error("Crossfade is not available for live streams");
+		}
+
+		const dir = `/session_${this.req.slot ?? 0}_${reqId}`;
+		const path = this.mountFile(dir, file);
+		let metadata: AudioMetadata;
+		try {
+			metadata = this.describeTrack(
+				this.mixer.queueNext(path),
+				"Queue next failed",
+			);
+		} catch (e) {
+			this.unmountDir(dir);
+			// 打开失败时之前排队的曲目也已关闭；过渡已开始时它仍在播放
+			if (!this.mixer.hasNext()) this.releaseQueuedMount();
+			throw e;
+		}
+
+		// 被替换的下一首已由 queueNext 关闭
+		this.releaseQueuedMount();
+		this.queuedMount = { dir, path };
+		if (this.varispeed) this.mixer.queued().setVarispeed(true);
+		return metadata;
 	}
 
-	private decodeLoop = () => {
-		if (!this.isRunning || this.isPaused || !this.decoder) return;
+	private releaseQueuedMount() {
+		if (this.queuedMount) this.unmountDir(this.queuedMount.dir);
+		this.queuedMount = null;
+	}
+
+	public setCrossfade(seconds: number, curve: CrossfadeCurveName) {
+		this.mixer?.setCrossfade(seconds, toCrossfadeCurve(this.module, curve));
+	}
+
+	/** 混音器已切换到排队的曲目：释放上一首的挂载，之后的 seek 和拖动预览都针对新曲目 */
+	private switchTrack(trackIndex: number) {
+		this.trackIndex = trackIndex;
+		if (this.mountDir) this.unmountDir(this.mountDir);
+		this.mountDir = this.queuedMount?.dir ?? null;
+		this.filePath = this.queuedMount?.path ?? null;
+		this.queuedMount = null;
+
+		if (this.previewDecoder) {
+			this.previewDecoder.close();
+			this.previewDecoder.delete();
+			this.previewDecoder = null;
+		}
+		// 下一首总是本地文件，不再从网络环形缓冲区读取
+		this.ringBuffer = null;
+		this.sabHeader = null;
+	}
+
+	/**
+	 * 只在环形缓冲区有足够数据时预读压缩包，网络尚未跟上时让解码器先消耗已排队的包
+	 */
+	private prefetchPackets() {
+		if (!this.decoder || !this.ringBuffer) return;
+		const minBytes = this.isLive ? LIVE_PREFETCH_MIN_BYTES : PREFETCH_MIN_BYTES;
+
+		for (let i = 0; i < PREFETCH_MAX_PACKETS; i++) {
+			if (
+				!this.ringBuffer.isEOF() &&
+				this.ringBuffer.availableBytes() < minBytes
+			) {
+				break;
+			}
+
+			const status = this.decoder.fillPacketQueue(1);
+			if (status.status < 0) {
+				throw new Error(`Demux error: ${status.error}`);
+			}
+
+			// 直播流的队列由解码器按最大延迟裁剪，满了也继续读
+			const queue = this.decoder.getPacketQueueStatus();
+			if ((queue.isFull && !this.isLive) || queue.demuxEOF) break;
+		}
+	}
+
+	/** 调度步骤开始前调用，只有正在解码的会话预读 */
+	public prefetch() {
+		if (!this.isRunning || this.isPaused) return;
+		try {
+			this.prefetchPackets();
+		} catch (e) {
+			this.handleError(e);
+		}
+	}
+
+	private activate() {
+		this.clearLiveRetry();
+		this.scheduler.setActive(this.schedId, true);
+		schedulePump();
+	}
+
+	private deactivate() {
+		this.clearLiveRetry();
+		this.scheduler.setActive(this.schedId, false);
+	}
+
+	private clearLiveRetry() {
+		if (this.liveRetryTimer) {
+			clearTimeout(this.liveRetryTimer);
+			this.liveRetryTimer = null;
+		}
+	}
+
+	/** 调度器刚为本会话解码了一个 chunk，把它发给主线程 */
+	public deliver() {
+		if (!this.isRunning || !this.mixer) return;
 
 		try {
+			this.chunkReader ??= new RawChunkReader(this.module, this.mixer);
 			const FORMAT_F32 = this.module.SampleFormat.PlanarF32;
-			const result = this.decoder.readChunk(this.req.chunkSize, FORMAT_F32);
+			const result = this.chunkReader.peek(FORMAT_F32);
+			const mix = this.chunkReader.peekMix();
+			if (mix.trackIndex !== this.trackIndex) this.switchTrack(mix.trackIndex);
 
-			if (result.status.status < 0) {
+			if (result.status < 0) {
 				// EOF
-				if (result.status.status !== -541478725) {
-					throw new Error(`Decode error: ${result.status.error}`);
+				if (result.status !== -541478725) {
+					throw new Error(`Decode error: ${result.error}`);
 				}
 			}
 
-			if (result.samples.length > 0) {
-				const chunkData = result.samples as Float32Array;
-				const copy = chunkData.slice();
+			if (result.samples && result.samples.length > 0) {
+				// 样本指向 WASM 堆，下次解码前必须拷出
+				const copy = (result.samples as Float32Array).slice();
+				// 混音器缓冲过的样本与解码器的频谱帧不对齐
+				const spectrum = mix.mixed ? undefined : this.takeSpectrum();
+				const streamMetadata = this.takeStreamMetadata();
+				const transfer: Transferable[] = [copy.buffer];
+				if (spectrum) {
+					transfer.push(spectrum.data.buffer, spectrum.offsets.buffer);
+				}
 				this.post(
 					{
 						type: "CHUNK",
@@ -187,38 +559,95 @@ class DecoderSession {
 						data: copy,
 						startTime: result.startTime,
 						sessionId: this.sessionId,
+						trackIndex: mix.trackIndex,
+						queuedDuration: result.queuedDuration,
+						spectrum,
+						streamMetadata,
 					},
-					[copy.buffer],
+					transfer,
 				);
 			}
 
 			if (result.isEOF) {
+				// 调度器已自动停用该会话
 				this.post({ type: "EOF", id: this.req.id });
 				this.isRunning = false;
-			} else {
-				// 让出主线程，避免 UI 卡死
-				setTimeout(this.decodeLoop, 0);
 			}
 		} catch (e) {
 			this.handleError(e);
 		}
-	};
+	}
+
+	/** 直播流还在缓冲，调度器已把会话停用，稍后再试 */
+	public retryLater() {
+		if (this.liveRetryTimer) return;
+		this.liveRetryTimer = setTimeout(() => {
+			this.liveRetryTimer = null;
+			if (this.isRunning && !this.isPaused) this.activate();
+		}, LIVE_POLL_MS);
+	}
+
+	public setPriority(name: SessionPriorityName) {
+		this.scheduler.setPriority(
+			this.schedId,
+			toSessionPriority(this.module, name),
+		);
+	}
 
 	public pause() {
 		this.isPaused = true;
+		this.deactivate();
+		// 直播流暂停时仍把网络数据读进抖动缓冲，超过最大延迟的部分由解码器丢弃，
+		// 恢复时直接从接近实时的位置继续
+		if (this.isLive && !this.liveDrainTimer) {
+			this.liveDrainTimer = setInterval(this.drainLive, LIVE_DRAIN_MS);
+		}
+	}
+
+	private drainLive = () => {
+		try {
+			this.prefetchPackets();
+		} catch (e) {
+			this.handleError(e);
+		}
+	};
+
+	private stopLiveDrain() {
+		if (this.liveDrainTimer) {
+			clearInterval(this.liveDrainTimer);
+			this.liveDrainTimer = null;
+		}
 	}
 
 	public resume() {
+		this.stopLiveDrain();
 		if (this.isPaused) {
 			this.isPaused = false;
-			this.decodeLoop();
+			this.activate();
 		}
 	}
 
-	public seek(time: number, newId: number, newSessionId: number) {
-		if (!this.decoder) return;
+	public seek(
+		time: number,
+		newId: number,
+		newSessionId: number,
+		chapter?: number,
+		cueTrack?: { index: number; continuous: boolean },
+	) {
+		const decoder = this.decoder;
+		if (!this.mixer || !decoder) return;
 		try {
-			const result = this.decoder.seek(time);
+			let result: DecoderStatus;
+			if (cueTrack) {
+				const { index, continuous } = cueTrack;
+				this.mixer.flush();
+				result = decoder.playCueTrack(index, continuous);
+			} else if (chapter !== undefined) {
+				this.mixer.flush();
+				result = decoder.seekChapter(chapter);
+			} else {
+				result = this.mixer.seek(time);
+			}
 			if (result.status < 0) throw new Error(result.error);
 
 			this.req.id = newId;
@@ -228,38 +657,299 @@ class DecoderSession {
 
 			this.isRunning = true;
 			this.isPaused = false;
-			this.decodeLoop();
+			this.activate();
 		} catch (e) {
 			this.handleError(e);
 		}
 	}
 
+	public selectStream(streamIndex: number, reqId: number) {
+		const decoder = this.decoder;
+		if (!this.mixer || !decoder) return;
+		try {
+			this.rewind();
+			const props = decoder.selectStream(streamIndex);
+
+			props.metadata.delete();
+			props.coverArt.delete();
+			props.streams.delete();
+			props.chapters.delete();
+
+			if (props.status.status < 0) {
+				throw new Error(`Select stream failed: ${props.status.error}`);
+			}
+
+			this.post({
+				type: "STREAM_CHANGED",
+				id: reqId,
+				sampleRate: props.sampleRate,
+				channels: props.channelCount,
+				encoding: props.encoding,
+				bitsPerSample: props.bitsPerSample,
+				streamIndex: props.streamIndex,
+			});
+		} catch (e) {
+			const err = toError(e);
+			this.post({ type: "ERROR", id: reqId, error: err.message });
+		}
+	}
+
+	public setEqBand(index: number, band: EqBandOptions | null) {
+		this.forEachDecoder((decoder) => {
+			if (band) {
+				decoder.setEqBand(index, band.type, band.freq, band.gainDb, band.q);
+			} else {
+				decoder.disableEqBand(index);
+			}
+		});
+	}
+
+	public setSpectrum(options: SpectrumOptions | null) {
+		const { fftSize, hop, bands } = options ?? {
+			fftSize: 0,
+			hop: 0,
+			bands: 0,
+		};
+		this.forEachDecoder((decoder) => {
+			if (!decoder.setSpectrum(fftSize, hop, bands)) {
+				throw new Error(
+					`Invalid spectrum options: ${JSON.stringify(options)}`,
+				);
+			}
+		});
+		this.spectrumEnabled = fftSize > 0;
+	}
+
+	// 取出上次调用以来直播流中生效的元数据，没有新的时返回 undefined
+	private takeStreamMetadata(): StreamMetadata[] | undefined {
+		if (!this.isLive || !this.decoder) return undefined;
+		const list = this.decoder.takeStreamMetadata();
+		const events: StreamMetadata[] = [];
+		for (let i = 0; i < list.size(); i++) {
+			const { time, title, raw } = list.get(i);
+			events.push({ time, title, raw });
+		}
+		list.delete();
+		return events.length > 0 ? events : undefined;
+	}
+
+	// 拷出本 chunk 的频谱帧，未开启或本 chunk 没有完整的帧时返回 undefined
+	private takeSpectrum(): SpectrumChunk | undefined {
+		if (!this.spectrumEnabled || !this.decoder) return undefined;
+		const spectrum = this.decoder.getSpectrum();
+		if (spectrum.frames === 0) return undefined;
+		return {
+			data: spectrum.data.slice(),
+			offsets: spectrum.offsets.slice(),
+			bands: spectrum.bands,
+		};
+	}
+
+	public setLimiter(options: LimiterOptions) {
+		this.forEachDecoder((decoder) =>
+			decoder.setLimiter(
+				options.enabled,
+				options.thresholdDb,
+				options.lookaheadMs,
+				options.releaseMs,
+			),
+		);
+	}
+
+	public setSkipSilence(options: SkipSilenceOptions) {
+		this.forEachDecoder((decoder) =>
+			decoder.setSkipSilence(
+				options.enabled,
+				options.thresholdDb,
+				options.minSilenceMs,
+				options.keepMs,
+				options.crossfadeMs,
+			),
+		);
+	}
+
+	public setNormalization(options: NormalizationOptions) {
+		this.forEachDecoder((decoder) =>
+			decoder.setNormalization(
+				options.mode,
+				options.preampDb,
+				options.preventClipping,
+			),
+		);
+	}
+
+	public queueScrub(req: WorkerRequest & { type: "SCRUB" }) {
+		// 新请求到来时旧请求还没开始处理，直接作废，避免拖动时堆积
+		if (this.pendingScrub) {
+			this.post({
+				type: "SCRUB_PREVIEW",
+				id: this.pendingScrub.id,
+				data: null,
+				startTime: this.pendingScrub.position,
+			});
+		} else {
+			setTimeout(this.processScrub, 0);
+		}
+		this.pendingScrub = req;
+	}
+
+	private processScrub = () => {
+		const req = this.pendingScrub;
+		this.pendingScrub = null;
+		if (!req) return;
+		this.scrub(req.position, req.durationMs, req.id);
+	};
+
+	private scrub(position: number, durationMs: number, reqId: number) {
+		try {
+			// 已播放过的位置直接从播放解码器的 PCM 缓存取，不需要再解码
+			const cached = this.cachedPreview(position, durationMs);
+			if (cached) {
+				this.post(
+					{
+						type: "SCRUB_PREVIEW",
+						id: reqId,
+						data: cached.data,
+						startTime: cached.startTime,
+					},
+					[cached.data.buffer],
+				);
+				return;
+			}
+
+			if (!this.filePath) {
+				throw new Error("Scrub preview is only available for local files");
+			}
+
+			if (!this.previewDecoder) {
+				const decoder = new this.module.AudioStreamDecoder();
+				const props = decoder.init(this.filePath);
+				props.metadata.delete();
+				props.coverArt.delete();
+				props.streams.delete();
+				props.chapters.delete();
+				if (props.status.status < 0) {
+					decoder.delete();
+					throw new Error(`Preview init failed: ${props.status.error}`);
+				}
+				this.previewDecoder = decoder;
+				this.previewSampleRate = props.sampleRate;
+			}
+
+			const frames = Math.max(
+				1,
+				Math.round((this.previewSampleRate * durationMs) / 1000),
+			);
+			const result = this.previewDecoder.scrubPreview(position, frames);
+			if (result.status.status < 0) {
+				throw new Error(`Scrub error: ${result.status.error}`);
+			}
+
+			const data = new Float32Array(result.samples as Float32Array);
+			this.post(
+				{
+					type: "SCRUB_PREVIEW",
+					id: reqId,
+					data,
+					startTime: result.startTime,
+				},
+				[data.buffer],
+			);
+		} catch (e) {
+			const err = toError(e);
+			this.post({ type: "ERROR", id: reqId, error: err.message });
+		}
+	}
+
+	private cachedPreview(position: number, durationMs: number) {
+		const decoder = this.decoder;
+		if (!decoder) return null;
+		const frames = Math.round((decoder.sampleRate() * durationMs) / 1000);
+		if (frames <= 0) return null;
+		const result = decoder.cachedPreview(position, frames);
+		if (result.status.status < 0 || result.samples.length === 0) return null;
+		return {
+			data: new Float32Array(result.samples as Float32Array),
+			startTime: result.startTime,
+		};
+	}
+
+	// 混音器记住速度和音调，新打开的下一首也会应用
 	public setTempo(tempo: number) {
-		this.decoder?.setTempo(tempo);
+		this.mixer?.setTempo(tempo);
 	}
 
 	public setPitch(pitch: number) {
-		this.decoder?.setPitch(pitch);
+		this.mixer?.setPitch(pitch);
+	}
+
+	public setVarispeed(enabled: boolean) {
+		if (!this.mixer) return;
+		this.rewind();
+		const status = this.mixer.current().setVarispeed(enabled);
+		if (status.status < 0) throw new Error(status.error);
+		this.varispeed = enabled;
+		if (this.mixer.hasNext()) this.mixer.queued().setVarispeed(enabled);
+	}
+
+	public setReverse(enabled: boolean) {
+		const decoder = this.decoder;
+		if (!decoder) return;
+		this.rewind();
+		const status = decoder.setReverse(enabled);
+		if (status.status < 0) throw new Error(status.error);
+	}
+
+	/** 解码器从当前位置生效的操作之前，先把混音器缓冲的样本退回解码器 */
+	private rewind() {
+		const status = this.mixer?.rewind();
+		if (status && status.status < 0) throw new Error(status.error);
+	}
+
+	public setLoop(start: number, end: number, crossfadeMs: number) {
+		const status = this.decoder?.setLoop(start, end, crossfadeMs);
+		if (status && status.status < 0) throw new Error(status.error);
+	}
+
+	public clearLoop() {
+		this.decoder?.clearLoop();
+	}
+
+	public loadCueSheet(text: string): AudioCueTrack[] {
+		if (!this.decoder) return [];
+		const list = this.decoder.loadCueSheet(text);
+		const tracks: AudioCueTrack[] = [];
+		for (let i = 0; i < list.size(); i++) {
+			const { number, start, end, title, performer } = list.get(i);
+			tracks.push({ number, start, end, title, performer });
+		}
+		list.delete();
+		return tracks;
 	}
 
 	public destroy() {
 		this.isRunning = false;
-
-		if (this.decoder) {
-			this.decoder.close();
-			this.decoder.delete();
-			this.decoder = null;
+		this.stopLiveDrain();
+		this.clearLiveRetry();
+
+		this.chunkReader = null;
+		this.mixer = null;
+		if (this.schedId) {
+			// 解码器由调度器释放（析构时 close）
+			this.scheduler.remove(this.schedId);
+			scheduled.delete(this.schedId);
+			this.schedId = 0;
 		}
 
-		if (this.module && this.mountDir) {
-			try {
-				this.module.FS.unmount(this.mountDir);
-				this.module.FS.rmdir(this.mountDir);
-			} catch {
-				// ignore
-			}
+		if (this.previewDecoder) {
+			this.previewDecoder.close();
+			this.previewDecoder.delete();
+			this.previewDecoder = null;
 		}
 
+		if (this.module && this.mountDir) this.unmountDir(this.mountDir);
+		this.releaseQueuedMount();
+
 		this.ringBuffer = null;
 		this.sabHeader = null;
 	}
@@ -276,151 +966,216 @@ class DecoderSession {
 	}
 
 	private post(msg: WorkerResponse, transfer: Transferable[] = []) {
-		self.postMessage(msg, transfer);
+		postTo(this.req.slot, msg, transfer);
 	}
 }
 
-async function handleExportWav(
+/** 为离线任务挂载文件并打开一个独立的解码器，用完后调用 release */
+function openOfflineDecoder(
 	module: AudioDecoderModule,
-	req: WorkerRequest & { type: "EXPORT_WAV" },
+	file: File,
+	req: WorkerRequest,
 ) {
-	const mountDir = `/export_${req.id}`;
-	let decoder: AudioStreamDecoder | null = null;
-
+	const mountDir = `/export_${req.slot ?? 0}_${req.id}`;
 	try {
+		module.FS.mkdir(mountDir);
+		module.FS.mount(
+			module.FS.filesystems.WORKERFS,
+			{ files: [file] },
+			mountDir,
+		);
+	} catch {
+		// 忽略目录已存在错误
+	}
+
+	const decoder = new module.AudioStreamDecoder();
+	const release = () => {
+		decoder.close();
+		decoder.delete();
 		try {
-			module.FS.mkdir(mountDir);
-			module.FS.mount(
-				module.FS.filesystems.WORKERFS,
-				{ files: [req.file] },
-				mountDir,
-			);
-		} catch {
-			// 忽略目录已存在错误
+			module.FS.unmount(mountDir);
+			module.FS.rmdir(mountDir);
+		} catch {}
+	};
+
+	const props = decoder.init(`${mountDir}/${file.name}`);
+	props.metadata.delete();
+	props.coverArt.delete();
+	props.streams.delete();
+	props.chapters.delete();
+
+	if (props.status.status < 0) {
+		release();
+		throw new Error(`Export init failed: ${props.status.error}`);
+	}
+	return { decoder, props, release };
+}
+
+function postExportError(req: WorkerRequest, e: unknown) {
+	const err = toError(e);
+	console.error("[Worker] Export WAV error:", err);
+	postTo(req.slot, { type: "ERROR", id: req.id, error: err.message });
+}
+
+function handleExportPlan(
+	module: AudioDecoderModule,
+	req: WorkerRequest & { type: "EXPORT_PLAN" },
+) {
+	try {
+		const { decoder, props, release } = openOfflineDecoder(
+			module,
+			req.file,
+			req,
+		);
+		const list = decoder.segmentBoundaries(req.segments);
+		const boundaries: number[] = [];
+		for (let i = 0; i < list.size(); i++) {
+			boundaries.push(list.get(i));
 		}
+		list.delete();
 
-		decoder = new module.AudioStreamDecoder();
-		const filePath = `${mountDir}/${req.file.name}`;
-		const props = decoder.init(filePath);
+		// 按源的位深导出，整数源逐位一致，浮点源（有损编码）导出 32 位浮点
+		const { SampleFormat } = module;
+		const format = decoder.nativeSampleFormat();
+		const channelMask = decoder.channelMask();
+		release();
 
-		if (props.status.status < 0) {
-			throw new Error(`Export init failed: ${props.status.error}`);
+		postTo(req.slot, {
+			type: "EXPORT_PLAN_DONE",
+			id: req.id,
+			sampleRate: props.sampleRate,
+			channels: props.channelCount,
+			bitsPerSample:
+				format === SampleFormat.InterleavedS16
+					? 16
+					: format === SampleFormat.InterleavedS24
+						? 24
+						: 32,
+			isFloat: format === SampleFormat.InterleavedF32,
+			channelMask,
+			boundaries,
+		});
+	} catch (e) {
+		postExportError(req, e);
+	}
+}
+
+function exportSampleFormat(
+	module: AudioDecoderModule,
+	bitsPerSample: number,
+	isFloat: boolean,
+): SampleFormat {
+	const { SampleFormat } = module;
+	if (isFloat) return SampleFormat.InterleavedF32;
+	if (bitsPerSample === 24) return SampleFormat.InterleavedS24;
+	return bitsPerSample === 32
+		? SampleFormat.InterleavedS32
+		: SampleFormat.InterleavedS16;
+}
+
+function handleExportSegment(
+	module: AudioDecoderModule,
+	req: WorkerRequest & { type: "EXPORT_SEGMENT" },
+) {
+	let release: (() => void) | null = null;
+
+	try {
+		const offline = openOfflineDecoder(module, req.file, req);
+		const { decoder } = offline;
+		release = offline.release;
+
+		const status = decoder.beginSegment(
+			req.start,
+			req.end,
+			exportSampleFormat(module, req.bitsPerSample, req.isFloat),
+		);
+		if (status.status < 0) {
+			throw new Error(`Export seek failed: ${status.error}`);
 		}
 
-		const chunks: Int16Array[] = [];
-		const CHUNK_SIZE = 4096 * 16;
-		const FORMAT_S16 = module.SampleFormat.InterleavedS16;
+		const chunks: BlobPart[] = [];
+		const CHUNK_FRAMES = 4096 * 16;
 
 		while (true) {
-			const result = decoder.readChunk(CHUNK_SIZE, FORMAT_S16);
+			const result = decoder.readSegment(CHUNK_FRAMES);
 
 			if (result.status.status < 0) {
 				throw new Error(`Export decode error: ${result.status.error}`);
 			}
 
+			// 样本是 wasm 内存的视图，下次调用会被覆盖
 			if (result.samples.length > 0) {
-				chunks.push(result.samples as Int16Array);
+				chunks.push(result.samples.slice());
 			}
 
 			if (result.isEOF) break;
 		}
 
-		const totalSamples = chunks.reduce((acc, curr) => acc + curr.length, 0);
-		const dataByteLength = totalSamples * 2; // Int16 = 2 bytes
-
-		const wavHeader = createWavHeader(
-			props.sampleRate,
-			props.channelCount,
-			dataByteLength,
-		);
-
-		props.metadata.delete();
-		props.coverArt.delete();
-
-		const blob = new Blob([wavHeader, ...chunks] as BlobPart[], {
-			type: "audio/wav",
-		});
-
-		self.postMessage({
-			type: "EXPORT_WAV_DONE",
+		postTo(req.slot, {
+			type: "EXPORT_SEGMENT_DONE",
 			id: req.id,
-			blob: blob,
+			blob: new Blob(chunks),
 		});
 	} catch (e) {
-		const err = toError(e);
-		console.error("[Worker] Export WAV error:", err);
-		self.postMessage({
-			type: "ERROR",
-			id: req.id,
-			error: err.message,
-		});
+		postExportError(req, e);
 	} finally {
-		if (decoder) {
-			decoder.close();
-			decoder.delete();
-		}
-		try {
-			module.FS.unmount(mountDir);
-			module.FS.rmdir(mountDir);
-		} catch {}
+		release?.();
 	}
 }
 
-function createWavHeader(
-	sampleRate: number,
-	channels: number,
-	dataLength: number,
-): Uint8Array {
-	const buffer = new ArrayBuffer(44);
-	const view = new DataView(buffer);
-
-	// RIFF chunk descriptor
-	writeString(view, 0, "RIFF");
-	view.setUint32(4, 36 + dataLength, true); // File size - 8
-	writeString(view, 8, "WAVE");
-
-	// fmt sub-chunk
-	writeString(view, 12, "fmt ");
-	view.setUint32(16, 16, true); // Subchunk1Size (16 for PCM)
-	view.setUint16(20, 1, true); // AudioFormat (1 = PCM)
-	view.setUint16(22, channels, true);
-	view.setUint32(24, sampleRate, true);
-	view.setUint32(28, sampleRate * channels * 2, true); // ByteRate
-	view.setUint16(32, channels * 2, true); // BlockAlign
-	view.setUint16(34, 16, true); // BitsPerSample
-
-	// data sub-chunk
-	writeString(view, 36, "data");
-	view.setUint32(40, dataLength, true);
-
-	return new Uint8Array(buffer);
+function readStreamList(list: AudioStreamList): AudioStreamDescription[] {
+	const streams: AudioStreamDescription[] = [];
+	for (let i = 0; i < list.size(); i++) {
+		const info = list.get(i);
+		streams.push({
+			index: info.index,
+			codec: info.codec,
+			channels: info.channels,
+			sampleRate: info.sampleRate,
+			language: info.language,
+			title: info.title,
+			isDefault: info.isDefault,
+		});
+	}
+	return streams;
 }
 
-function writeString(view: DataView, offset: number, string: string) {
-	for (let i = 0; i < string.length; i++) {
-		view.setUint8(offset + i, string.charCodeAt(i));
+function readChapterList(list: ChapterList): AudioChapter[] {
+	const chapters: AudioChapter[] = [];
+	for (let i = 0; i < list.size(); i++) {
+		const { start, end, title } = list.get(i);
+		chapters.push({ start, end, title });
 	}
+	return chapters;
 }
 
-let currentSession: DecoderSession | null = null;
+// 会话槽位 -> 会话。独占 worker 时只用槽位 0，共享 worker 的每个端口占一个槽位
+const sessions = new Map<number, DecoderSession>();
 
 self.onmessage = async (e: MessageEvent<WorkerRequest>) => {
 	const req = e.data;
+	const slot = req.slot ?? 0;
+	const session = sessions.get(slot);
+	const reply = (msg: WorkerResponse) => postTo(req.slot, msg);
 
 	switch (req.type) {
 		case "INIT":
 		case "INIT_STREAM":
-			currentSession?.destroy();
-			currentSession = null;
+		case "INIT_LIVE":
+			session?.destroy();
+			sessions.delete(slot);
 
 			try {
 				const module = await getModule();
-				currentSession = new DecoderSession(module, req);
-				self.postMessage({ type: "ACK", id: req.id });
+				sessions.set(
+					slot,
+					new DecoderSession(module, getScheduler(module), req),
+				);
+				reply({ type: "ACK", id: req.id });
 			} catch (e) {
 				const err = toError(e);
 				console.error("[Worker] Init error:", err);
-				self.postMessage({
+				reply({
 					type: "ERROR",
 					id: req.id,
 					error: `Module load failed: ${err.message}`,
@@ -428,45 +1183,202 @@ self.onmessage = async (e: MessageEvent<WorkerRequest>) => {
 			}
 			break;
 
+		case "CLOSE":
+			session?.destroy();
+			sessions.delete(slot);
+			break;
+
+		case "SET_PRIORITY":
+			if (session) {
+				session.setPriority(req.value);
+				reply({ type: "ACK", id: req.id });
+			}
+			break;
+
 		case "PAUSE":
-			if (currentSession) {
-				currentSession.pause();
-				self.postMessage({ type: "ACK", id: req.id });
+			if (session) {
+				session.pause();
+				reply({ type: "ACK", id: req.id });
 			}
 			break;
 
 		case "RESUME":
-			if (currentSession) {
-				currentSession.resume();
-				self.postMessage({ type: "ACK", id: req.id });
+			if (session) {
+				session.resume();
+				reply({ type: "ACK", id: req.id });
 			}
 			break;
 
 		case "SEEK":
-			if (currentSession) {
-				currentSession.seek(req.seekTime, req.id, req.sessionId);
+			if (session) {
+				session.seek(
+					req.seekTime,
+					req.id,
+					req.sessionId,
+					req.chapter,
+					req.cueTrack,
+				);
 			}
 			break;
 
 		case "SET_TEMPO":
-			if (currentSession) {
-				currentSession.setTempo(req.value);
-				self.postMessage({ type: "ACK", id: req.id });
+			if (session) {
+				session.setTempo(req.value);
+				reply({ type: "ACK", id: req.id });
 			}
 			break;
 
 		case "SET_PITCH":
-			if (currentSession) {
-				currentSession.setPitch(req.value);
-				self.postMessage({ type: "ACK", id: req.id });
+			if (session) {
+				session.setPitch(req.value);
+				reply({ type: "ACK", id: req.id });
 			}
 			break;
 
-		case "EXPORT_WAV":
-			{
-				const module = await getModule();
-				handleExportWav(module, req);
+		case "SET_LOOP":
+			if (session) {
+				try {
+					if (req.region) {
+						const { start, end, crossfadeMs } = req.region;
+						session.setLoop(start, end, crossfadeMs);
+					} else {
+						session.clearLoop();
+					}
+					reply({ type: "ACK", id: req.id });
+				} catch (e) {
+					reply({
+						type: "ERROR",
+						id: req.id,
+						error: toError(e).message,
+					});
+				}
+			}
+			break;
+
+		case "LOAD_CUE":
+			if (session) {
+				reply({
+					type: "CUE_TRACKS",
+					id: req.id,
+					tracks: session.loadCueSheet(req.text),
+				});
+			}
+			break;
+
+		case "SET_REVERSE":
+			if (session) {
+				try {
+					session.setReverse(req.enabled);
+					reply({ type: "ACK", id: req.id });
+				} catch (e) {
+					reply({
+						type: "ERROR",
+						id: req.id,
+						error: toError(e).message,
+					});
+				}
+			}
+			break;
+
+		case "SET_VARISPEED":
+			if (session) {
+				try {
+					session.setVarispeed(req.enabled);
+					reply({ type: "ACK", id: req.id });
+				} catch (e) {
+					reply({
+						type: "ERROR",
+						id: req.id,
+						error: toError(e).message,
+					});
+				}
+			}
+			break;
+
+		case "QUEUE_NEXT":
+			if (session) {
+				try {
+					reply({
+						type: "NEXT_QUEUED",
+						id: req.id,
+						metadata: session.queueNext(req.file, req.id),
+					});
+				} catch (e) {
+					reply({
+						type: "ERROR",
+						id: req.id,
+						error: toError(e).message,
+					});
+				}
+			}
+			break;
+
+		case "SET_CROSSFADE":
+			if (session) {
+				session.setCrossfade(req.seconds, req.curve);
+				reply({ type: "ACK", id: req.id });
+			}
+			break;
+
+		case "SELECT_STREAM":
+			if (session) {
+				session.selectStream(req.streamIndex, req.id);
+			}
+			break;
+
+		case "SET_EQ_BAND":
+			if (session) {
+				session.setEqBand(req.index, req.band);
+				reply({ type: "ACK", id: req.id });
+			}
+			break;
+
+		case "SET_LIMITER":
+			if (session) {
+				session.setLimiter(req.options);
+				reply({ type: "ACK", id: req.id });
 			}
 			break;
+
+		case "SET_SPECTRUM":
+			if (session) {
+				try {
+					session.setSpectrum(req.options);
+					reply({ type: "ACK", id: req.id });
+				} catch (e) {
+					reply({
+						type: "ERROR",
+						id: req.id,
+						error: toError(e).message,
+					});
+				}
+			}
+			break;
+
+		case "SET_SKIP_SILENCE":
+			if (session) {
+				session.setSkipSilence(req.options);
+				reply({ type: "ACK", id: req.id });
+			}
+			break;
+
+		case "SET_NORMALIZATION":
+			if (session) {
+				session.setNormalization(req.options);
+				reply({ type: "ACK", id: req.id });
+			}
+			break;
+
+		case "SCRUB":
+			session?.queueScrub(req);
+			break;
+
+		case "EXPORT_PLAN":
+			handleExportPlan(await getModule(), req);
+			break;
+
+		case "EXPORT_SEGMENT":
+			handleExportSegment(await getModule(), req);
+			break;
 	}
 };